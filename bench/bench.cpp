@@ -0,0 +1,1137 @@
+// basic imports
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+// PMDK imports
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+// local collection imports
+#include "../plist/plist.h"
+#include "../pvector/pvector.h"
+#include "../pstring/pstring.h"
+#include "../phashtable/phashtable.h"
+#include "../pbtree/pbtree.h"
+#include "../pring/pring.h"
+#include "../pbitset/pbitset.h"
+#include "../ppriority_queue/ppriority_queue.h"
+#include "../ppackedvector/ppackedvector.h"
+#include "../psortedvector/psortedvector.h"
+#include "../pstring_column/pstring_column.h"
+#include "../preclaim/preclaim.h"
+#include "../pgroup/pgroup.h"
+#include "../pview/pview.h"
+
+#define PMFILE "bench.pool"
+#define LAYOUT "BENCHPOOL"
+#define MIN_POOLSIZE ((size_t)(1024 * 1024 * 64)) // 64 MB
+#define BYTES_PER_ELEM ((size_t)256)
+
+using namespace pmem;
+using namespace pmem::obj;
+using namespace std;
+
+class root {
+public:
+    persistent_ptr<plist<int, root>> ilist;
+    persistent_ptr<pvector<int, root>> ivec;
+    persistent_ptr<pstring<root>> pstr;
+    persistent_ptr<pstring<root>> other;
+    persistent_ptr<phashtable<int, int, root>> hasht;
+    persistent_ptr<pbtree<int, int, root>> btree;
+    persistent_ptr<pring<int, root>> ring;
+    persistent_ptr<pbitset<root>> bits;
+    persistent_ptr<pbitset<root>> other_bits;
+    persistent_ptr<ppriority_queue<int, less<int>, root>> pq;
+    persistent_ptr<pvector<int64_t, root>> tsvec;
+    persistent_ptr<ppackedvector<int64_t, root>> tspack;
+    persistent_ptr<psortedvector<int, less<int>, root>> sorted;
+    persistent_ptr<pstring_column<root>> col;
+    persistent_ptr<preclaim> trash;
+    pepoch epoch;
+};
+
+/* ========================================================================= */
+/* ******************************* harness ********************************* */
+/* ========================================================================= */
+
+// How expensive a single operation is, which decides how many times it is sampled.
+enum class cost {
+    constant,   // O(1) per op, sampled up to --ops times
+    linear,     // O(n) per op, sampled up to --linear-ops times
+    rebuild     // needs the container rebuilt per op, sampled up to --rebuild-ops times
+};
+
+struct bench_config {
+    string pool_dir = ".";
+    string format = "csv";
+    string filter;
+    long min_size = 10;
+    long max_size = 10000000;
+    long ops = 10000;
+    long linear_ops = 100;
+    long rebuild_ops = 5;
+    size_t pool_size = 0;
+    bool stats = false;
+};
+
+struct bench_case {
+    const char* container;
+    const char* op;
+    cost kind;
+    // run once on the fresh pool before sampling, untimed
+    function<void(pool<root>&, long)> setup;
+    // run around every sampled op, untimed
+    function<void(pool<root>&, long)> before;
+    function<void(pool<root>&, long)> after;
+    // the timed operation itself
+    function<void(pool<root>&, long)> run;
+    // run once after sampling, timed and added to the total but not to the percentiles
+    function<void(pool<root>&, long)> finish;
+};
+
+struct bench_result {
+    const bench_case* bc;
+    long size;
+    long ops;
+    uint64_t total_ns;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t pool_bytes;
+};
+
+// An ostream that throws everything away, so operator<< measures formatting only.
+class null_buffer : public streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+static null_buffer null_buf;
+static ostream null_out(&null_buf);
+
+// The same for the bulk dump path, which writes to a file descriptor.
+static int null_fd = open("/dev/null", O_WRONLY);
+
+// Path of the pool the running case uses, for the cases that map it a second time.
+static string pool_path;
+
+// Get the number of bytes currently allocated from the pool's heap.
+static uint64_t pool_bytes_used(pool<root>& pop) {
+    uint64_t bytes = 0;
+    pmemobj_ctl_get(pop.handle(), "stats.heap.curr_allocated", &bytes);
+    return bytes;
+}
+
+// Get the value at the given percentile of an already sorted list of samples.
+static uint64_t percentile(const vector<uint64_t>& sorted, double pct) {
+    if (sorted.empty())
+        return 0;
+
+    size_t idx = (size_t)(pct * (sorted.size() - 1) + 0.5);
+    return sorted[min(idx, sorted.size() - 1)];
+}
+
+// Run a single case at a single size against a freshly created pool file.
+static bench_result run_case(const bench_config& cfg, const bench_case& bc, long n) {
+    string path = cfg.pool_dir + "/" + PMFILE;
+    pool_path = path;
+    size_t pool_size = cfg.pool_size ? cfg.pool_size
+                                     : max(MIN_POOLSIZE, (size_t)n * BYTES_PER_ELEM * 2);
+
+    // never reuse a pool, so allocator state does not bleed between cases
+    unlink(path.c_str());
+    palloc::reset();
+    auto pop = pool<root>::create(path, LAYOUT, pool_size, S_IRWXU);
+
+    int enabled = 1;
+    pmemobj_ctl_set(pop.handle(), "stats.enabled", &enabled);
+
+    if (bc.setup)
+        bc.setup(pop, n);
+
+    long limit = bc.kind == cost::constant ? cfg.ops
+               : bc.kind == cost::linear ? cfg.linear_ops
+               : cfg.rebuild_ops;
+    long count = max(1L, min(limit, n));
+
+    vector<uint64_t> samples;
+    samples.reserve(count);
+
+    // only count what the sampled ops do, not the setup
+    pstats::reset_all();
+
+    for (long i = 0; i < count; i++) {
+        if (bc.before)
+            bc.before(pop, n);
+
+        auto start = chrono::steady_clock::now();
+        bc.run(pop, n);
+        auto end = chrono::steady_clock::now();
+
+        samples.push_back(chrono::duration_cast<chrono::nanoseconds>(end - start).count());
+
+        if (bc.after)
+            bc.after(pop, n);
+    }
+
+    bench_result res;
+    res.bc = &bc;
+    res.size = n;
+    res.ops = count;
+    res.total_ns = 0;
+    for (auto s : samples)
+        res.total_ns += s;
+
+    if (bc.finish) {
+        auto start = chrono::steady_clock::now();
+        bc.finish(pop, n);
+        auto end = chrono::steady_clock::now();
+
+        res.total_ns += chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+    }
+
+    sort(samples.begin(), samples.end());
+    res.p50_ns = percentile(samples, 0.50);
+    res.p99_ns = percentile(samples, 0.99);
+    res.pool_bytes = pool_bytes_used(pop);
+
+    if (cfg.stats) {
+        cerr << "# " << bc.container << "::" << bc.op << " size=" << n << endl;
+        pstats::dump_all(cerr);
+    }
+
+    pop.close();
+    unlink(path.c_str());
+
+    return res;
+}
+
+// Print one result in the configured format.
+static void print_result(const bench_config& cfg, const bench_result& r, bool first) {
+    double ns_per_op = r.ops ? (double)r.total_ns / r.ops : 0;
+    double ops_per_sec = r.total_ns ? r.ops * 1e9 / r.total_ns : 0;
+
+    if (cfg.format == "json") {
+        printf("%s  {\"container\": \"%s\", \"op\": \"%s\", \"size\": %ld, \"ops\": %ld, "
+               "\"ops_per_sec\": %.1f, \"ns_per_op\": %.1f, \"p50_ns\": %llu, "
+               "\"p99_ns\": %llu, \"pool_bytes\": %llu}",
+               first ? "" : ",\n", r.bc->container, r.bc->op, r.size, r.ops,
+               ops_per_sec, ns_per_op, (unsigned long long)r.p50_ns,
+               (unsigned long long)r.p99_ns, (unsigned long long)r.pool_bytes);
+    }
+    else {
+        printf("%s,%s,%ld,%ld,%.1f,%.1f,%llu,%llu,%llu\n",
+               r.bc->container, r.bc->op, r.size, r.ops, ops_per_sec, ns_per_op,
+               (unsigned long long)r.p50_ns, (unsigned long long)r.p99_ns,
+               (unsigned long long)r.pool_bytes);
+    }
+
+    fflush(stdout);
+}
+
+/* ========================================================================= */
+/* ******************************** cases ********************************** */
+/* ========================================================================= */
+
+// Create the root pvector holding n items, reserving the capacity up front.
+static void fill_vector(pool<root>& pop, long n) {
+    auto proot = pop.root();
+
+    flat_transaction::run(pop, [&] {
+        proot->ivec = make_persistent<pvector<int, root>>(pop, (int)n);
+    });
+
+    for (long i = 0; i < n; i++)
+        proot->ivec->push_back((int)i);
+}
+
+// Order ints by a hash of their value, for scrambling a sorted vector before sorting it.
+static bool by_hash(int a, int b) {
+    return (uint32_t)a * 2654435761u < (uint32_t)b * 2654435761u;
+}
+
+// Create the root plist holding n items.
+static void fill_list(pool<root>& pop, long n) {
+    auto proot = pop.root();
+
+    flat_transaction::run(pop, [&] {
+        proot->ilist = make_persistent<plist<int, root>>(pop);
+    });
+
+    for (long i = 0; i < n; i++)
+        proot->ilist->push_back((int)i);
+}
+
+// Create the root reclamation list that the *_deferred cases hand their nodes to.
+static void make_trash(pool<root>& pop, long) {
+    flat_transaction::run(pop, [&] {
+        pop.root()->trash = make_persistent<preclaim>(pop);
+    });
+}
+
+// Create the root pstring holding n characters.
+static void fill_string(pool<root>& pop, long n) {
+    auto proot = pop.root();
+    string s(n, 'x');
+
+    flat_transaction::run(pop, [&] {
+        proot->pstr = make_persistent<pstring<root>>(pop, s.c_str());
+        proot->other = make_persistent<pstring<root>>(pop, s.c_str());
+    });
+}
+
+// Create the root phashtable holding the even keys below 2n.
+static void fill_hashtable(pool<root>& pop, long n) {
+    auto proot = pop.root();
+
+    flat_transaction::run(pop, [&] {
+        proot->hasht = make_persistent<phashtable<int, int, root>>(pop);
+    });
+
+    for (long i = 0; i < n; i++)
+        proot->hasht->insert((int)i * 2, (int)i);
+}
+
+// Input of the build_from cases: the even keys below 2n, in a shuffled order.
+static vector<pair<int, int>> build_input;
+
+// Create an empty root phashtable and the n pairs to build it from.
+static void make_build_input(pool<root>& pop, long n) {
+    flat_transaction::run(pop, [&] {
+        pop.root()->hasht = make_persistent<phashtable<int, int, root>>(pop);
+    });
+
+    build_input.clear();
+    for (long i = 0; i < n; i++)
+        build_input.push_back({(int)i * 2, (int)i});
+
+    shuffle(build_input.begin(), build_input.end(), mt19937(42));
+}
+
+// Create the root pbtree holding the even keys below 2n, so odd keys are free to insert.
+// Its nodes are allocated block aligned.
+static void fill_btree(pool<root>& pop, long n) {
+    auto proot = pop.root();
+
+    pbtree<int, int, root>::register_classes(pop);
+
+    flat_transaction::run(pop, [&] {
+        proot->btree = make_persistent<pbtree<int, int, root>>(pop);
+    });
+
+    for (long i = 0; i < n; i++)
+        proot->btree->insert((int)i * 2, (int)i);
+}
+
+// Create the root pring holding n items, with room for 100 more.
+static void fill_ring(pool<root>& pop, long n) {
+    auto proot = pop.root();
+
+    flat_transaction::run(pop, [&] {
+        proot->ring = make_persistent<pring<int, root>>(pop, (int)n + 100);
+    });
+
+    for (long i = 0; i < n; i++)
+        proot->ring->enqueue((int)i);
+}
+
+// Create two root pbitsets of n bits, with every 3rd and every 5th bit set.
+static void fill_bitsets(pool<root>& pop, long n) {
+    auto proot = pop.root();
+
+    flat_transaction::run(pop, [&] {
+        proot->bits = make_persistent<pbitset<root>>(pop, (int)n);
+        proot->other_bits = make_persistent<pbitset<root>>(pop, (int)n);
+    });
+
+    for (long i = 0; i < n; i += 3)
+        proot->bits->set((int)i);
+    for (long i = 0; i < n; i += 5)
+        proot->other_bits->set((int)i);
+}
+
+// Create the root ppriority_queue holding n items in scattered order.
+static void fill_pqueue(pool<root>& pop, long n) {
+    auto proot = pop.root();
+    vector<int> items(n);
+
+    for (long i = 0; i < n; i++)
+        items[i] = (int)((i * 7919) % n);
+
+    flat_transaction::run(pop, [&] {
+        proot->pq = make_persistent<ppriority_queue<int, less<int>, root>>(pop);
+    });
+
+    proot->pq->heapify(items.begin(), items.end());
+}
+
+// Get the i-th of a run of millisecond timestamps a little over a second apart.
+static int64_t timestamp(long i) {
+    return 1700000000000LL + i * 1000 + (i * 7919) % 37;
+}
+
+// Create the root pvector of 64-bit timestamps holding n items.
+static void fill_timestamps(pool<root>& pop, long n) {
+    auto proot = pop.root();
+
+    flat_transaction::run(pop, [&] {
+        proot->tsvec = make_persistent<pvector<int64_t, root>>(pop, (int)n);
+    });
+
+    proot->tsvec->batch([&] {
+        for (long i = 0; i < n; i++)
+            proot->tsvec->push_back(timestamp(i));
+    });
+}
+
+// Create the root ppackedvector holding the same n timestamps.
+static void fill_packed(pool<root>& pop, long n) {
+    auto proot = pop.root();
+    vector<int64_t> items(n);
+
+    for (long i = 0; i < n; i++)
+        items[i] = timestamp(i);
+
+    flat_transaction::run(pop, [&] {
+        proot->tspack = make_persistent<ppackedvector<int64_t, root>>(pop);
+    });
+
+    proot->tspack->append(items.begin(), items.end());
+    proot->tspack->shrink();
+}
+
+// Create the root psortedvector holding the even numbers below 2n, and the root pvector
+// holding the same, for the hand-sorted comparison.
+static void fill_sorted(pool<root>& pop, long n) {
+    auto proot = pop.root();
+    vector<int> items(n);
+
+    for (long i = 0; i < n; i++)
+        items[i] = (int)(2 * ((i * 7919) % n));
+
+    flat_transaction::run(pop, [&] {
+        proot->sorted = make_persistent<psortedvector<int, less<int>, root>>(pop);
+        proot->ivec = make_persistent<pvector<int, root>>(pop, (int)n);
+    });
+
+    proot->sorted->insert_sorted_batch(items.begin(), items.end());
+
+    proot->ivec->batch([&] {
+        for (long i = 0; i < n; i++)
+            proot->ivec->push_back((int)(2 * i));
+    });
+}
+
+// Get the i-th of a run of short, label-like strings.
+static string label(long i) {
+    return "user:" + to_string(i * 7919 % 100003) + "/item";
+}
+
+// Create the root pstring_column holding n labels.
+static void fill_column(pool<root>& pop, long n) {
+    auto proot = pop.root();
+    vector<string> items(n);
+
+    for (long i = 0; i < n; i++)
+        items[i] = label(i);
+
+    flat_transaction::run(pop, [&] {
+        proot->col = make_persistent<pstring_column<root>>(pop);
+    });
+
+    proot->col->append(items.begin(), items.end());
+}
+
+// Heap twins of the root containers, for the *_dram cases that measure what persistence
+// costs. Each fill replaces whatever the previous case left behind.
+static pvector<int, pdram>* dram_vec;
+static plist<int, pdram>* dram_list;
+static pstring<pdram>* dram_str;
+static pstring<pdram>* dram_other;
+static phashtable<int, int, pdram>* dram_hasht;
+
+// Create the heap pvector holding n items, reserving the capacity up front.
+static void fill_dram_vector(pool<root>&, long n) {
+    if (dram_vec)
+        dram_vec->destroy();
+
+    dram_vec = new pvector<int, pdram>(pdram_pool(), (int)n);
+
+    for (long i = 0; i < n; i++)
+        dram_vec->push_back((int)i);
+}
+
+// Create the heap plist holding n items.
+static void fill_dram_list(pool<root>&, long n) {
+    if (dram_list)
+        dram_list->destroy();
+
+    dram_list = new plist<int, pdram>(pdram_pool());
+
+    for (long i = 0; i < n; i++)
+        dram_list->push_back((int)i);
+}
+
+// Create the heap pstrings holding n characters.
+static void fill_dram_string(pool<root>&, long n) {
+    string s(n, 'x');
+
+    if (dram_str) {
+        dram_str->destroy();
+        dram_other->destroy();
+    }
+
+    dram_str = new pstring<pdram>(pdram_pool(), s.c_str());
+    dram_other = new pstring<pdram>(pdram_pool(), s.c_str());
+}
+
+// Create the heap phashtable holding the even keys below 2n.
+static void fill_dram_hashtable(pool<root>&, long n) {
+    if (dram_hasht)
+        dram_hasht->destroy();
+
+    dram_hasht = new phashtable<int, int, pdram>(pdram_pool());
+
+    for (long i = 0; i < n; i++)
+        dram_hasht->insert((int)i * 2, (int)i);
+}
+
+// Group-commit front ends used by the grouped cases, live only while such a case runs.
+static unique_ptr<pgroup<pvector<int, root>, root>> vector_group;
+static unique_ptr<pgroup<plist<int, root>, root>> list_group;
+
+// Read-only mapping of the pool used by the pview cases, live only while such a case runs.
+static unique_ptr<pview<root>> reader;
+
+// Fill the root pvector and phashtable, then map the pool read-only next to the writer.
+static void open_reader(pool<root>& pop, long n) {
+    fill_vector(pop, n);
+    fill_hashtable(pop, n);
+    reader.reset(new pview<root>(pool_path.c_str(), LAYOUT, &root::epoch));
+}
+
+static vector<bench_case> make_cases() {
+    vector<bench_case> cases;
+
+    /* ------------------------------- pvector ------------------------------- */
+
+    cases.push_back({"pvector", "construct", cost::linear, nullptr, nullptr,
+        [](pool<root>& pop, long) { pop.root()->ivec->destroy(); },
+        [](pool<root>& pop, long n) {
+            flat_transaction::run(pop, [&] {
+                pop.root()->ivec = make_persistent<pvector<int, root>>(pop, (int)n);
+            });
+        }, nullptr});
+    cases.push_back({"pvector", "push_back", cost::linear, fill_vector, nullptr, nullptr,
+        [](pool<root>& pop, long) { pop.root()->ivec->push_back(1); }, nullptr});
+    cases.push_back({"pvector", "push_back_x100", cost::linear, fill_vector, nullptr, nullptr,
+        [](pool<root>& pop, long) {
+            for (int i = 0; i < 100; i++)
+                pop.root()->ivec->push_back(1);
+        }, nullptr});
+    cases.push_back({"pvector", "batch_push_back_x100", cost::linear, fill_vector, nullptr, nullptr,
+        [](pool<root>& pop, long) {
+            auto v = pop.root()->ivec;
+            v->batch([&] {
+                for (int i = 0; i < 100; i++)
+                    v->push_back(1);
+            });
+        }, nullptr});
+    cases.push_back({"pvector", "grouped_push_back", cost::linear,
+        [](pool<root>& pop, long n) {
+            fill_vector(pop, n);
+            vector_group.reset(new pgroup<pvector<int, root>, root>(
+                pop, pop.root()->ivec, 1024, chrono::milliseconds(10), false));
+        }, nullptr, nullptr,
+        [](pool<root>&, long) { vector_group->push_back(1); },
+        [](pool<root>&, long) { vector_group.reset(); }});
+    cases.push_back({"pvector", "pop_back", cost::constant, fill_vector, nullptr, nullptr,
+        [](pool<root>& pop, long) { pop.root()->ivec->pop_back(); }, nullptr});
+    cases.push_back({"pvector", "insert", cost::linear, fill_vector, nullptr,
+        [](pool<root>& pop, long n) { pop.root()->ivec->remove((int)n / 2); },
+        [](pool<root>& pop, long n) { pop.root()->ivec->insert(1, (int)n / 2); }, nullptr});
+    cases.push_back({"pvector", "remove", cost::linear, fill_vector, nullptr,
+        [](pool<root>& pop, long n) { pop.root()->ivec->insert(1, (int)n / 2); },
+        [](pool<root>& pop, long n) { pop.root()->ivec->remove((int)n / 2); }, nullptr});
+    cases.push_back({"pvector", "operator[]", cost::constant, fill_vector, nullptr, nullptr,
+        [](pool<root>& pop, long n) {
+            const auto& v = *(pop.root()->ivec);
+            volatile int x = v[(int)n / 2];
+            (void)x;
+        }, nullptr});
+    cases.push_back({"pvector", "range_scan", cost::constant, fill_vector, nullptr, nullptr,
+        [](pool<root>& pop, long n) {
+            const auto& v = *(pop.root()->ivec);
+            int lo = n > 100 ? (int)n / 2 - 50 : 0;
+            int hi = lo + 100 < (int)n ? lo + 100 : (int)n;
+            volatile int x = 0;
+            for (int i = lo; i < hi; i++)
+                x = x + v[i];
+        }, nullptr});
+    cases.push_back({"pvector", "get_length", cost::constant, fill_vector, nullptr, nullptr,
+        [](pool<root>& pop, long) { volatile int x = pop.root()->ivec->get_length(); (void)x; }, nullptr});
+    cases.push_back({"pvector", "get_capacity", cost::constant, fill_vector, nullptr, nullptr,
+        [](pool<root>& pop, long) { volatile int x = pop.root()->ivec->get_capacity(); (void)x; }, nullptr});
+    cases.push_back({"pvector", "shrink", cost::linear, fill_vector,
+        [](pool<root>& pop, long) { pop.root()->ivec->push_back(1); }, nullptr,
+        [](pool<root>& pop, long) { pop.root()->ivec->shrink(); }, nullptr});
+    // each run scrambles the items untimed, then sorts them back
+    cases.push_back({"pvector", "sort", cost::linear, fill_vector,
+        [](pool<root>& pop, long) { pop.root()->ivec->sort(by_hash); }, nullptr,
+        [](pool<root>& pop, long) { pop.root()->ivec->sort(); }, nullptr});
+    cases.push_back({"pvector", "stable_sort", cost::linear, fill_vector,
+        [](pool<root>& pop, long) { pop.root()->ivec->sort(by_hash); }, nullptr,
+        [](pool<root>& pop, long) { pop.root()->ivec->stable_sort(); }, nullptr});
+    cases.push_back({"pvector", "clear", cost::rebuild, nullptr, fill_vector,
+        [](pool<root>& pop, long) { pop.root()->ivec->destroy(); },
+        [](pool<root>& pop, long) { pop.root()->ivec->clear(); }, nullptr});
+    cases.push_back({"pvector", "destroy", cost::rebuild, nullptr, fill_vector, nullptr,
+        [](pool<root>& pop, long) { pop.root()->ivec->destroy(); }, nullptr});
+    cases.push_back({"pvector", "refresh_pool", cost::constant, fill_vector, nullptr, nullptr,
+        [](pool<root>& pop, long) { pop.root()->ivec->refresh_pool(pop); }, nullptr});
+    cases.push_back({"pvector", "operator<<", cost::linear, fill_vector, nullptr, nullptr,
+        [](pool<root>& pop, long) { null_out << *(pop.root()->ivec); }, nullptr});
+    cases.push_back({"pvector", "dump", cost::linear, fill_vector, nullptr, nullptr,
+        [](pool<root>& pop, long) {
+            pdump_sink sink(null_fd);
+            pop.root()->ivec->dump(sink);
+        }, nullptr});
+    cases.push_back({"pvector", "dump_x4", cost::linear, fill_vector, nullptr, nullptr,
+        [](pool<root>& pop, long) {
+            pdump_sink sink(null_fd);
+            pop.root()->ivec->dump(sink, 4);
+        }, nullptr});
+
+    /* -------------------------------- plist -------------------------------- */
+
+    cases.push_back({"plist", "construct", cost::constant, nullptr, nullptr,
+        [](pool<root>& pop, long) { pop.root()->ilist->destroy(); },
+        [](pool<root>& pop, long) {
+            flat_transaction::run(pop, [&] {
+                pop.root()->ilist = make_persistent<plist<int, root>>(pop);
+            });
+        }, nullptr});
+    cases.push_back({"plist", "push_back", cost::constant, fill_list, nullptr, nullptr,
+        [](pool<root>& pop, long) { pop.root()->ilist->push_back(1); }, nullptr});
+    cases.push_back({"plist", "push_back_x100", cost::constant, fill_list, nullptr, nullptr,
+        [](pool<root>& pop, long) {
+            for (int i = 0; i < 100; i++)
+                pop.root()->ilist->push_back(1);
+        }, nullptr});
+    cases.push_back({"plist", "batch_push_back_x100", cost::constant, fill_list, nullptr, nullptr,
+        [](pool<root>& pop, long) {
+            auto l = pop.root()->ilist;
+            l->batch([&] {
+                for (int i = 0; i < 100; i++)
+                    l->push_back(1);
+            });
+        }, nullptr});
+    cases.push_back({"plist", "grouped_push_back", cost::constant,
+        [](pool<root>& pop, long n) {
+            fill_list(pop, n);
+            list_group.reset(new pgroup<plist<int, root>, root>(
+                pop, pop.root()->ilist, 1024, chrono::milliseconds(10), false));
+        }, nullptr, nullptr,
+        [](pool<root>&, long) { list_group->push_back(1); },
+        [](pool<root>&, long) { list_group.reset(); }});
+    cases.push_back({"plist", "pop_back", cost::linear, fill_list, nullptr, nullptr,
+        [](pool<root>& pop, long) { pop.root()->ilist->pop_back(); }, nullptr});
+    cases.push_back({"plist", "push_front", cost::constant, fill_list, nullptr, nullptr,
+        [](pool<root>& pop, long) { pop.root()->ilist->push_front(1); }, nullptr});
+    cases.push_back({"plist", "pop_front", cost::constant, fill_list, nullptr, nullptr,
+        [](pool<root>& pop, long) { pop.root()->ilist->pop_front(); }, nullptr});
+    cases.push_back({"plist", "insert", cost::linear, fill_list, nullptr,
+        [](pool<root>& pop, long n) { pop.root()->ilist->remove((int)n / 2); },
+        [](pool<root>& pop, long n) { pop.root()->ilist->insert(1, (int)n / 2); }, nullptr});
+    cases.push_back({"plist", "remove", cost::linear, fill_list, nullptr,
+        [](pool<root>& pop, long n) { pop.root()->ilist->insert(1, (int)n / 2); },
+        [](pool<root>& pop, long n) { pop.root()->ilist->remove((int)n / 2); }, nullptr});
+    cases.push_back({"plist", "operator[]", cost::linear, fill_list, nullptr, nullptr,
+        [](pool<root>& pop, long n) { volatile int x = (*pop.root()->ilist)[(int)n / 2]; (void)x; }, nullptr});
+    cases.push_back({"plist", "for_each", cost::linear, fill_list, nullptr, nullptr,
+        [](pool<root>& pop, long) {
+            volatile int x = 0;
+            pop.root()->ilist->for_each([&](int v) { x = x + v; });
+        }, nullptr});
+    cases.push_back({"plist", "relayout", cost::linear, fill_list, nullptr, nullptr,
+        [](pool<root>& pop, long) { pop.root()->ilist->relayout(); }, nullptr});
+    cases.push_back({"plist", "get_length", cost::constant, fill_list, nullptr, nullptr,
+        [](pool<root>& pop, long) { volatile int x = pop.root()->ilist->get_length(); (void)x; }, nullptr});
+    cases.push_back({"plist", "is_empty", cost::constant, fill_list, nullptr, nullptr,
+        [](pool<root>& pop, long) { volatile bool x = pop.root()->ilist->is_empty(); (void)x; }, nullptr});
+    cases.push_back({"plist", "clear", cost::rebuild, nullptr, fill_list,
+        [](pool<root>& pop, long) { pop.root()->ilist->destroy(); },
+        [](pool<root>& pop, long) { pop.root()->ilist->clear(); }, nullptr});
+    cases.push_back({"plist", "destroy", cost::rebuild, nullptr, fill_list, nullptr,
+        [](pool<root>& pop, long) { pop.root()->ilist->destroy(); }, nullptr});
+    // clear_deferred only detaches the nodes, and reclaim is the time to free them after
+    cases.push_back({"plist", "clear_deferred", cost::rebuild, make_trash, fill_list,
+        [](pool<root>& pop, long) {
+            pop.root()->ilist->destroy();
+            pop.root()->trash->reclaim_all();
+        },
+        [](pool<root>& pop, long) { pop.root()->ilist->clear(*pop.root()->trash); }, nullptr});
+    cases.push_back({"plist", "reclaim", cost::rebuild, make_trash,
+        [](pool<root>& pop, long n) {
+            fill_list(pop, n);
+            pop.root()->ilist->destroy(*pop.root()->trash);
+        }, nullptr,
+        [](pool<root>& pop, long) { pop.root()->trash->reclaim_all(); }, nullptr});
+    cases.push_back({"plist", "refresh_pool", cost::linear, fill_list, nullptr, nullptr,
+        [](pool<root>& pop, long) { pop.root()->ilist->refresh_pool(pop); }, nullptr});
+    cases.push_back({"plist", "operator<<", cost::linear, fill_list, nullptr, nullptr,
+        [](pool<root>& pop, long) { null_out << *(pop.root()->ilist); }, nullptr});
+    cases.push_back({"plist", "dump", cost::linear, fill_list, nullptr, nullptr,
+        [](pool<root>& pop, long) {
+            pdump_sink sink(null_fd);
+            pop.root()->ilist->dump(sink);
+        }, nullptr});
+
+    /* ------------------------------- pstring ------------------------------- */
+
+    cases.push_back({"pstring", "construct", cost::linear, nullptr, nullptr,
+        [](pool<root>& pop, long) { pop.root()->pstr->destroy(); },
+        [](pool<root>& pop, long n) {
+            string s(n, 'x');
+            flat_transaction::run(pop, [&] {
+                pop.root()->pstr = make_persistent<pstring<root>>(pop, s.c_str());
+            });
+        }, nullptr});
+    cases.push_back({"pstring", "operator[]", cost::constant, fill_string, nullptr, nullptr,
+        [](pool<root>& pop, long n) { volatile char c = (*pop.root()->pstr)[(int)n / 2]; (void)c; }, nullptr});
+    cases.push_back({"pstring", "operator+=", cost::linear, fill_string, nullptr, nullptr,
+        [](pool<root>& pop, long) { *(pop.root()->pstr) += *(pop.root()->other); }, nullptr});
+    cases.push_back({"pstring", "operator=", cost::linear, fill_string, nullptr, nullptr,
+        [](pool<root>& pop, long) { *(pop.root()->pstr) = *(pop.root()->other); }, nullptr});
+    cases.push_back({"pstring", "get_length", cost::constant, fill_string, nullptr, nullptr,
+        [](pool<root>& pop, long) { volatile int x = pop.root()->pstr->get_length(); (void)x; }, nullptr});
+    cases.push_back({"pstring", "get_capacity", cost::constant, fill_string, nullptr, nullptr,
+        [](pool<root>& pop, long) { volatile int x = pop.root()->pstr->get_capacity(); (void)x; }, nullptr});
+    cases.push_back({"pstring", "is_empty", cost::constant, fill_string, nullptr, nullptr,
+        [](pool<root>& pop, long) { volatile bool x = pop.root()->pstr->is_empty(); (void)x; }, nullptr});
+    cases.push_back({"pstring", "destroy", cost::linear, nullptr, fill_string, nullptr,
+        [](pool<root>& pop, long) { pop.root()->pstr->destroy(); }, nullptr});
+    cases.push_back({"pstring", "refresh_pool", cost::constant, fill_string, nullptr, nullptr,
+        [](pool<root>& pop, long) { pop.root()->pstr->refresh_pool(pop); }, nullptr});
+    cases.push_back({"pstring", "operator<<", cost::linear, fill_string, nullptr, nullptr,
+        [](pool<root>& pop, long) { null_out << *(pop.root()->pstr); }, nullptr});
+    cases.push_back({"pstring", "dump", cost::linear, fill_string, nullptr, nullptr,
+        [](pool<root>& pop, long) {
+            pdump_sink sink(null_fd);
+            pop.root()->pstr->dump(sink);
+        }, nullptr});
+
+    /* ------------------------------ phashtable ----------------------------- */
+
+    cases.push_back({"phashtable", "construct", cost::constant, nullptr, nullptr, nullptr,
+        [](pool<root>& pop, long) {
+            flat_transaction::run(pop, [&] {
+                pop.root()->hasht = make_persistent<phashtable<int, int, root>>(pop);
+            });
+        }, nullptr});
+    cases.push_back({"phashtable", "refresh_pool", cost::constant,
+        [](pool<root>& pop, long) {
+            flat_transaction::run(pop, [&] {
+                pop.root()->hasht = make_persistent<phashtable<int, int, root>>(pop);
+            });
+        }, nullptr, nullptr,
+        [](pool<root>& pop, long) { pop.root()->hasht->refresh_pool(pop); }, nullptr});
+    cases.push_back({"phashtable", "insert", cost::constant, fill_hashtable, nullptr,
+        [](pool<root>& pop, long n) { pop.root()->hasht->remove((int)n | 1); },
+        [](pool<root>& pop, long n) { pop.root()->hasht->insert((int)n | 1, 1); }, nullptr});
+    cases.push_back({"phashtable", "get", cost::constant, fill_hashtable, nullptr, nullptr,
+        [](pool<root>& pop, long n) { volatile int x = pop.root()->hasht->get((int)n & ~1); (void)x; }, nullptr});
+    // each run replaces the table built by the run before it
+    cases.push_back({"phashtable", "build_from", cost::rebuild, make_build_input, nullptr, nullptr,
+        [](pool<root>& pop, long) {
+            pop.root()->hasht->build_from(build_input.begin(), build_input.end());
+        }, nullptr});
+    cases.push_back({"phashtable", "build_from_1", cost::rebuild, make_build_input, nullptr, nullptr,
+        [](pool<root>& pop, long) {
+            pop.root()->hasht->build_from(build_input.begin(), build_input.end(), 1);
+        }, nullptr});
+    cases.push_back({"phashtable", "clear", cost::rebuild, nullptr, fill_hashtable,
+        [](pool<root>& pop, long) { pop.root()->hasht->destroy(); },
+        [](pool<root>& pop, long) { pop.root()->hasht->clear(); }, nullptr});
+    cases.push_back({"phashtable", "clear_deferred", cost::rebuild, make_trash, fill_hashtable,
+        [](pool<root>& pop, long) {
+            pop.root()->hasht->destroy();
+            pop.root()->trash->reclaim_all();
+        },
+        [](pool<root>& pop, long) { pop.root()->hasht->clear(*pop.root()->trash); }, nullptr});
+    cases.push_back({"phashtable", "destroy_deferred", cost::rebuild, make_trash, fill_hashtable,
+        [](pool<root>& pop, long) { pop.root()->trash->reclaim_all(); },
+        [](pool<root>& pop, long) { pop.root()->hasht->destroy(*pop.root()->trash); }, nullptr});
+
+    /* -------------------------- allocation classes ------------------------- */
+
+    // the same ops with the nodes allocated from classes of their exact size (see palloc);
+    // pool_bytes / size against plist and phashtable gives the bytes per node saved
+    cases.push_back({"plist_classed", "push_back", cost::constant,
+        [](pool<root>& pop, long n) {
+            plist<int, root>::register_classes(pop);
+            fill_list(pop, n);
+        }, nullptr, nullptr,
+        [](pool<root>& pop, long) { pop.root()->ilist->push_back(1); }, nullptr});
+    cases.push_back({"phashtable_classed", "insert", cost::constant,
+        [](pool<root>& pop, long n) {
+            phashtable<int, int, root>::register_classes(pop);
+            fill_hashtable(pop, n);
+        }, nullptr,
+        [](pool<root>& pop, long n) { pop.root()->hasht->remove((int)n | 1); },
+        [](pool<root>& pop, long n) { pop.root()->hasht->insert((int)n | 1, 1); }, nullptr});
+
+    /* ------------------------------- pbtree -------------------------------- */
+
+    cases.push_back({"pbtree", "insert", cost::constant, fill_btree, nullptr,
+        [](pool<root>& pop, long n) { pop.root()->btree->erase((int)n | 1); },
+        [](pool<root>& pop, long n) { pop.root()->btree->insert((int)n | 1, 1); }, nullptr});
+    cases.push_back({"pbtree", "erase", cost::constant, fill_btree, nullptr,
+        [](pool<root>& pop, long n) { pop.root()->btree->insert((int)n & ~1, 1); },
+        [](pool<root>& pop, long n) { pop.root()->btree->erase((int)n & ~1); }, nullptr});
+    cases.push_back({"pbtree", "find", cost::constant, fill_btree, nullptr, nullptr,
+        [](pool<root>& pop, long n) { volatile int x = pop.root()->btree->get((int)n & ~1); (void)x; }, nullptr});
+    cases.push_back({"pbtree", "range_scan", cost::constant, fill_btree, nullptr, nullptr,
+        [](pool<root>& pop, long n) {
+            const auto& t = *(pop.root()->btree);
+            int seen = 0;
+            volatile int x = 0;
+            for (auto it = t.lower_bound((int)n - 100); it != t.end() && seen < 100; ++it, seen++)
+                x = x + it.value();
+        }, nullptr});
+    cases.push_back({"pbtree", "clear", cost::rebuild, nullptr, fill_btree,
+        [](pool<root>& pop, long) { pop.root()->btree->destroy(); },
+        [](pool<root>& pop, long) { pop.root()->btree->clear(); }, nullptr});
+
+
+    /* -------------------------------- pring -------------------------------- */
+
+    cases.push_back({"pring", "enqueue", cost::constant, fill_ring, nullptr,
+        [](pool<root>& pop, long) { int x; pop.root()->ring->dequeue(x); },
+        [](pool<root>& pop, long) { pop.root()->ring->enqueue(1); }, nullptr});
+    cases.push_back({"pring", "dequeue", cost::constant, fill_ring,
+        [](pool<root>& pop, long) { pop.root()->ring->enqueue(1); }, nullptr,
+        [](pool<root>& pop, long) { int x; pop.root()->ring->dequeue(x); }, nullptr});
+    cases.push_back({"pring", "enqueue_x100", cost::constant, fill_ring, nullptr,
+        [](pool<root>& pop, long) {
+            int x[100];
+            pop.root()->ring->dequeue(x, 100);
+        },
+        [](pool<root>& pop, long) {
+            for (int i = 0; i < 100; i++)
+                pop.root()->ring->enqueue(1);
+        }, nullptr});
+    cases.push_back({"pring", "batch_enqueue_x100", cost::constant, fill_ring, nullptr,
+        [](pool<root>& pop, long) {
+            int x[100];
+            pop.root()->ring->dequeue(x, 100);
+        },
+        [](pool<root>& pop, long) {
+            int x[100] = {};
+            pop.root()->ring->enqueue(x, 100);
+        }, nullptr});
+
+    /* ------------------------------- pbitset ------------------------------- */
+
+    cases.push_back({"pbitset", "set", cost::constant, fill_bitsets, nullptr, nullptr,
+        [](pool<root>& pop, long n) { pop.root()->bits->set((int)n / 2); }, nullptr});
+    cases.push_back({"pbitset", "test", cost::constant, fill_bitsets, nullptr, nullptr,
+        [](pool<root>& pop, long n) { volatile bool x = pop.root()->bits->test((int)n / 2); (void)x; }, nullptr});
+    cases.push_back({"pbitset", "count", cost::linear, fill_bitsets, nullptr, nullptr,
+        [](pool<root>& pop, long) { volatile int x = pop.root()->bits->count(); (void)x; }, nullptr});
+    cases.push_back({"pbitset", "rank", cost::linear, fill_bitsets, nullptr, nullptr,
+        [](pool<root>& pop, long n) { volatile int x = pop.root()->bits->rank((int)n); (void)x; }, nullptr});
+    cases.push_back({"pbitset", "find_next", cost::constant, fill_bitsets, nullptr, nullptr,
+        [](pool<root>& pop, long n) { volatile int x = pop.root()->bits->find_next((int)n / 2); (void)x; }, nullptr});
+    cases.push_back({"pbitset", "operator|=", cost::linear, fill_bitsets, nullptr, nullptr,
+        [](pool<root>& pop, long) { *(pop.root()->bits) |= *(pop.root()->other_bits); }, nullptr});
+
+    /* --------------------------- ppriority_queue --------------------------- */
+
+    cases.push_back({"ppriority_queue", "push", cost::constant, fill_pqueue, nullptr,
+        [](pool<root>& pop, long) { pop.root()->pq->pop(); },
+        [](pool<root>& pop, long n) { pop.root()->pq->push((int)n / 2); }, nullptr});
+    cases.push_back({"ppriority_queue", "pop", cost::constant, fill_pqueue, nullptr,
+        [](pool<root>& pop, long n) { pop.root()->pq->push((int)n / 2); },
+        [](pool<root>& pop, long) { pop.root()->pq->pop(); }, nullptr});
+    cases.push_back({"ppriority_queue", "top", cost::constant, fill_pqueue, nullptr, nullptr,
+        [](pool<root>& pop, long) { volatile int x = pop.root()->pq->top(); (void)x; }, nullptr});
+    cases.push_back({"ppriority_queue", "push_many_x100", cost::constant, fill_pqueue, nullptr,
+        [](pool<root>& pop, long) {
+            for (int i = 0; i < 100; i++)
+                pop.root()->pq->pop();
+        },
+        [](pool<root>& pop, long) {
+            int x[100];
+            for (int i = 0; i < 100; i++)
+                x[i] = i * 31;
+            pop.root()->pq->push_many(x, x + 100);
+        }, nullptr});
+    cases.push_back({"ppriority_queue", "heapify", cost::linear, fill_pqueue, nullptr, nullptr,
+        [](pool<root>& pop, long n) {
+            vector<int> items(n);
+            for (long i = 0; i < n; i++)
+                items[i] = (int)i;
+            pop.root()->pq->heapify(items.begin(), items.end());
+        }, nullptr});
+
+    /* ---------------------------- ppackedvector ---------------------------- */
+
+    // pool_bytes of the scan cases compares the footprints of the same timestamps, and
+    // size * ops_per_sec of scan is the decode throughput in values per second
+    cases.push_back({"pvector_i64", "scan", cost::linear, fill_timestamps, nullptr, nullptr,
+        [](pool<root>& pop, long n) {
+            const auto& v = *(pop.root()->tsvec);
+            volatile int64_t x = 0;
+            int64_t sum = 0;
+            for (int i = 0; i < (int)n; i++)
+                sum += v[i];
+            x = sum;
+            (void)x;
+        }, nullptr});
+    cases.push_back({"ppackedvector", "scan", cost::linear, fill_packed, nullptr, nullptr,
+        [](pool<root>& pop, long) {
+            volatile int64_t x = 0;
+            int64_t sum = 0;
+            pop.root()->tspack->for_each([&](int64_t v) { sum += v; });
+            x = sum;
+            (void)x;
+        }, nullptr});
+    cases.push_back({"ppackedvector", "decode_block", cost::constant, fill_packed, nullptr, nullptr,
+        [](pool<root>& pop, long n) {
+            int64_t vals[PPACKED_BLOCK];
+            auto v = pop.root()->tspack;
+            volatile int x = v->decode_block((int)(n / 2 / PPACKED_BLOCK), vals);
+            (void)x;
+        }, nullptr});
+    cases.push_back({"ppackedvector", "operator[]", cost::constant, fill_packed, nullptr, nullptr,
+        [](pool<root>& pop, long n) { volatile int64_t x = (*pop.root()->tspack)[(int)n / 2]; (void)x; }, nullptr});
+    cases.push_back({"ppackedvector", "push_back", cost::constant, fill_packed, nullptr, nullptr,
+        [](pool<root>& pop, long n) { pop.root()->tspack->push_back(timestamp(n)); }, nullptr});
+
+    /* ---------------------------- psortedvector ---------------------------- */
+
+    // pvector_sorted::insert is the hand-rolled way, a linear search and then an insert
+    cases.push_back({"pvector_sorted", "insert", cost::linear, fill_sorted, nullptr,
+        [](pool<root>& pop, long n) { pop.root()->ivec->remove((int)n / 2); },
+        [](pool<root>& pop, long n) {
+            auto v = pop.root()->ivec;
+            int idx = 0;
+            while (idx < v->get_length() && (*v)[idx] <= (int)n)
+                idx++;
+            v->insert((int)n, idx);
+        }, nullptr});
+    cases.push_back({"psortedvector", "insert", cost::linear, fill_sorted, nullptr,
+        [](pool<root>& pop, long n) { pop.root()->sorted->erase((int)n); },
+        [](pool<root>& pop, long n) { pop.root()->sorted->insert((int)n); }, nullptr});
+    cases.push_back({"psortedvector", "insert_sorted_batch_x100", cost::linear, fill_sorted, nullptr,
+        [](pool<root>& pop, long n) {
+            for (int i = 0; i < 100; i++)
+                pop.root()->sorted->erase((int)((i * 2 * n / 100) | 1));
+        },
+        [](pool<root>& pop, long n) {
+            int x[100];
+            for (int i = 0; i < 100; i++)
+                x[i] = (int)((i * 2 * n / 100) | 1);
+            pop.root()->sorted->insert_sorted_batch(x, x + 100);
+        }, nullptr});
+    cases.push_back({"psortedvector", "lower_bound", cost::constant, fill_sorted, nullptr, nullptr,
+        [](pool<root>& pop, long n) { volatile int x = pop.root()->sorted->lower_bound((int)n); (void)x; }, nullptr});
+    cases.push_back({"psortedvector", "contains", cost::constant, fill_sorted, nullptr, nullptr,
+        [](pool<root>& pop, long n) { volatile bool x = pop.root()->sorted->contains((int)n + 1); (void)x; }, nullptr});
+
+    /* ---------------------------- pstring_column --------------------------- */
+
+    cases.push_back({"pstring_column", "push_back", cost::constant, fill_column, nullptr, nullptr,
+        [](pool<root>& pop, long n) { pop.root()->col->push_back(label(n)); }, nullptr});
+    cases.push_back({"pstring_column", "append_x100", cost::constant, fill_column, nullptr, nullptr,
+        [](pool<root>& pop, long n) {
+            string x[100];
+            for (int i = 0; i < 100; i++)
+                x[i] = label(n + i);
+            pop.root()->col->append(x, x + 100);
+        }, nullptr});
+    cases.push_back({"pstring_column", "operator[]", cost::constant, fill_column, nullptr, nullptr,
+        [](pool<root>& pop, long n) { volatile size_t x = (*pop.root()->col)[(int)n / 2].size(); (void)x; }, nullptr});
+    cases.push_back({"pstring_column", "scan", cost::linear, fill_column, nullptr, nullptr,
+        [](pool<root>& pop, long) {
+            volatile size_t x = 0;
+            size_t sum = 0;
+            pop.root()->col->for_each([&](string_view s) { sum += s.size(); });
+            x = sum;
+            (void)x;
+        }, nullptr});
+    // each run squeezes out one string, pushed and erased just before
+    cases.push_back({"pstring_column", "compact", cost::linear, fill_column,
+        [](pool<root>& pop, long n) {
+            auto c = pop.root()->col;
+            c->erase(c->push_back(label(n)));
+        },
+        nullptr,
+        [](pool<root>& pop, long) { pop.root()->col->compact(); }, nullptr});
+
+    /* -------------------------------- pview -------------------------------- */
+
+    cases.push_back({"pview", "vector_sum", cost::linear, open_reader, nullptr, nullptr,
+        [](pool<root>&, long) {
+            volatile long x = 0;
+            long sum = 0;
+            reader->read([&] {
+                sum = 0;
+                for (int v : reader->view(reader->root().ivec))
+                    sum += v;
+            });
+            x = sum;
+            (void)x;
+        },
+        [](pool<root>&, long) { reader.reset(); }});
+    cases.push_back({"pview", "hashtable_get", cost::constant, open_reader, nullptr, nullptr,
+        [](pool<root>&, long n) {
+            volatile int x = 0;
+            reader->read([&] { x = reader->view(reader->root().hasht).get((int)n & ~1); });
+            (void)x;
+        },
+        [](pool<root>&, long) { reader.reset(); }});
+    // what a reader pays to notice a new epoch and take its views again
+    cases.push_back({"pview", "refresh", cost::constant, open_reader,
+        [](pool<root>& pop, long) { pop.root()->epoch.write(pop, [] {}); }, nullptr,
+        [](pool<root>&, long) {
+            volatile int x = 0;
+            reader->read([&] {
+                x = reader->view(reader->root().ivec).get_length()
+                  + reader->view(reader->root().hasht).get_length();
+            });
+            (void)x;
+        },
+        [](pool<root>&, long) { reader.reset(); }});
+    cases.push_back({"pepoch", "write", cost::constant, nullptr, nullptr, nullptr,
+        [](pool<root>& pop, long) { pop.root()->epoch.write(pop, [] {}); }, nullptr});
+
+    /* ---------------------------- heap twins ----------------------------- */
+
+    cases.push_back({"pvector_dram", "push_back", cost::linear, fill_dram_vector, nullptr, nullptr,
+        [](pool<root>&, long) { dram_vec->push_back(1); }, nullptr});
+    cases.push_back({"pvector_dram", "insert", cost::linear, fill_dram_vector, nullptr,
+        [](pool<root>&, long n) { dram_vec->remove((int)n / 2); },
+        [](pool<root>&, long n) { dram_vec->insert(1, (int)n / 2); }, nullptr});
+    cases.push_back({"pvector_dram", "sort", cost::linear, fill_dram_vector,
+        [](pool<root>&, long) { dram_vec->sort(by_hash); }, nullptr,
+        [](pool<root>&, long) { dram_vec->sort(); }, nullptr});
+    cases.push_back({"pvector_dram", "operator[]", cost::constant, fill_dram_vector, nullptr, nullptr,
+        [](pool<root>&, long n) {
+            const auto& v = *dram_vec;
+            volatile int x = v[(int)n / 2];
+            (void)x;
+        }, nullptr});
+    cases.push_back({"plist_dram", "push_back", cost::constant, fill_dram_list, nullptr, nullptr,
+        [](pool<root>&, long) { dram_list->push_back(1); }, nullptr});
+    cases.push_back({"plist_dram", "pop_front", cost::constant, fill_dram_list, nullptr, nullptr,
+        [](pool<root>&, long) { dram_list->pop_front(); }, nullptr});
+    cases.push_back({"pstring_dram", "operator+=", cost::linear, fill_dram_string, nullptr, nullptr,
+        [](pool<root>&, long) { *dram_str += *dram_other; }, nullptr});
+    cases.push_back({"phashtable_dram", "insert", cost::constant, fill_dram_hashtable, nullptr,
+        [](pool<root>&, long n) { dram_hasht->remove((int)n | 1); },
+        [](pool<root>&, long n) { dram_hasht->insert((int)n | 1, 1); }, nullptr});
+    cases.push_back({"phashtable_dram", "get", cost::constant, fill_dram_hashtable, nullptr, nullptr,
+        [](pool<root>&, long n) { volatile int x = dram_hasht->get((int)n & ~1); (void)x; }, nullptr});
+
+    return cases;
+}
+
+/* ========================================================================= */
+/* ********************************* main ********************************** */
+/* ========================================================================= */
+
+static void usage(const char* prog) {
+    cerr << "Usage: " << prog << " [options]" << endl
+         << "  --pool-dir DIR     directory for the per-case pool file (default .)" << endl
+         << "  --min N            smallest container size (default 10)" << endl
+         << "  --max N            largest container size, stepping by 10x (default 10000000)" << endl
+         << "  --ops N            samples for O(1) operations (default 10000)" << endl
+         << "  --linear-ops N     samples for O(n) operations (default 100)" << endl
+         << "  --rebuild-ops N    samples for operations that rebuild the container (default 5)" << endl
+         << "  --pool-mb N        fixed pool size in MB (default scales with size)" << endl
+         << "  --filter STR       only run cases whose container/op contains STR" << endl
+         << "  --format csv|json  output format (default csv)" << endl
+         << "  --stats            dump pstats counters per case to stderr (needs STATS=1)" << endl
+         << endl
+         << "Set PMEM_IS_PMEM_FORCE=1 to emulate pmem when the pool dir is on tmpfs or a" << endl
+         << "regular filesystem." << endl;
+}
+
+int main(int argc, char** argv) {
+    bench_config cfg;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_val = i + 1 < argc;
+
+        if (arg == "--pool-dir" && has_val)
+            cfg.pool_dir = argv[++i];
+        else if (arg == "--min" && has_val)
+            cfg.min_size = atol(argv[++i]);
+        else if (arg == "--max" && has_val)
+            cfg.max_size = atol(argv[++i]);
+        else if (arg == "--ops" && has_val)
+            cfg.ops = atol(argv[++i]);
+        else if (arg == "--linear-ops" && has_val)
+            cfg.linear_ops = atol(argv[++i]);
+        else if (arg == "--rebuild-ops" && has_val)
+            cfg.rebuild_ops = atol(argv[++i]);
+        else if (arg == "--pool-mb" && has_val)
+            cfg.pool_size = (size_t)atol(argv[++i]) * 1024 * 1024;
+        else if (arg == "--filter" && has_val)
+            cfg.filter = argv[++i];
+        else if (arg == "--format" && has_val)
+            cfg.format = argv[++i];
+        else if (arg == "--stats")
+            cfg.stats = true;
+        else {
+            usage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (cfg.min_size < 1 || cfg.max_size < cfg.min_size) {
+        cerr << "Sizes must satisfy 1 <= --min <= --max." << endl;
+        return 1;
+    }
+
+    // let a long run be dumped or reset with SIGUSR1/SIGUSR2 too
+    if (cfg.stats)
+        pstats::install_signal_handlers();
+
+    auto cases = make_cases();
+    bool first = true;
+
+    if (cfg.format == "json")
+        printf("[\n");
+    else
+        printf("container,op,size,ops,ops_per_sec,ns_per_op,p50_ns,p99_ns,pool_bytes\n");
+
+    for (const auto& bc : cases) {
+        string name = string(bc.container) + "::" + bc.op;
+        if (!cfg.filter.empty() && name.find(cfg.filter) == string::npos)
+            continue;
+
+        for (long n = cfg.min_size; n <= cfg.max_size; n *= 10) {
+            print_result(cfg, run_case(cfg, bc, n), first);
+            first = false;
+        }
+    }
+
+    if (cfg.format == "json")
+        printf("\n]\n");
+
+    return 0;
+}
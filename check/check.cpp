@@ -0,0 +1,87 @@
+// basic imports
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+// PMDK imports
+#include <libpmemobj++/pool.hpp>
+// local collection imports
+#include "../plist/plist.h"
+#include "../pvector/pvector.h"
+#include "../pstring/pstring.h"
+#include "../phashtable/phashtable.h"
+#include "../pcheck/pcheck.h"
+#include "../pview/pview.h"
+
+#define PMFILE "pool"
+#define LAYOUT "LISTPOOL"
+
+using namespace pmem;
+using namespace pmem::obj;
+using namespace std;
+
+// must match the root in driver.cpp, whose pool this checks
+class root {
+public:
+    persistent_ptr<plist<int, root>> ilist;
+    persistent_ptr<pvector<double, root>> dvec;
+    persistent_ptr<pstring<root>> pstr;
+    persistent_ptr<phashtable<double, int, root>> hasht;
+    pepoch epoch;
+};
+
+// Print how to call this program.
+static void usage(const char* prog) {
+    cerr << "usage: " << prog << " [--pool PATH] [--threads N]" << endl
+         << "Checks every container in the driver's pool and prints their sizes." << endl
+         << "Exits with 1 if any container is broken, 2 if the pool cannot be opened." << endl;
+}
+
+int main(int argc, char** argv) {
+    string path = PMFILE;
+    int threads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_val = i + 1 < argc;
+
+        if (arg == "--pool" && has_val)
+            path = argv[++i];
+        else if (arg == "--threads" && has_val)
+            threads = atoi(argv[++i]);
+        else {
+            usage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+
+    pool<root> pop;
+
+    try {
+        pop = pool<root>::open(path, LAYOUT);
+    }
+    catch (const exception& e) {
+        cerr << "Cannot open " << path << ": " << e.what() << endl;
+        return 2;
+    }
+
+    auto proot = pop.root();
+    pcheck checker(threads);
+
+    // containers the driver has not created yet are simply skipped
+    if (proot->ilist != nullptr)
+        checker.add("ilist", *proot->ilist);
+    if (proot->dvec != nullptr)
+        checker.add("dvec", *proot->dvec);
+    if (proot->pstr != nullptr)
+        checker.add("pstr", *proot->pstr);
+    if (proot->hasht != nullptr)
+        checker.add("hasht", *proot->hasht);
+
+    checker.run();
+    checker.report(cout);
+
+    pop.close();
+
+    return checker.is_ok() ? 0 : 1;
+}
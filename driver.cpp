@@ -10,6 +10,7 @@
 #include "pvector/pvector.h"
 #include "pstring/pstring.h"
 #include "phashtable/phashtable.h"
+#include "pview/pview.h"
 
 #define POOLSIZE ((size_t)(1024 * 1024 * 256)) // 256 MB
 #define PMFILE "pool"
@@ -25,6 +26,8 @@ public:
     persistent_ptr<pvector<double, root>> dvec;
     persistent_ptr<pstring<root>> pstr;
     persistent_ptr<phashtable<double, int, root>> hasht;
+    // moved around every change, so read-only views can tell when to retry (see pview)
+    pepoch epoch;
 };
 
 int main() {
@@ -43,23 +46,25 @@ int main() {
 
     // if the first access, populate the list & vector w/ items
     if (first_access) {
-        flat_transaction::run(pop, [&] { 
-            proot->ilist = make_persistent<plist<int, root>>(pop);
-            proot->ilist->push_back(0);
-            proot->ilist->push_back(1);
-            proot->ilist->push_back(2);
-
-            proot->dvec = make_persistent<pvector<double, root>>(pop);
-            proot->dvec->push_back(2);
-            proot->dvec->push_back(4);
-            proot->dvec->push_back(6);
-            proot->dvec->push_back(8);
-            proot->dvec->push_back(10);
-            proot->dvec->push_back(12);
-
-            proot->pstr = make_persistent<pstring<root>>(pop, "what's up");
-
-            proot->hasht = make_persistent<phashtable<double, int, root>>(pop);
+        proot->epoch.write(pop, [&] {
+            flat_transaction::run(pop, [&] { 
+                proot->ilist = make_persistent<plist<int, root>>(pop);
+                proot->ilist->push_back(0);
+                proot->ilist->push_back(1);
+                proot->ilist->push_back(2);
+
+                proot->dvec = make_persistent<pvector<double, root>>(pop);
+                proot->dvec->push_back(2);
+                proot->dvec->push_back(4);
+                proot->dvec->push_back(6);
+                proot->dvec->push_back(8);
+                proot->dvec->push_back(10);
+                proot->dvec->push_back(12);
+
+                proot->pstr = make_persistent<pstring<root>>(pop, "what's up");
+
+                proot->hasht = make_persistent<phashtable<double, int, root>>(pop);
+            });
         });
 
         cout << ">>> LIST <<<" << endl << endl;
@@ -80,81 +85,87 @@ int main() {
         proot->pstr->refresh_pool(pop);
         proot->hasht->refresh_pool(pop);
 
-        cout << ">>> LIST <<<" << endl << endl;
+        // a crash part way through the last run's changes would leave readers waiting
+        proot->epoch.reset(pop);
+
+        // readers retry around everything below as one change
+        proot->epoch.write(pop, [&] {
+            cout << ">>> LIST <<<" << endl << endl;
 
-        cout << "Before popping" << endl;
-        cout << *(proot->ilist) << endl << endl;
+            cout << "Before popping" << endl;
+            cout << *(proot->ilist) << endl << endl;
 
-        int val = proot->ilist->pop_back();
+            int val = proot->ilist->pop_back();
 
-        cout << "After popping" << endl;
-        cout << *(proot->ilist) << endl << endl;
+            cout << "After popping" << endl;
+            cout << *(proot->ilist) << endl << endl;
 
-        proot->ilist->push_back(val);
+            proot->ilist->push_back(val);
 
-        cout << "After pushing" << endl;
-        cout << *(proot->ilist) << endl << endl;
+            cout << "After pushing" << endl;
+            cout << *(proot->ilist) << endl << endl;
 
-        proot->ilist->push_front(-1);
+            proot->ilist->push_front(-1);
 
-        cout << "After pushing front" << endl;
-        cout << *(proot->ilist) << endl << endl;
+            cout << "After pushing front" << endl;
+            cout << *(proot->ilist) << endl << endl;
 
-        proot->ilist->pop_front();
+            proot->ilist->pop_front();
 
-        cout << "After popping front" << endl;
-        cout << (*proot->ilist) << endl << endl;
+            cout << "After popping front" << endl;
+            cout << (*proot->ilist) << endl << endl;
 
-        proot->ilist->insert(7, 2);
+            proot->ilist->insert(7, 2);
 
-        cout << "After inserting middle" << endl;
-        cout << (*proot->ilist) << endl << endl;
+            cout << "After inserting middle" << endl;
+            cout << (*proot->ilist) << endl << endl;
         
-        proot->ilist->remove(2);
+            proot->ilist->remove(2);
 
-        cout << "After removing middle" << endl;
-        cout << (*proot->ilist) << endl << endl;
+            cout << "After removing middle" << endl;
+            cout << (*proot->ilist) << endl << endl;
 
-        cout << endl << ">>> VECTOR <<<" << endl << endl;
+            cout << endl << ">>> VECTOR <<<" << endl << endl;
 
-        cout << "Original" << endl;
-        cout << *(proot->dvec) << endl << endl;
+            cout << "Original" << endl;
+            cout << *(proot->dvec) << endl << endl;
 
-        auto popped = proot->dvec->pop_back();
+            auto popped = proot->dvec->pop_back();
 
-        cout << "After popping" << endl;
-        cout << *(proot->dvec) << endl << endl;
+            cout << "After popping" << endl;
+            cout << *(proot->dvec) << endl << endl;
 
-        proot->dvec->push_back(popped);
+            proot->dvec->push_back(popped);
 
-        cout << "After pushing" << endl;
-        cout << *(proot->dvec) << endl << endl;
+            cout << "After pushing" << endl;
+            cout << *(proot->dvec) << endl << endl;
 
-        proot->dvec->insert(-37, 3);
+            proot->dvec->insert(-37, 3);
 
-        cout << "After insertion" << endl;
-        cout << *(proot->dvec) << endl << endl;
+            cout << "After insertion" << endl;
+            cout << *(proot->dvec) << endl << endl;
 
-        proot->dvec->remove(3);
+            proot->dvec->remove(3);
 
-        cout << "After removal" << endl;
-        cout << *(proot->dvec) << endl << endl;
+            cout << "After removal" << endl;
+            cout << *(proot->dvec) << endl << endl;
 
-        cout << endl << ">>> STRING <<<" << endl << endl;
+            cout << endl << ">>> STRING <<<" << endl << endl;
 
-        cout << "Original" << endl;
-        cout << *(proot->pstr) << endl << endl;
+            cout << "Original" << endl;
+            cout << *(proot->pstr) << endl << endl;
 
-        flat_transaction::run(pop, [&] {
-            auto other = make_persistent<pstring<root>>(pop, " my guy??");
-            *(proot->pstr) += *(other);
-            other->destroy();
-        });
+            flat_transaction::run(pop, [&] {
+                auto other = make_persistent<pstring<root>>(pop, " my guy??");
+                *(proot->pstr) += *(other);
+                other->destroy();
+            });
 
-        cout << "After concatenation" << endl;
-        cout << *(proot->pstr) << endl << endl;
+            cout << "After concatenation" << endl;
+            cout << *(proot->pstr) << endl << endl;
 
-        cout << endl << ">>> HASHTABLE <<<" << endl << endl;
+            cout << endl << ">>> HASHTABLE <<<" << endl << endl;
+        });
     }
 
     return 0;
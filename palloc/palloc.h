@@ -0,0 +1,65 @@
+#ifndef _PALLOC_H
+#define _PALLOC_H
+
+#include <libpmemobj++/pool.hpp>
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../pstats/pstats.h"
+
+using namespace pmem;
+using namespace pmem::obj;
+
+// objects per run of the heap for a registered class
+#define PALLOC_UNITS_PER_BLOCK 1024
+// range of the class ids handed out; libpmemobj's built-in classes sit below it
+#define PALLOC_FIRST_CLASS 128
+#define PALLOC_LAST_CLASS 254
+
+// The allocation class that objects of type T come from, or 0 for the default ones.
+// Set by palloc::add, read by pstorage::make.
+template <typename T>
+struct palloc_class {
+    static inline std::atomic<unsigned> id{0};
+};
+
+// Allocation classes sized exactly to the fixed-size objects of the collections, e.g.
+// list and hashtable nodes. The default classes round every object up and put a 16 byte
+// header in front of it, so a 32 byte pnode<int> takes 64 bytes. A class added here has
+// units of exactly sizeof(T) and no header, optionally aligned to more than the default
+// 16 bytes, and pstorage::make then allocates every T from it.
+//
+// Classes live only as long as the open pool handle, so they must be added again every
+// time a pool is created or opened, before allocating (see register_classes on plist,
+// phashtable and pbtree). Each size and alignment gets one class id for the whole process, so every pool open at
+// once registers it under the same id. Objects allocated from a class are ordinary
+// objects once allocated, and a pool opened without the classes frees them as usual.
+class palloc {
+private:
+    static std::mutex& registry_lock();
+    static std::map<std::pair<size_t, size_t>, unsigned>& classes();
+    static std::vector<std::atomic<unsigned>*>& routed();
+
+    static unsigned class_for(size_t, size_t);
+    static void add_class(pool_base&, unsigned, size_t, size_t);
+
+public:
+    // Classes
+    template <typename T>
+    static unsigned add(pool_base&, size_t alignment = 0);
+    template <typename T>
+    static unsigned get();
+    static void reset();
+
+    // Arenas
+    static unsigned thread_arena(pool_base&);
+};
+
+#include "palloc.hpp"
+
+#endif
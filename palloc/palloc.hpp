@@ -0,0 +1,119 @@
+#include "palloc.h"
+
+/* ========================================================================= */
+/* ******************************** palloc ********************************* */
+/* ========================================================================= */
+
+/* =============================== CLASSES ================================= */
+
+// Register the class sized to T in the given pool, and allocate every T from it from now
+// on. A nonzero alignment, a power of two dividing sizeof(T), places every T on such a
+// boundary. Returns the class id.
+template <typename T>
+unsigned palloc::add(pool_base& pop, size_t alignment) {
+    PSTATS_OP(PSTATS_OTHER, "palloc::add");
+
+    std::lock_guard<std::mutex> guard(registry_lock());
+
+    unsigned id = class_for(sizeof(T), alignment);
+    add_class(pop, id, sizeof(T), alignment);
+
+    if (palloc_class<T>::id.exchange(id) == 0)
+        routed().push_back(&palloc_class<T>::id);
+
+    return id;
+}
+
+// Get the class that T is allocated from, or 0 for the default ones.
+template <typename T>
+unsigned palloc::get() {
+    return palloc_class<T>::id.load(std::memory_order_relaxed);
+}
+
+// Go back to allocating every type from the default classes, e.g. before opening a pool
+// without adding the classes to it.
+inline void palloc::reset() {
+    std::lock_guard<std::mutex> guard(registry_lock());
+
+    for (auto id : routed())
+        id->store(0);
+    routed().clear();
+}
+
+/* ================================ ARENAS ================================= */
+
+// Create a new arena in the given pool and allocate everything the calling thread
+// allocates from it, so threads filling containers side by side do not contend for the
+// same runs. Must be called on each such thread. Returns the arena id.
+inline unsigned palloc::thread_arena(pool_base& pop) {
+    PSTATS_OP(PSTATS_OTHER, "palloc::thread_arena");
+
+    unsigned id = 0;
+
+    if (pmemobj_ctl_exec(pop.handle(), "heap.arena.create", &id) != 0)
+        throw std::runtime_error("Could not create an arena: " + std::string(pmemobj_errormsg()));
+    if (pmemobj_ctl_set(pop.handle(), "heap.thread.arena_id", &id) != 0)
+        throw std::runtime_error("Could not assign an arena: " + std::string(pmemobj_errormsg()));
+
+    return id;
+}
+
+/* ================================ MISC. ================================== */
+
+// Get the lock guarding the registry.
+inline std::mutex& palloc::registry_lock() {
+    static std::mutex lock;
+    return lock;
+}
+
+// Get the class id handed out for each unit size and alignment.
+inline std::map<std::pair<size_t, size_t>, unsigned>& palloc::classes() {
+    static std::map<std::pair<size_t, size_t>, unsigned> ids;
+    return ids;
+}
+
+// Get the class ids of the types allocated from a class, so reset() can clear them.
+inline std::vector<std::atomic<unsigned>*>& palloc::routed() {
+    static std::vector<std::atomic<unsigned>*> ids;
+    return ids;
+}
+
+// Get the class id for the given unit size and alignment, handing out the next free one the
+// first time. Must be called with the registry locked.
+inline unsigned palloc::class_for(size_t size, size_t alignment) {
+    auto& ids = classes();
+    auto it = ids.find({size, alignment});
+
+    if (it != ids.end())
+        return it->second;
+
+    unsigned id = PALLOC_FIRST_CLASS + (unsigned)ids.size();
+    if (id > PALLOC_LAST_CLASS)
+        throw std::runtime_error("Out of allocation class ids.");
+
+    ids[{size, alignment}] = id;
+    return id;
+}
+
+// Register the class with the given id, unit size and alignment in the given pool, unless
+// the pool has it already.
+inline void palloc::add_class(pool_base& pop, unsigned id, size_t size, size_t alignment) {
+    std::string query = "heap.alloc_class." + std::to_string(id) + ".desc";
+
+    pobj_alloc_class_desc desc;
+    desc.unit_size = size;
+    desc.alignment = alignment;
+    desc.units_per_block = PALLOC_UNITS_PER_BLOCK;
+    desc.header_type = POBJ_HEADER_NONE;
+    desc.class_id = id;
+
+    if (pmemobj_ctl_set(pop.handle(), query.c_str(), &desc) == 0)
+        return;
+
+    // a class that already exists cannot be set again, so check it is the one we want
+    pobj_alloc_class_desc have;
+    if (pmemobj_ctl_get(pop.handle(), query.c_str(), &have) != 0 || have.unit_size != size ||
+        have.alignment != alignment)
+        throw std::runtime_error("Could not register allocation class " + std::to_string(id) +
+                                 ": " + std::string(pmemobj_errormsg()));
+}
@@ -0,0 +1,95 @@
+#ifndef _PBITSET_H
+#define _PBITSET_H
+
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/transaction.hpp>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "../pstats/pstats.h"
+#include "../ptx/ptx.h"
+#include "../ptraits/ptraits.h"
+
+using namespace pmem;
+using namespace pmem::obj;
+
+// storage grows in blocks of 8 words, one 64-byte cache line
+#define PBITSET_BLOCK_WORDS 8
+
+// the bulk boolean operations between two bitsets
+enum pbitset_op { PBITSET_AND, PBITSET_OR, PBITSET_XOR, PBITSET_ANDNOT };
+
+// Word-level kernels, vectorized 4 words at a time when built with AVX2 (`make AVX2=1`).
+inline uint64_t pbitset_popcount(const uint64_t*, int);
+template <pbitset_op OP>
+void pbitset_apply(uint64_t*, const uint64_t*, int);
+inline int pbitset_first_word(const uint64_t*, int, int);
+
+// A fixed-length sequence of bits packed into 64-bit persistent words. set(), reset() and
+// test() on single bits are atomic and need no transaction: the word is updated with an
+// atomic read-modify-write and persisted on its own, so any number of threads may flip
+// bits at once. Such writes are not part of any surrounding transaction and are not
+// undone if it aborts. Everything else (resizing and the bulk operations) is
+// transactional and must not run alongside other writers. Bits past the length are
+// always 0.
+template <typename ROOT_T>
+class pbitset {
+private:
+    persistent_ptr<uint64_t[]> words;
+    // length in bits
+    p<int> len;
+    // capacity in words, a whole number of blocks
+    p<int> cap;
+    pool<ROOT_T> pop;
+
+    int used_words() const;
+    void check_index(int) const;
+    void trim();
+    template <pbitset_op OP>
+    void apply(const pbitset<ROOT_T>&);
+
+public:
+    // Constructors
+    explicit pbitset(pool<ROOT_T>);
+    pbitset(pool<ROOT_T>, int);
+
+    // Operator Overloads
+    bool operator[](int) const;
+    pbitset<ROOT_T>& operator&=(const pbitset<ROOT_T>&);
+    pbitset<ROOT_T>& operator|=(const pbitset<ROOT_T>&);
+    pbitset<ROOT_T>& operator^=(const pbitset<ROOT_T>&);
+    pbitset<ROOT_T>& andnot(const pbitset<ROOT_T>&);
+
+    // Get/Set
+    bool set(int);
+    bool reset(int);
+    bool test(int) const;
+    int get_length() const;
+    int get_capacity() const;
+
+    // Queries
+    int count() const;
+    int rank(int) const;
+    int find_first() const;
+    int find_next(int) const;
+
+    // Misc.
+    template <typename F>
+    void batch(F&&);
+    void resize(int);
+    void refresh_pool(pool<ROOT_T>);
+    void clear();
+    void destroy();
+};
+
+// a pbitset is just a pool offset, two ints and a pool handle, so it can be moved bytewise
+template <typename ROOT_T>
+struct is_prelocatable<pbitset<ROOT_T>> : std::true_type {};
+
+#include "pbitset.hpp"
+
+#endif
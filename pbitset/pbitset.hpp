@@ -0,0 +1,451 @@
+#include "pbitset.h"
+
+/* ========================================================================= */
+/* ******************************* kernels ********************************* */
+/* ========================================================================= */
+
+// Count the set bits in the first n words. With AVX2, each byte is counted with two
+// nibble lookups and the bytes are summed per 64-bit lane.
+inline uint64_t pbitset_popcount(const uint64_t* w, int n) {
+    uint64_t total = 0;
+    int i = 0;
+
+#ifdef __AVX2__
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i acc = _mm256_setzero_si256();
+
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(w + i));
+        __m256i lo = _mm256_and_si256(v, nibble);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+        __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                        _mm256_shuffle_epi8(lookup, hi));
+
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+    }
+
+    total += (uint64_t)_mm256_extract_epi64(acc, 0) + (uint64_t)_mm256_extract_epi64(acc, 1) +
+             (uint64_t)_mm256_extract_epi64(acc, 2) + (uint64_t)_mm256_extract_epi64(acc, 3);
+#endif
+
+    for (; i < n; i++)
+        total += __builtin_popcountll(w[i]);
+
+    return total;
+}
+
+// Combine the first n words of src into dst with the given operation.
+template <pbitset_op OP>
+void pbitset_apply(uint64_t* dst, const uint64_t* src, int n) {
+    int i = 0;
+
+#ifdef __AVX2__
+    for (; i + 4 <= n; i += 4) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i r;
+
+        if constexpr (OP == PBITSET_AND)
+            r = _mm256_and_si256(a, b);
+        else if constexpr (OP == PBITSET_OR)
+            r = _mm256_or_si256(a, b);
+        else if constexpr (OP == PBITSET_XOR)
+            r = _mm256_xor_si256(a, b);
+        else
+            r = _mm256_andnot_si256(b, a);
+
+        _mm256_storeu_si256((__m256i*)(dst + i), r);
+    }
+#endif
+
+    for (; i < n; i++) {
+        if constexpr (OP == PBITSET_AND)
+            dst[i] &= src[i];
+        else if constexpr (OP == PBITSET_OR)
+            dst[i] |= src[i];
+        else if constexpr (OP == PBITSET_XOR)
+            dst[i] ^= src[i];
+        else
+            dst[i] &= ~src[i];
+    }
+}
+
+// Get the index of the first nonzero word in [from, n), or n if there is none. With AVX2,
+// runs of zero words are skipped 4 at a time.
+inline int pbitset_first_word(const uint64_t* w, int from, int n) {
+    int i = from;
+
+#ifdef __AVX2__
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(w + i));
+
+        if (!_mm256_testz_si256(v, v))
+            break;
+    }
+#endif
+
+    for (; i < n; i++) {
+        if (w[i] != 0)
+            return i;
+    }
+
+    return n;
+}
+
+/* ========================================================================= */
+/* ******************************** pbitset ******************************** */
+/* ========================================================================= */
+
+/* ============================ CONSTRUCTORS =============================== */
+
+// Create a new, empty pbitset with no capacity.
+template <typename ROOT_T>
+pbitset<ROOT_T>::pbitset(pool<ROOT_T> pop_in) {
+    PSTATS_OP(PSTATS_PBITSET, "construct");
+    pop = pop_in;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PBITSET);
+        words = nullptr;
+        len = 0;
+        cap = 0;
+    });
+}
+
+// Create a new pbitset of the given number of bits, all 0.
+template <typename ROOT_T>
+pbitset<ROOT_T>::pbitset(pool<ROOT_T> pop_in, int bits) {
+    PSTATS_OP(PSTATS_PBITSET, "construct");
+    pop = pop_in;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PBITSET);
+        words = nullptr;
+        len = 0;
+        cap = 0;
+
+        resize(bits);
+    });
+}
+
+/* ========================== OPERATOR OVERLOADS =========================== */
+
+// Get the bit at the given index.
+template <typename ROOT_T>
+bool pbitset<ROOT_T>::operator[](int idx) const {
+    return test(idx);
+}
+
+// Keep only the bits that are also set in the other bitset. Bits past its length count as 0.
+template <typename ROOT_T>
+pbitset<ROOT_T>& pbitset<ROOT_T>::operator&=(const pbitset<ROOT_T>& other) {
+    PSTATS_OP(PSTATS_PBITSET, "operator&=");
+
+    apply<PBITSET_AND>(other);
+    return *this;
+}
+
+// Set every bit that is set in the other bitset. Bits past this bitset's length are ignored.
+template <typename ROOT_T>
+pbitset<ROOT_T>& pbitset<ROOT_T>::operator|=(const pbitset<ROOT_T>& other) {
+    PSTATS_OP(PSTATS_PBITSET, "operator|=");
+
+    apply<PBITSET_OR>(other);
+    return *this;
+}
+
+// Flip every bit that is set in the other bitset. Bits past this bitset's length are ignored.
+template <typename ROOT_T>
+pbitset<ROOT_T>& pbitset<ROOT_T>::operator^=(const pbitset<ROOT_T>& other) {
+    PSTATS_OP(PSTATS_PBITSET, "operator^=");
+
+    apply<PBITSET_XOR>(other);
+    return *this;
+}
+
+// Clear every bit that is set in the other bitset.
+template <typename ROOT_T>
+pbitset<ROOT_T>& pbitset<ROOT_T>::andnot(const pbitset<ROOT_T>& other) {
+    PSTATS_OP(PSTATS_PBITSET, "andnot");
+
+    apply<PBITSET_ANDNOT>(other);
+    return *this;
+}
+
+/* =============================== GET/SET ================================= */
+
+// Set the bit at the given index, returning its old value. Atomic, and durable on return.
+template <typename ROOT_T>
+bool pbitset<ROOT_T>::set(int idx) {
+    PSTATS_OP(PSTATS_PBITSET, "set");
+    check_index(idx);
+
+    uint64_t bit = (uint64_t)1 << (idx % 64);
+    uint64_t* word = &words[idx / 64];
+    uint64_t old = __atomic_fetch_or(word, bit, __ATOMIC_ACQ_REL);
+
+    // persist even if the bit was already set, as the thread that set it may not have yet
+    pop.persist(word, sizeof(*word));
+
+    return (old & bit) != 0;
+}
+
+// Clear the bit at the given index, returning its old value. Atomic, and durable on return.
+template <typename ROOT_T>
+bool pbitset<ROOT_T>::reset(int idx) {
+    PSTATS_OP(PSTATS_PBITSET, "reset");
+    check_index(idx);
+
+    uint64_t bit = (uint64_t)1 << (idx % 64);
+    uint64_t* word = &words[idx / 64];
+    uint64_t old = __atomic_fetch_and(word, ~bit, __ATOMIC_ACQ_REL);
+
+    pop.persist(word, sizeof(*word));
+
+    return (old & bit) != 0;
+}
+
+// Get the bit at the given index.
+template <typename ROOT_T>
+bool pbitset<ROOT_T>::test(int idx) const {
+    check_index(idx);
+
+    uint64_t word = __atomic_load_n(&words[idx / 64], __ATOMIC_ACQUIRE);
+    return (word >> (idx % 64)) & 1;
+}
+
+// Get the number of bits.
+template <typename ROOT_T>
+int pbitset<ROOT_T>::get_length() const {
+    return len;
+}
+
+// Get the number of bits that fit before the storage has to grow.
+template <typename ROOT_T>
+int pbitset<ROOT_T>::get_capacity() const {
+    return cap * 64;
+}
+
+/* =============================== QUERIES ================================= */
+
+// Get the number of set bits.
+template <typename ROOT_T>
+int pbitset<ROOT_T>::count() const {
+    PSTATS_OP(PSTATS_PBITSET, "count");
+
+    return (int)pbitset_popcount(words.get(), used_words());
+}
+
+// Get the number of set bits before the given index, which may be the length.
+template <typename ROOT_T>
+int pbitset<ROOT_T>::rank(int idx) const {
+    PSTATS_OP(PSTATS_PBITSET, "rank");
+
+    if (idx < 0 || idx > len)
+        throw std::out_of_range("Cannot rank past the range of the bitset.");
+
+    uint64_t total = pbitset_popcount(words.get(), idx / 64);
+
+    if (idx % 64 != 0)
+        total += __builtin_popcountll(words[idx / 64] & (((uint64_t)1 << (idx % 64)) - 1));
+
+    return (int)total;
+}
+
+// Get the index of the first set bit, or -1 if there is none.
+template <typename ROOT_T>
+int pbitset<ROOT_T>::find_first() const {
+    return find_next(-1);
+}
+
+// Get the index of the first set bit after the given index, or -1 if there is none.
+template <typename ROOT_T>
+int pbitset<ROOT_T>::find_next(int idx) const {
+    PSTATS_OP(PSTATS_PBITSET, "find_next");
+
+    if (idx < -1 || idx >= len)
+        throw std::out_of_range("Cannot search past the range of the bitset.");
+
+    int bit = idx + 1;
+    if (bit == len)
+        return -1;
+
+    int wi = bit / 64;
+    uint64_t word = words[wi] & (~(uint64_t)0 << (bit % 64));
+
+    if (word == 0) {
+        int used = used_words();
+
+        wi = pbitset_first_word(words.get(), wi + 1, used);
+        if (wi == used)
+            return -1;
+
+        word = words[wi];
+    }
+
+    return wi * 64 + __builtin_ctzll(word);
+}
+
+/* ================================ MISC. ================================== */
+
+// Get the number of words that hold bits.
+template <typename ROOT_T>
+int pbitset<ROOT_T>::used_words() const {
+    return (len + 63) / 64;
+}
+
+// Throw if the given index is not a bit of this bitset.
+template <typename ROOT_T>
+void pbitset<ROOT_T>::check_index(int idx) const {
+    if (idx < 0 || idx >= len)
+        throw std::out_of_range("Cannot access past the range of the bitset.");
+}
+
+// Clear the bits of the last word that are past the length. Must run inside a transaction.
+template <typename ROOT_T>
+void pbitset<ROOT_T>::trim() {
+    int extra = len % 64;
+    if (extra == 0)
+        return;
+
+    uint64_t mask = ((uint64_t)1 << extra) - 1;
+    int wi = len / 64;
+
+    if ((words[wi] & ~mask) != 0) {
+        PSTATS_SNAPSHOT(PSTATS_PBITSET, sizeof(uint64_t));
+        flat_transaction::snapshot(&words[wi]);
+        words[wi] &= mask;
+    }
+}
+
+// Combine the other bitset into this one with the given operation, in one transaction that
+// logs only the words that can change.
+template <typename ROOT_T>
+template <pbitset_op OP>
+void pbitset<ROOT_T>::apply(const pbitset<ROOT_T>& other) {
+    int n = used_words();
+    int m = other.used_words();
+    int common = n < m ? n : m;
+
+    // only AND can change words the other bitset does not have, by clearing them
+    int touched = OP == PBITSET_AND ? n : common;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PBITSET);
+
+        if (touched > 0) {
+            PSTATS_SNAPSHOT(PSTATS_PBITSET, sizeof(uint64_t) * touched);
+            flat_transaction::snapshot(&words[0], touched);
+        }
+
+        pbitset_apply<OP>(words.get(), other.words.get(), common);
+
+        if (OP == PBITSET_AND && n > common)
+            memset(&words[common], 0, sizeof(uint64_t) * (n - common));
+
+        // a longer other bitset may have set bits past our length
+        trim();
+    });
+}
+
+// Change the number of bits to the given one. New bits are 0. The storage grows to whole
+// blocks of PBITSET_BLOCK_WORDS words, and never shrinks.
+template <typename ROOT_T>
+void pbitset<ROOT_T>::resize(int bits) {
+    PSTATS_OP(PSTATS_PBITSET, "resize");
+
+    if (bits < 0)
+        throw std::out_of_range("Cannot resize a bitset to a negative length.");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PBITSET);
+        PSTATS_SNAPSHOT(PSTATS_PBITSET, sizeof(words) + sizeof(len) + sizeof(cap));
+
+        int need = (bits + 63) / 64;
+        int old = used_words();
+
+        if (need > cap) {
+            int new_cap = (need + PBITSET_BLOCK_WORDS - 1) / PBITSET_BLOCK_WORDS * PBITSET_BLOCK_WORDS;
+
+            // new words are zeroed by the allocation
+            PSTATS_ALLOC(PSTATS_PBITSET, sizeof(uint64_t) * new_cap);
+            persistent_ptr<uint64_t[]> new_words = make_persistent<uint64_t[]>(new_cap);
+
+            if (old > 0)
+                memcpy(new_words.get(), words.get(), sizeof(uint64_t) * old);
+
+            if (words != nullptr) {
+                PSTATS_FREE(PSTATS_PBITSET, sizeof(uint64_t) * cap);
+                delete_persistent<uint64_t[]>(words, cap);
+            }
+
+            words = new_words;
+            cap = new_cap;
+        }
+        else if (need < old) {
+            // clear the dropped words so that growing again brings back 0s
+            PSTATS_SNAPSHOT(PSTATS_PBITSET, sizeof(uint64_t) * (old - need));
+            flat_transaction::snapshot(&words[need], old - need);
+            memset(&words[need], 0, sizeof(uint64_t) * (old - need));
+        }
+
+        len = bits;
+        trim();
+    });
+}
+
+// Refresh the reference to the pool that this bitset lives in. Must be called when using a
+// pbitset from an existing file.
+template <typename ROOT_T>
+void pbitset<ROOT_T>::refresh_pool(pool<ROOT_T> new_pop) {
+    pop = new_pop;
+}
+
+// Remove every bit and free the storage.
+template <typename ROOT_T>
+void pbitset<ROOT_T>::clear() {
+    PSTATS_OP(PSTATS_PBITSET, "clear");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PBITSET);
+        PSTATS_SNAPSHOT(PSTATS_PBITSET, sizeof(words) + sizeof(len) + sizeof(cap));
+
+        if (words != nullptr) {
+            PSTATS_FREE(PSTATS_PBITSET, sizeof(uint64_t) * cap);
+            delete_persistent<uint64_t[]>(words, cap);
+        }
+
+        words = nullptr;
+        len = 0;
+        cap = 0;
+    });
+}
+
+// Completely destroy this object and its allocated memory.
+template <typename ROOT_T>
+void pbitset<ROOT_T>::destroy() {
+    PSTATS_OP(PSTATS_PBITSET, "destroy");
+
+    clear();
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PBITSET);
+        PSTATS_FREE(PSTATS_PBITSET, sizeof(pbitset<ROOT_T>));
+
+        delete_persistent<pbitset<ROOT_T>>(this);
+    });
+}
+
+// Run the given function as one transaction. Single bit writes are never part of it.
+template <typename ROOT_T>
+template <typename F>
+void pbitset<ROOT_T>::batch(F&& fn) {
+    PSTATS_OP(PSTATS_PBITSET, "batch");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PBITSET);
+        fn();
+    });
+}
@@ -0,0 +1,203 @@
+#ifndef _PBTREE_H
+#define _PBTREE_H
+
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/transaction.hpp>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "../palloc/palloc.h"
+#include "../pstats/pstats.h"
+#include "../pstorage/pstorage.h"
+#include "../ptx/ptx.h"
+#include "../ptraits/ptraits.h"
+
+using namespace pmem;
+using namespace pmem::obj;
+
+// pmem is read and written in 256-byte blocks, so nodes are sized and, once register_classes
+// is called, aligned in whole blocks
+#define PBTREE_GRANULE ((size_t)256)
+// the size nodes are filled up to before rounding to whole blocks
+#define PBTREE_NODE_BYTES ((size_t)1024)
+// enough for 2^31 items even with the smallest possible nodes
+#define PBTREE_MAX_HEIGHT 32
+
+// forward declaration of classes
+template <typename KEY_T, typename VAL_T>
+class pbtree_iterator;
+
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+class pbtree;
+
+// A node of the tree. Which kind a node is follows from its depth, as every leaf sits on
+// the same level.
+class pbtree_block {
+public:
+    p<int> count;
+};
+
+// Trailing padding that rounds a node up to whole blocks, taking no space when none is needed.
+template <size_t N>
+struct pbtree_pad {
+    char pad[N];
+};
+
+template <>
+struct pbtree_pad<0> {};
+
+// Round the given size up to whole blocks.
+constexpr size_t pbtree_round(size_t bytes) {
+    return (bytes + PBTREE_GRANULE - 1) / PBTREE_GRANULE * PBTREE_GRANULE;
+}
+
+// How many slots fit in a node of PBTREE_NODE_BYTES after a header, with at least 3.
+constexpr int pbtree_slots(size_t header, size_t slot) {
+    return (PBTREE_NODE_BYTES - header) / slot >= 3 ? (PBTREE_NODE_BYTES - header) / slot : 3;
+}
+
+// The fields of a leaf: sorted keys with their values, and the next leaf in key order.
+template <typename KEY_T, typename VAL_T>
+class pbtree_leaf_fields : public pbtree_block {
+public:
+    static const int CAP = pbtree_slots(sizeof(pbtree_block) + sizeof(persistent_ptr<pbtree_block>),
+                                        sizeof(KEY_T) + sizeof(VAL_T));
+
+    persistent_ptr<pbtree_block> next;
+    KEY_T keys[CAP];
+    VAL_T vals[CAP];
+};
+
+// A leaf, padded to whole blocks.
+template <typename KEY_T, typename VAL_T>
+class pbtree_leaf
+    : public pbtree_leaf_fields<KEY_T, VAL_T>,
+      public pbtree_pad<pbtree_round(sizeof(pbtree_leaf_fields<KEY_T, VAL_T>)) -
+                        sizeof(pbtree_leaf_fields<KEY_T, VAL_T>)> {};
+
+// The fields of an interior node: count sorted separator keys and count + 1 children, where
+// kids[i] holds the keys below keys[i] and kids[i + 1] the rest.
+template <typename KEY_T>
+class pbtree_inner_fields : public pbtree_block {
+public:
+    static const int CAP = pbtree_slots(sizeof(pbtree_block) + sizeof(persistent_ptr<pbtree_block>),
+                                        sizeof(KEY_T) + sizeof(persistent_ptr<pbtree_block>));
+
+    KEY_T keys[CAP];
+    persistent_ptr<pbtree_block> kids[CAP + 1];
+};
+
+// An interior node, padded to whole blocks.
+template <typename KEY_T>
+class pbtree_inner
+    : public pbtree_inner_fields<KEY_T>,
+      public pbtree_pad<pbtree_round(sizeof(pbtree_inner_fields<KEY_T>)) -
+                        sizeof(pbtree_inner_fields<KEY_T>)> {};
+
+// A position in the tree, moving forward through the linked leaves. It reads pmem
+// directly, so it is invalidated by any change to the tree.
+template <typename KEY_T, typename VAL_T>
+class pbtree_iterator {
+private:
+    persistent_ptr<pbtree_leaf<KEY_T, VAL_T>> leaf;
+    int idx;
+
+public:
+    // Constructor
+    pbtree_iterator(persistent_ptr<pbtree_leaf<KEY_T, VAL_T>>, int);
+
+    // Operator Overloads
+    pbtree_iterator<KEY_T, VAL_T>& operator++();
+    bool operator==(const pbtree_iterator<KEY_T, VAL_T>&) const;
+    bool operator!=(const pbtree_iterator<KEY_T, VAL_T>&) const;
+
+    // Get/Set
+    const KEY_T& key() const;
+    const VAL_T& value() const;
+};
+
+// Ordered map from KEY_T to VAL_T, stored as a B+-tree whose leaves are linked in key
+// order for range scans. Keys and values are stored in fixed slots and moved bytewise, so
+// both must be trivially copyable, and keys must be ordered by operator<.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+class pbtree {
+private:
+    typedef pbtree_leaf<KEY_T, VAL_T> leaf_t;
+    typedef pbtree_inner<KEY_T> inner_t;
+    typedef pstorage<ROOT_T> storage;
+
+    static_assert(std::is_trivially_copyable<KEY_T>::value, "pbtree keys must be trivially copyable");
+    static_assert(std::is_trivially_copyable<VAL_T>::value, "pbtree values must be trivially copyable");
+
+    persistent_ptr<pbtree_block> root;
+    p<int> len;
+    // number of levels, counting the leaves; 0 while the tree is empty
+    p<int> height;
+    pool<ROOT_T> pop;
+
+    // the interior nodes on the way down to a leaf and the child taken at each
+    struct pbtree_path {
+        persistent_ptr<pbtree_block> nodes[PBTREE_MAX_HEIGHT];
+        int kids[PBTREE_MAX_HEIGHT];
+    };
+
+    static persistent_ptr<leaf_t> as_leaf(persistent_ptr<pbtree_block>);
+    static persistent_ptr<inner_t> as_inner(persistent_ptr<pbtree_block>);
+    static int leaf_pos(persistent_ptr<leaf_t>, const KEY_T&);
+    static int child_pos(persistent_ptr<inner_t>, const KEY_T&);
+    template <typename T>
+    static void log_slots(const T*, int, bool);
+
+    persistent_ptr<leaf_t> descend(const KEY_T&, pbtree_path*) const;
+    void leaf_insert(persistent_ptr<leaf_t>, int, const KEY_T&, const VAL_T&, bool fresh = false);
+    void leaf_erase(persistent_ptr<leaf_t>, int);
+    void inner_insert(persistent_ptr<inner_t>, int, const KEY_T&, persistent_ptr<pbtree_block>,
+                      bool fresh = false);
+    void inner_erase(persistent_ptr<inner_t>, int);
+    void insert_up(pbtree_path&, int, KEY_T, persistent_ptr<pbtree_block>);
+    void merge_up(pbtree_path&, int);
+    void rebalance(persistent_ptr<inner_t>, int, bool);
+    void release(persistent_ptr<pbtree_block>, int);
+
+public:
+    typedef pbtree_iterator<KEY_T, VAL_T> iterator;
+
+    // Constructor
+    explicit pbtree(pool<ROOT_T>);
+
+    // Push/Pop
+    void insert(const KEY_T&, const VAL_T&);
+    bool erase(const KEY_T&);
+
+    // Get/Set
+    iterator find(const KEY_T&) const;
+    iterator lower_bound(const KEY_T&) const;
+    iterator begin() const;
+    iterator end() const;
+    VAL_T get(const KEY_T&) const;
+    bool contains(const KEY_T&) const;
+    int get_length() const;
+    int get_height() const;
+    bool is_empty() const;
+
+    // Misc.
+    template <typename F>
+    void range(const KEY_T&, const KEY_T&, F&&) const;
+    template <typename F>
+    void batch(F&&);
+    void refresh_pool(pool<ROOT_T>);
+    static void register_classes(pool<ROOT_T>);
+    void clear();
+    void destroy();
+};
+
+// a pbtree is just a pool offset, two ints and a pool handle, so it can be moved bytewise
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+struct is_prelocatable<pbtree<KEY_T, VAL_T, ROOT_T>> : std::true_type {};
+
+#include "pbtree.hpp"
+
+#endif
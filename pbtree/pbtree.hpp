@@ -0,0 +1,731 @@
+#include "pbtree.h"
+
+/* ========================================================================= */
+/* **************************** pbtree_iterator **************************** */
+/* ========================================================================= */
+
+/* ============================ CONSTRUCTORS =============================== */
+
+// Create an iterator at the given slot of the given leaf, or the end if the leaf is null.
+template <typename KEY_T, typename VAL_T>
+pbtree_iterator<KEY_T, VAL_T>::pbtree_iterator(persistent_ptr<pbtree_leaf<KEY_T, VAL_T>> leaf_in,
+                                               int idx_in) {
+    leaf = leaf_in;
+    idx = leaf_in == nullptr ? 0 : idx_in;
+}
+
+/* ========================== OPERATOR OVERLOADS =========================== */
+
+// Move to the next item in key order, following the link to the next leaf at the end of one.
+template <typename KEY_T, typename VAL_T>
+pbtree_iterator<KEY_T, VAL_T>& pbtree_iterator<KEY_T, VAL_T>::operator++() {
+    if (leaf == nullptr)
+        return *this;
+
+    idx++;
+
+    if (idx >= leaf->count) {
+        leaf = persistent_ptr<pbtree_leaf<KEY_T, VAL_T>>(leaf->next.raw());
+        idx = 0;
+    }
+
+    return *this;
+}
+
+// Get whether both iterators are at the same position.
+template <typename KEY_T, typename VAL_T>
+bool pbtree_iterator<KEY_T, VAL_T>::operator==(const pbtree_iterator<KEY_T, VAL_T>& other) const {
+    return leaf == other.leaf && idx == other.idx;
+}
+
+// Get whether the iterators are at different positions.
+template <typename KEY_T, typename VAL_T>
+bool pbtree_iterator<KEY_T, VAL_T>::operator!=(const pbtree_iterator<KEY_T, VAL_T>& other) const {
+    return !(*this == other);
+}
+
+/* =============================== GET/SET ================================= */
+
+// Get the key at the current position.
+template <typename KEY_T, typename VAL_T>
+const KEY_T& pbtree_iterator<KEY_T, VAL_T>::key() const {
+    if (leaf == nullptr)
+        throw std::out_of_range("Cannot read past the end of the tree.");
+
+    return leaf->keys[idx];
+}
+
+// Get the value at the current position.
+template <typename KEY_T, typename VAL_T>
+const VAL_T& pbtree_iterator<KEY_T, VAL_T>::value() const {
+    if (leaf == nullptr)
+        throw std::out_of_range("Cannot read past the end of the tree.");
+
+    return leaf->vals[idx];
+}
+
+/* ========================================================================= */
+/* ******************************** pbtree ********************************* */
+/* ========================================================================= */
+
+/* ============================ CONSTRUCTORS =============================== */
+
+// Create a new, empty pbtree. The first leaf is only allocated by the first insert.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+pbtree<KEY_T, VAL_T, ROOT_T>::pbtree(pool<ROOT_T> pop_in) {
+    PSTATS_OP(PSTATS_PBTREE, "construct");
+    pop = pop_in;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PBTREE);
+        root = nullptr;
+        len = 0;
+        height = 0;
+    });
+}
+
+/* ============================== PUSH/POP ================================= */
+
+// Insert the given key with the given value, replacing the value if the key is already
+// present. A full leaf is split in two; the upper half is copied into a new leaf, so only
+// the slots that shift in the lower half are logged along with the counts and links.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void pbtree<KEY_T, VAL_T, ROOT_T>::insert(const KEY_T& key, const VAL_T& val) {
+    PSTATS_OP(PSTATS_PBTREE, "insert");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PBTREE);
+
+        if (root == nullptr) {
+            PSTATS_ALLOC(PSTATS_PBTREE, sizeof(leaf_t));
+            auto first = storage::template make<leaf_t>();
+            first->count = 0;
+            first->next = nullptr;
+
+            root = persistent_ptr<pbtree_block>(first.raw());
+            height = 1;
+        }
+
+        pbtree_path path;
+        auto leaf = descend(key, &path);
+        int pos = leaf_pos(leaf, key);
+
+        // the key is already here, so only its value changes
+        if (pos < leaf->count && !(key < leaf->keys[pos])) {
+            PSTATS_SNAPSHOT(PSTATS_PBTREE, sizeof(VAL_T));
+            flat_transaction::snapshot(&leaf->vals[pos]);
+            leaf->vals[pos] = val;
+            return;
+        }
+
+        len++;
+
+        if (leaf->count < leaf_t::CAP) {
+            leaf_insert(leaf, pos, key, val);
+            return;
+        }
+
+        // split: the upper half moves to a new leaf, and the old one just forgets it
+        PSTATS_ALLOC(PSTATS_PBTREE, sizeof(leaf_t));
+        auto right = storage::template make<leaf_t>();
+        int keep = (leaf_t::CAP + 1) / 2;
+        int moved = leaf_t::CAP - keep;
+
+        memcpy(right->keys, &leaf->keys[keep], sizeof(KEY_T) * moved);
+        memcpy(right->vals, &leaf->vals[keep], sizeof(VAL_T) * moved);
+        right->count = moved;
+        right->next = leaf->next;
+
+        leaf->next = persistent_ptr<pbtree_block>(right.raw());
+        leaf->count = keep;
+
+        if (pos < keep)
+            leaf_insert(leaf, pos, key, val);
+        else
+            leaf_insert(right, pos - keep, key, val, true);
+
+        insert_up(path, height - 2, right->keys[0], persistent_ptr<pbtree_block>(right.raw()));
+    });
+}
+
+// Remove the given key, returning whether it was there. A leaf that drops below a quarter
+// full is merged into its neighbour when they fit in one node, and evened out with it
+// otherwise.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+bool pbtree<KEY_T, VAL_T, ROOT_T>::erase(const KEY_T& key) {
+    PSTATS_OP(PSTATS_PBTREE, "erase");
+
+    if (root == nullptr)
+        return false;
+
+    pbtree_path path;
+    auto leaf = descend(key, &path);
+    int pos = leaf_pos(leaf, key);
+
+    if (pos >= leaf->count || key < leaf->keys[pos])
+        return false;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PBTREE);
+
+        leaf_erase(leaf, pos);
+        len--;
+
+        merge_up(path, height - 1);
+    });
+
+    return true;
+}
+
+/* =============================== GET/SET ================================= */
+
+// Get an iterator at the given key, or end() if it is not in the tree.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+typename pbtree<KEY_T, VAL_T, ROOT_T>::iterator pbtree<KEY_T, VAL_T, ROOT_T>::find(const KEY_T& key) const {
+    PSTATS_OP(PSTATS_PBTREE, "find");
+
+    auto leaf = descend(key, nullptr);
+    if (leaf == nullptr)
+        return end();
+
+    int pos = leaf_pos(leaf, key);
+    if (pos >= leaf->count || key < leaf->keys[pos])
+        return end();
+
+    return iterator(leaf, pos);
+}
+
+// Get an iterator at the first key that is not less than the given one, or end() if
+// there is none.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+typename pbtree<KEY_T, VAL_T, ROOT_T>::iterator pbtree<KEY_T, VAL_T, ROOT_T>::lower_bound(const KEY_T& key) const {
+    PSTATS_OP(PSTATS_PBTREE, "lower_bound");
+
+    auto leaf = descend(key, nullptr);
+    if (leaf == nullptr)
+        return end();
+
+    int pos = leaf_pos(leaf, key);
+
+    // every key in this leaf is smaller, so the answer starts the next one
+    if (pos >= leaf->count)
+        return iterator(as_leaf(leaf->next), 0);
+
+    return iterator(leaf, pos);
+}
+
+// Get an iterator at the smallest key.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+typename pbtree<KEY_T, VAL_T, ROOT_T>::iterator pbtree<KEY_T, VAL_T, ROOT_T>::begin() const {
+    auto block = root;
+
+    for (int level = 0; level < height - 1; level++)
+        block = as_inner(block)->kids[0];
+
+    return iterator(as_leaf(block), 0);
+}
+
+// Get the iterator past the largest key.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+typename pbtree<KEY_T, VAL_T, ROOT_T>::iterator pbtree<KEY_T, VAL_T, ROOT_T>::end() const {
+    return iterator(nullptr, 0);
+}
+
+// Get the value stored for the given key.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+VAL_T pbtree<KEY_T, VAL_T, ROOT_T>::get(const KEY_T& key) const {
+    auto it = find(key);
+
+    if (it == end())
+        throw std::out_of_range("Cannot get a key that is not in the tree.");
+
+    return it.value();
+}
+
+// Get whether the given key is in the tree.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+bool pbtree<KEY_T, VAL_T, ROOT_T>::contains(const KEY_T& key) const {
+    return find(key) != end();
+}
+
+// Get the number of keys in the tree.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+int pbtree<KEY_T, VAL_T, ROOT_T>::get_length() const {
+    return len;
+}
+
+// Get the number of levels in the tree, counting the leaves.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+int pbtree<KEY_T, VAL_T, ROOT_T>::get_height() const {
+    return height;
+}
+
+// Get whether or not the tree is empty.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+bool pbtree<KEY_T, VAL_T, ROOT_T>::is_empty() const {
+    return len == 0;
+}
+
+/* ================================ MISC. ================================== */
+
+// Call the given function with every key in [lo, hi) and its value, in key order.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+template <typename F>
+void pbtree<KEY_T, VAL_T, ROOT_T>::range(const KEY_T& lo, const KEY_T& hi, F&& fn) const {
+    PSTATS_OP(PSTATS_PBTREE, "range");
+
+    for (auto it = lower_bound(lo); it != end() && it.key() < hi; ++it)
+        fn(it.key(), it.value());
+}
+
+// View the given block as a leaf.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+persistent_ptr<pbtree_leaf<KEY_T, VAL_T>> pbtree<KEY_T, VAL_T, ROOT_T>::as_leaf(persistent_ptr<pbtree_block> block) {
+    return persistent_ptr<leaf_t>(block.raw());
+}
+
+// View the given block as an interior node.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+persistent_ptr<pbtree_inner<KEY_T>> pbtree<KEY_T, VAL_T, ROOT_T>::as_inner(persistent_ptr<pbtree_block> block) {
+    return persistent_ptr<inner_t>(block.raw());
+}
+
+// Get the index of the first key in the leaf that is not less than the given one.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+int pbtree<KEY_T, VAL_T, ROOT_T>::leaf_pos(persistent_ptr<leaf_t> leaf, const KEY_T& key) {
+    int lo = 0;
+    int hi = leaf->count;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+
+        if (leaf->keys[mid] < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+// Get the index of the child of the node that holds the given key.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+int pbtree<KEY_T, VAL_T, ROOT_T>::child_pos(persistent_ptr<inner_t> node, const KEY_T& key) {
+    int lo = 0;
+    int hi = node->count;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+
+        if (key < node->keys[mid])
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    return lo;
+}
+
+// Add the given slots of a node, about to be written, to the open transaction. A node
+// allocated in this transaction has nothing to roll back to, so its slots are only filled.
+// Any other node has its slots logged, even past its count: an earlier split or erase in
+// the same transaction may have lowered the count over pairs that were live when it began.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+template <typename T>
+void pbtree<KEY_T, VAL_T, ROOT_T>::log_slots(const T* first, int n, bool fresh) {
+    if (n <= 0)
+        return;
+
+    if (fresh) {
+        storage::fill(first, sizeof(T) * n);
+        return;
+    }
+
+    PSTATS_SNAPSHOT(PSTATS_PBTREE, sizeof(T) * n);
+    storage::snapshot(first, n);
+}
+
+// Walk down to the leaf that holds or would hold the given key, recording the way there
+// in the given path if there is one.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+persistent_ptr<pbtree_leaf<KEY_T, VAL_T>> pbtree<KEY_T, VAL_T, ROOT_T>::descend(const KEY_T& key,
+                                                                                pbtree_path* path) const {
+    auto block = root;
+
+    for (int level = 0; level < height - 1; level++) {
+        auto node = as_inner(block);
+        int i = child_pos(node, key);
+
+        if (path != nullptr) {
+            path->nodes[level] = block;
+            path->kids[level] = i;
+        }
+
+        block = node->kids[i];
+    }
+
+    return as_leaf(block);
+}
+
+// Insert the given pair at the given index of a leaf with room for it, which is fresh if
+// it was allocated in the open transaction. Must run inside a transaction.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void pbtree<KEY_T, VAL_T, ROOT_T>::leaf_insert(persistent_ptr<leaf_t> leaf, int pos, const KEY_T& key,
+                                               const VAL_T& val, bool fresh) {
+    int count = leaf->count;
+    int n = count - pos;
+
+    // the slots that shift and the one they shift into
+    PSTATS_SNAPSHOT(PSTATS_PBTREE, sizeof(leaf->count));
+    log_slots(&leaf->keys[pos], n + 1, fresh);
+    log_slots(&leaf->vals[pos], n + 1, fresh);
+
+    memmove(&leaf->keys[pos + 1], &leaf->keys[pos], sizeof(KEY_T) * n);
+    memmove(&leaf->vals[pos + 1], &leaf->vals[pos], sizeof(VAL_T) * n);
+
+    leaf->keys[pos] = key;
+    leaf->vals[pos] = val;
+    leaf->count = count + 1;
+}
+
+// Remove the pair at the given index of a leaf. Must run inside a transaction.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void pbtree<KEY_T, VAL_T, ROOT_T>::leaf_erase(persistent_ptr<leaf_t> leaf, int pos) {
+    int count = leaf->count;
+    int n = count - pos - 1;
+
+    // the last slot just becomes dead, so only the ones that shift down are logged
+    PSTATS_SNAPSHOT(PSTATS_PBTREE, sizeof(leaf->count));
+    log_slots(&leaf->keys[pos], n, false);
+    log_slots(&leaf->vals[pos], n, false);
+
+    memmove(&leaf->keys[pos], &leaf->keys[pos + 1], sizeof(KEY_T) * n);
+    memmove(&leaf->vals[pos], &leaf->vals[pos + 1], sizeof(VAL_T) * n);
+
+    leaf->count = count - 1;
+}
+
+// Insert the given separator at the given index of an interior node with room for it, with
+// the given child to its right. The node is fresh if it was allocated in the open
+// transaction. Must run inside a transaction.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void pbtree<KEY_T, VAL_T, ROOT_T>::inner_insert(persistent_ptr<inner_t> node, int pos, const KEY_T& key,
+                                                persistent_ptr<pbtree_block> kid, bool fresh) {
+    int count = node->count;
+    int n = count - pos;
+
+    PSTATS_SNAPSHOT(PSTATS_PBTREE, sizeof(node->count));
+    log_slots(&node->keys[pos], n + 1, fresh);
+    log_slots(&node->kids[pos + 1], n + 1, fresh);
+
+    memmove(&node->keys[pos + 1], &node->keys[pos], sizeof(KEY_T) * n);
+    memmove((void*)&node->kids[pos + 2], (const void*)&node->kids[pos + 1], sizeof(kid) * n);
+
+    node->keys[pos] = key;
+    memcpy((void*)&node->kids[pos + 1], (const void*)&kid, sizeof(kid));
+    node->count = count + 1;
+}
+
+// Remove the separator at the given index of an interior node along with the child to its
+// right. Must run inside a transaction.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void pbtree<KEY_T, VAL_T, ROOT_T>::inner_erase(persistent_ptr<inner_t> node, int pos) {
+    int count = node->count;
+    int n = count - pos - 1;
+
+    PSTATS_SNAPSHOT(PSTATS_PBTREE, sizeof(node->count));
+    log_slots(&node->keys[pos], n, false);
+    log_slots(&node->kids[pos + 1], n, false);
+
+    memmove(&node->keys[pos], &node->keys[pos + 1], sizeof(KEY_T) * n);
+    memmove((void*)&node->kids[pos + 1], (const void*)&node->kids[pos + 2], sizeof(node->kids[0]) * n);
+
+    node->count = count - 1;
+}
+
+// Add the given separator and new right child to the interior node on the given level of
+// the path, splitting nodes on the way up as needed and growing a new root if the old one
+// splits. Must run inside a transaction.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void pbtree<KEY_T, VAL_T, ROOT_T>::insert_up(pbtree_path& path, int level, KEY_T sep,
+                                             persistent_ptr<pbtree_block> kid) {
+    for (; level >= 0; level--) {
+        auto node = as_inner(path.nodes[level]);
+        int pos = path.kids[level];
+
+        if (node->count < inner_t::CAP) {
+            inner_insert(node, pos, sep, kid);
+            return;
+        }
+
+        // split: the middle key moves up, everything after it moves to a new node
+        PSTATS_ALLOC(PSTATS_PBTREE, sizeof(inner_t));
+        auto right = storage::template make<inner_t>();
+        int mid = inner_t::CAP / 2;
+        int moved = inner_t::CAP - mid - 1;
+        KEY_T up = node->keys[mid];
+
+        memcpy(right->keys, &node->keys[mid + 1], sizeof(KEY_T) * moved);
+        memcpy((void*)right->kids, (const void*)&node->kids[mid + 1], sizeof(kid) * (moved + 1));
+        right->count = moved;
+        node->count = mid;
+
+        if (pos <= mid)
+            inner_insert(node, pos, sep, kid);
+        else
+            inner_insert(right, pos - mid - 1, sep, kid, true);
+
+        sep = up;
+        kid = persistent_ptr<pbtree_block>(right.raw());
+    }
+
+    // the root split, so the tree grows a level on top
+    PSTATS_ALLOC(PSTATS_PBTREE, sizeof(inner_t));
+    auto top = storage::template make<inner_t>();
+    top->count = 1;
+    top->keys[0] = sep;
+    top->kids[0] = root;
+    top->kids[1] = kid;
+
+    root = persistent_ptr<pbtree_block>(top.raw());
+    height++;
+}
+
+// Starting from the node on the given level of the path, merge nodes that dropped below a
+// quarter full into a neighbour under the same parent, working up as long as parents
+// underflow too, and drop the root while it has a single child. Merges copy the right node
+// into the slots past the end of the left one, so those slots are logged along with the
+// counts, the leaf link and the parent; the right node is freed rather than logged. When the
+// pair does not fit in one node it is rebalanced instead. Must run inside a transaction.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void pbtree<KEY_T, VAL_T, ROOT_T>::merge_up(pbtree_path& path, int level) {
+    for (; level > 0; level--) {
+        auto parent = as_inner(path.nodes[level - 1]);
+        int at = path.kids[level - 1];
+        bool leaves = level == height - 1;
+        int cap = leaves ? leaf_t::CAP : inner_t::CAP;
+
+        persistent_ptr<pbtree_block> node = parent->kids[at];
+        if (node->count > 0 && node->count >= cap / 4)
+            return;
+
+        // merge with the right neighbour, or the left one for the last child
+        int li = at < parent->count ? at : at - 1;
+        auto left = parent->kids[li];
+        auto right = parent->kids[li + 1];
+
+        if (leaves) {
+            auto l = as_leaf(left);
+            auto r = as_leaf(right);
+            int lc = l->count;
+            int rc = r->count;
+
+            if (lc + rc > cap) {
+                rebalance(parent, li, true);
+                return;
+            }
+
+            log_slots(&l->keys[lc], rc, false);
+            log_slots(&l->vals[lc], rc, false);
+            memcpy(&l->keys[lc], r->keys, sizeof(KEY_T) * rc);
+            memcpy(&l->vals[lc], r->vals, sizeof(VAL_T) * rc);
+
+            l->next = r->next;
+            l->count = lc + rc;
+
+            PSTATS_FREE(PSTATS_PBTREE, sizeof(leaf_t));
+            storage::template destroy<leaf_t>(r);
+        }
+        else {
+            auto l = as_inner(left);
+            auto r = as_inner(right);
+            int lc = l->count;
+            int rc = r->count;
+
+            if (lc + rc + 1 > cap) {
+                rebalance(parent, li, false);
+                return;
+            }
+
+            // the separator between them comes down from the parent
+            log_slots(&l->keys[lc], rc + 1, false);
+            log_slots(&l->kids[lc + 1], rc + 1, false);
+            l->keys[lc] = parent->keys[li];
+            memcpy(&l->keys[lc + 1], r->keys, sizeof(KEY_T) * rc);
+            memcpy((void*)&l->kids[lc + 1], (const void*)r->kids, sizeof(l->kids[0]) * (rc + 1));
+
+            l->count = lc + rc + 1;
+
+            PSTATS_FREE(PSTATS_PBTREE, sizeof(inner_t));
+            storage::template destroy<inner_t>(r);
+        }
+
+        inner_erase(parent, li);
+    }
+
+    // an interior root with a single child is replaced by that child
+    while (height > 1 && root->count == 0) {
+        auto old = as_inner(root);
+        root = old->kids[0];
+        height--;
+
+        PSTATS_FREE(PSTATS_PBTREE, sizeof(inner_t));
+        storage::template destroy<inner_t>(old);
+    }
+
+    // and an empty leaf root goes away entirely
+    if (height == 1 && root->count == 0) {
+        PSTATS_FREE(PSTATS_PBTREE, sizeof(leaf_t));
+        storage::template destroy<leaf_t>(as_leaf(root));
+
+        root = nullptr;
+        height = 0;
+    }
+}
+
+// Spread the entries of the two children of the given parent at li and li + 1 evenly
+// between them, updating the separator. This only happens when a merge would overflow,
+// which is rare, so both nodes are simply logged whole. Must run inside a transaction.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void pbtree<KEY_T, VAL_T, ROOT_T>::rebalance(persistent_ptr<inner_t> parent, int li, bool leaves) {
+    PSTATS_SNAPSHOT(PSTATS_PBTREE, sizeof(KEY_T));
+    flat_transaction::snapshot(&parent->keys[li]);
+
+    if (leaves) {
+        auto l = as_leaf(parent->kids[li]);
+        auto r = as_leaf(parent->kids[li + 1]);
+        int lc = l->count;
+        int total = lc + r->count;
+        int keep = total / 2;
+
+        std::vector<char> keys(sizeof(KEY_T) * total);
+        std::vector<char> vals(sizeof(VAL_T) * total);
+        memcpy(keys.data(), l->keys, sizeof(KEY_T) * lc);
+        memcpy(keys.data() + sizeof(KEY_T) * lc, r->keys, sizeof(KEY_T) * (total - lc));
+        memcpy(vals.data(), l->vals, sizeof(VAL_T) * lc);
+        memcpy(vals.data() + sizeof(VAL_T) * lc, r->vals, sizeof(VAL_T) * (total - lc));
+
+        PSTATS_SNAPSHOT(PSTATS_PBTREE, 2 * sizeof(leaf_t));
+        flat_transaction::snapshot(l.get());
+        flat_transaction::snapshot(r.get());
+
+        memcpy(l->keys, keys.data(), sizeof(KEY_T) * keep);
+        memcpy(r->keys, keys.data() + sizeof(KEY_T) * keep, sizeof(KEY_T) * (total - keep));
+        memcpy(l->vals, vals.data(), sizeof(VAL_T) * keep);
+        memcpy(r->vals, vals.data() + sizeof(VAL_T) * keep, sizeof(VAL_T) * (total - keep));
+        l->count = keep;
+        r->count = total - keep;
+
+        parent->keys[li] = r->keys[0];
+        return;
+    }
+
+    // the separator joins the keys in the middle, and whichever key ends up there goes back up
+    auto l = as_inner(parent->kids[li]);
+    auto r = as_inner(parent->kids[li + 1]);
+    int lc = l->count;
+    int rc = r->count;
+    int total = lc + rc + 1;
+    int keep = total / 2;
+    size_t kid = sizeof(l->kids[0]);
+
+    std::vector<char> keys(sizeof(KEY_T) * total);
+    std::vector<char> kids(kid * (total + 1));
+    memcpy(keys.data(), l->keys, sizeof(KEY_T) * lc);
+    memcpy(keys.data() + sizeof(KEY_T) * lc, &parent->keys[li], sizeof(KEY_T));
+    memcpy(keys.data() + sizeof(KEY_T) * (lc + 1), r->keys, sizeof(KEY_T) * rc);
+    memcpy(kids.data(), (const void*)l->kids, kid * (lc + 1));
+    memcpy(kids.data() + kid * (lc + 1), (const void*)r->kids, kid * (rc + 1));
+
+    PSTATS_SNAPSHOT(PSTATS_PBTREE, 2 * sizeof(inner_t));
+    flat_transaction::snapshot(l.get());
+    flat_transaction::snapshot(r.get());
+
+    memcpy(l->keys, keys.data(), sizeof(KEY_T) * keep);
+    memcpy(&parent->keys[li], keys.data() + sizeof(KEY_T) * keep, sizeof(KEY_T));
+    memcpy(r->keys, keys.data() + sizeof(KEY_T) * (keep + 1), sizeof(KEY_T) * (total - keep - 1));
+    memcpy((void*)l->kids, kids.data(), kid * (keep + 1));
+    memcpy((void*)r->kids, kids.data() + kid * (keep + 1), kid * (total - keep));
+    l->count = keep;
+    r->count = total - keep - 1;
+}
+
+// Free the given block on the given level and everything below it. Must run inside a
+// transaction.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void pbtree<KEY_T, VAL_T, ROOT_T>::release(persistent_ptr<pbtree_block> block, int level) {
+    if (level == height - 1) {
+        PSTATS_FREE(PSTATS_PBTREE, sizeof(leaf_t));
+        storage::template destroy<leaf_t>(as_leaf(block));
+        return;
+    }
+
+    auto node = as_inner(block);
+
+    for (int i = 0; i <= node->count; i++)
+        release(node->kids[i], level + 1);
+
+    PSTATS_FREE(PSTATS_PBTREE, sizeof(inner_t));
+    storage::template destroy<inner_t>(node);
+}
+
+// Refresh the reference to the pool that this tree lives in. Must be called when using a
+// pbtree from an existing file.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void pbtree<KEY_T, VAL_T, ROOT_T>::refresh_pool(pool<ROOT_T> new_pop) {
+    pop = new_pop;
+}
+
+// Give the nodes of every pbtree of this type allocation classes of their exact size,
+// aligned to whole blocks, in the given pool (see palloc). Without them nodes only get the
+// default 16 byte alignment, and most straddle one more block than they fill. Must be called
+// each time the pool is created or opened.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void pbtree<KEY_T, VAL_T, ROOT_T>::register_classes(pool<ROOT_T> new_pop) {
+    palloc::add<leaf_t>(new_pop, PBTREE_GRANULE);
+    palloc::add<inner_t>(new_pop, PBTREE_GRANULE);
+}
+
+// Remove every key and free every node, leaving this object allocated.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void pbtree<KEY_T, VAL_T, ROOT_T>::clear() {
+    PSTATS_OP(PSTATS_PBTREE, "clear");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PBTREE);
+
+        if (root != nullptr)
+            release(root, 0);
+
+        root = nullptr;
+        len = 0;
+        height = 0;
+    });
+}
+
+// Completely destroy this object and its allocated memory.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void pbtree<KEY_T, VAL_T, ROOT_T>::destroy() {
+    PSTATS_OP(PSTATS_PBTREE, "destroy");
+
+    clear();
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PBTREE);
+        PSTATS_FREE(PSTATS_PBTREE, sizeof(pbtree<KEY_T, VAL_T, ROOT_T>));
+
+        delete_persistent<pbtree<KEY_T, VAL_T, ROOT_T>>(this);
+    });
+}
+
+// Run the given function as one transaction, so a run of inserts inside it commits once.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+template <typename F>
+void pbtree<KEY_T, VAL_T, ROOT_T>::batch(F&& fn) {
+    PSTATS_OP(PSTATS_PBTREE, "batch");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PBTREE);
+        fn();
+    });
+}
@@ -0,0 +1,102 @@
+#ifndef _PCHECK_H
+#define _PCHECK_H
+
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../pvector/pvector.h"
+#include "../plist/plist.h"
+#include "../pstring/pstring.h"
+#include "../phashtable/phashtable.h"
+
+using namespace pmem;
+using namespace pmem::obj;
+
+// how many buckets of a hashtable make up one unit of work
+#define PCHECK_BUCKETS_PER_TASK 4096
+
+// What a check found about one container.
+struct pcheck_result {
+    std::string name;
+    const char* kind;
+
+    bool ok;
+    std::vector<std::string> errors;
+
+    // items stored (elements, nodes, characters or pairs)
+    long items;
+    // bytes holding those items, and bytes allocated for the container including spare capacity
+    size_t bytes_used;
+    size_t bytes_allocated;
+
+    void fail(const std::string&);
+    double fragmentation() const;
+};
+
+// Integrity checker for the collections, e.g. after an unclean shutdown. Containers are
+// registered with add(), then run() checks their invariants on a pool of threads:
+//   - pvector: len <= cap, and storage exists whenever cap > 0
+//   - plist: the node count matches len, tail is the last node, and the list ends there
+//   - pstring: cap == len + 1 and the characters are null-terminated
+//   - phashtable: every bucket is a sane plist, every pair sits in the bucket its key
+//     hashes to, and the pairs add up to len
+// Each container is a unit of work, and hashtables are further split into ranges of
+// buckets, so the run scales with the number of threads as long as there is more than one
+// unit. A single plist is checked by one thread walking it end to end. This is deliberate:
+// the only way to find nodes to split a chain at is to follow it from the head, which is
+// the same pointer chase as the check itself, and the pool's object list cannot tell one
+// list's nodes from another's. A pool whose data is mostly one long list checks at the
+// speed of one thread. Checks only read, so they may run on a pool that other threads are
+// not writing to.
+class pcheck {
+private:
+    // one slice of a container's check, writing into its own partial result
+    struct pcheck_task {
+        int target;
+        std::function<void(pcheck_result&)> fn;
+    };
+
+    std::vector<pcheck_result> results;
+    std::vector<pcheck_task> tasks;
+    // per container, run on its merged result once every task is done (may be empty)
+    std::vector<std::function<void(pcheck_result&)>> finishers;
+    int threads;
+
+    int add_result(const std::string&, const char*);
+    static void merge(pcheck_result&, const pcheck_result&);
+
+    template <typename VAL_T, typename ROOT_T>
+    static void check_list(pcheck_result&, const plist<VAL_T, ROOT_T>&, const std::string&);
+
+public:
+    // Constructor
+    explicit pcheck(int threads = 0);
+
+    // Registering
+    template <typename VAL_T, typename ROOT_T>
+    void add(const std::string&, const pvector<VAL_T, ROOT_T>&);
+    template <typename VAL_T, typename ROOT_T>
+    void add(const std::string&, const plist<VAL_T, ROOT_T>&);
+    template <typename ROOT_T>
+    void add(const std::string&, const pstring<ROOT_T>&);
+    template <typename KEY_T, typename VAL_T, typename ROOT_T>
+    void add(const std::string&, const phashtable<KEY_T, VAL_T, ROOT_T>&);
+
+    // Checking
+    const std::vector<pcheck_result>& run();
+
+    // Get/Set
+    const std::vector<pcheck_result>& get_results() const;
+    bool is_ok() const;
+
+    // Misc.
+    void report(std::ostream&) const;
+};
+
+#include "pcheck.hpp"
+
+#endif
@@ -0,0 +1,332 @@
+#include "pcheck.h"
+
+#include <cstdio>
+
+/* ========================================================================= */
+/* ***************************** pcheck_result ***************************** */
+/* ========================================================================= */
+
+// Mark the container as broken for the given reason.
+inline void pcheck_result::fail(const std::string& why) {
+    ok = false;
+    errors.push_back(why);
+}
+
+// Get the share of the allocated bytes that hold no items.
+inline double pcheck_result::fragmentation() const {
+    if (bytes_allocated == 0)
+        return 0;
+
+    return 1.0 - (double)bytes_used / bytes_allocated;
+}
+
+/* ========================================================================= */
+/* ******************************** pcheck ********************************* */
+/* ========================================================================= */
+
+/* ============================ CONSTRUCTORS =============================== */
+
+// Create a checker that runs on the given number of threads, or one per core if 0.
+inline pcheck::pcheck(int threads_in) {
+    threads = threads_in;
+
+    if (threads <= 0)
+        threads = std::thread::hardware_concurrency();
+
+    if (threads <= 0)
+        threads = 1;
+}
+
+/* ============================== REGISTERING ============================== */
+
+// Check the given vector under the given name.
+template <typename VAL_T, typename ROOT_T>
+void pcheck::add(const std::string& name, const pvector<VAL_T, ROOT_T>& v) {
+    int target = add_result(name, "pvector");
+
+    tasks.push_back({target, [&v](pcheck_result& res) {
+        if (v.len < 0)
+            res.fail("len is negative (" + std::to_string(v.len) + ")");
+
+        if (v.len > v.cap)
+            res.fail("len " + std::to_string(v.len) + " is past cap " + std::to_string(v.cap));
+
+        if (v.cap > 0 && v.arr == nullptr)
+            res.fail("cap is " + std::to_string(v.cap) + " but there is no storage");
+
+        res.items += v.len;
+        res.bytes_used += sizeof(v) + sizeof(VAL_T) * v.len;
+        res.bytes_allocated += sizeof(v) + sizeof(VAL_T) * v.cap;
+    }});
+}
+
+// Check the given list under the given name.
+template <typename VAL_T, typename ROOT_T>
+void pcheck::add(const std::string& name, const plist<VAL_T, ROOT_T>& l) {
+    int target = add_result(name, "plist");
+
+    tasks.push_back({target, [&l](pcheck_result& res) {
+        res.bytes_used += sizeof(l);
+        res.bytes_allocated += sizeof(l);
+
+        check_list(res, l, "");
+    }});
+}
+
+// Check the given string under the given name.
+template <typename ROOT_T>
+void pcheck::add(const std::string& name, const pstring<ROOT_T>& s) {
+    int target = add_result(name, "pstring");
+
+    tasks.push_back({target, [&s](pcheck_result& res) {
+        res.bytes_used += sizeof(s);
+        res.bytes_allocated += sizeof(s);
+
+        if (s.arr == nullptr) {
+            if (s.len != 0 || s.cap != 0)
+                res.fail("there is no storage but len is " + std::to_string(s.len) +
+                         " and cap is " + std::to_string(s.cap));
+
+            return;
+        }
+
+        if (s.len < 0 || s.cap != s.len + 1) {
+            res.fail("cap " + std::to_string(s.cap) + " is not len " + std::to_string(s.len) +
+                     " + 1");
+            return;
+        }
+
+        if (s.arr[s.len] != '\0')
+            res.fail("the string is not null-terminated");
+
+        res.items += s.len;
+        res.bytes_used += s.len + 1;
+        res.bytes_allocated += s.cap;
+    }});
+}
+
+// Check the given hashtable under the given name, split into ranges of buckets.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void pcheck::add(const std::string& name, const phashtable<KEY_T, VAL_T, ROOT_T>& t) {
+    int target = add_result(name, "phashtable");
+
+    // the table itself; only split it up if its bucket vector can be trusted
+    bool sane = t.data != nullptr && t.buckets >= 1 && t.data->len == t.buckets;
+
+    tasks.push_back({target, [&t, sane](pcheck_result& res) {
+        res.bytes_used += sizeof(t) + sizeof(*t.hash_function);
+        res.bytes_allocated += sizeof(t) + sizeof(*t.hash_function);
+
+        if (t.data == nullptr) {
+            res.fail("there is no bucket vector");
+            return;
+        }
+
+        if (!sane)
+            res.fail("there are " + std::to_string(t.buckets) + " buckets but the bucket "
+                     "vector holds " + std::to_string(t.data->len));
+
+        res.bytes_used += sizeof(*t.data) + sizeof(t.data->arr[0]) * t.data->len;
+        res.bytes_allocated += sizeof(*t.data) + sizeof(t.data->arr[0]) * t.data->cap;
+    }});
+
+    if (!sane)
+        return;
+
+    for (int lo = 0; lo < t.buckets; lo += PCHECK_BUCKETS_PER_TASK) {
+        int hi = lo + PCHECK_BUCKETS_PER_TASK < t.buckets ? lo + PCHECK_BUCKETS_PER_TASK
+                                                          : (int)t.buckets;
+
+        tasks.push_back({target, [&t, lo, hi](pcheck_result& res) {
+            for (int i = lo; i < hi; i++) {
+                auto& bucket = t.data->arr[i];
+                std::string where = "bucket " + std::to_string(i) + ": ";
+
+                long before = res.items;
+                check_list(res, bucket, where);
+
+                // only look at the pairs if the list they are in holds together
+                if (res.items - before != bucket.len)
+                    continue;
+
+                bucket.for_each([&](const ppair<KEY_T, VAL_T>& pair) {
+                    int home = t.hash(pair.key.get_ro());
+
+                    if (home != i)
+                        res.fail(where + "holds a key that hashes to bucket " +
+                                 std::to_string(home));
+                });
+            }
+        }});
+    }
+
+    // once every range is in, the pairs have to add up to the table's length
+    finishers[target] = [&t](pcheck_result& res) {
+        if (res.items != t.len)
+            res.fail("len is " + std::to_string(t.len) + " but the buckets hold " +
+                     std::to_string(res.items) + " pairs");
+    };
+}
+
+/* =============================== CHECKING ================================ */
+
+// Check every registered container, spreading the work over the threads. Returns one
+// result per container, in the order they were added.
+inline const std::vector<pcheck_result>& pcheck::run() {
+    for (auto& res : results) {
+        res.ok = true;
+        res.errors.clear();
+        res.items = 0;
+        res.bytes_used = 0;
+        res.bytes_allocated = 0;
+    }
+
+    // each task writes its own partial result, so the threads share nothing but the counter
+    std::vector<pcheck_result> partials(tasks.size());
+    std::atomic<size_t> next(0);
+
+    for (size_t i = 0; i < tasks.size(); i++)
+        partials[i] = results[tasks[i].target];
+
+    auto worker = [&] {
+        for (size_t i = next++; i < tasks.size(); i = next++) {
+            // a wild pointer can still crash us, but anything that throws is a finding
+            try {
+                tasks[i].fn(partials[i]);
+            }
+            catch (const std::exception& e) {
+                partials[i].fail(std::string("check threw: ") + e.what());
+            }
+        }
+    };
+
+    int n = threads < (int)tasks.size() ? threads : (int)tasks.size();
+    std::vector<std::thread> pool;
+
+    for (int i = 1; i < n; i++)
+        pool.emplace_back(worker);
+
+    worker();
+
+    for (auto& t : pool)
+        t.join();
+
+    // merging in task order keeps the report the same from run to run
+    for (size_t i = 0; i < tasks.size(); i++)
+        merge(results[tasks[i].target], partials[i]);
+
+    for (size_t i = 0; i < results.size(); i++) {
+        if (finishers[i])
+            finishers[i](results[i]);
+    }
+
+    return results;
+}
+
+/* =============================== GET/SET ================================= */
+
+// Get the results of the last run.
+inline const std::vector<pcheck_result>& pcheck::get_results() const {
+    return results;
+}
+
+// Get whether every container passed the last run.
+inline bool pcheck::is_ok() const {
+    for (const auto& res : results) {
+        if (!res.ok)
+            return false;
+    }
+
+    return true;
+}
+
+/* ================================ MISC. ================================== */
+
+// Print one line per container with its sizes, followed by any errors found in it.
+inline void pcheck::report(std::ostream& os) const {
+    int failed = 0;
+
+    for (const auto& res : results) {
+        char frag[16];
+        snprintf(frag, sizeof(frag), "%.1f%%", res.fragmentation() * 100);
+
+        os << res.name << " (" << res.kind << "): " << (res.ok ? "ok" : "FAILED")
+           << " items=" << res.items << " bytes_used=" << res.bytes_used
+           << " bytes_allocated=" << res.bytes_allocated << " fragmentation=" << frag
+           << std::endl;
+
+        for (const auto& err : res.errors)
+            os << "    " << err << std::endl;
+
+        if (!res.ok)
+            failed++;
+    }
+
+    os << results.size() << " containers checked, " << failed << " failed" << std::endl;
+}
+
+// Start a result for a new container, returning its index.
+inline int pcheck::add_result(const std::string& name, const char* kind) {
+    pcheck_result res;
+    res.name = name;
+    res.kind = kind;
+    res.ok = true;
+    res.items = 0;
+    res.bytes_used = 0;
+    res.bytes_allocated = 0;
+
+    results.push_back(res);
+    finishers.push_back(nullptr);
+
+    return results.size() - 1;
+}
+
+// Add a partial result into the container's result.
+inline void pcheck::merge(pcheck_result& into, const pcheck_result& part) {
+    into.ok = into.ok && part.ok;
+    into.errors.insert(into.errors.end(), part.errors.begin(), part.errors.end());
+    into.items += part.items;
+    into.bytes_used += part.bytes_used;
+    into.bytes_allocated += part.bytes_allocated;
+}
+
+// Walk the given list, checking its length and tail against its nodes and counting them.
+// The walk stops one node past len, so a cycle cannot keep it going forever. It is one
+// pointer chase on one thread, however long the list (see pcheck).
+template <typename VAL_T, typename ROOT_T>
+void pcheck::check_list(pcheck_result& res, const plist<VAL_T, ROOT_T>& l,
+                        const std::string& where) {
+    if (l.len < 0) {
+        res.fail(where + "len is negative (" + std::to_string(l.len) + ")");
+        return;
+    }
+
+    if (l.len == 0) {
+        if (l.head != nullptr || l.tail != nullptr)
+            res.fail(where + "len is 0 but head or tail is set");
+
+        return;
+    }
+
+    auto current = l.head;
+    persistent_ptr<pnode<VAL_T, ROOT_T>> last = nullptr;
+    long count = 0;
+
+    while (current != nullptr && count <= l.len) {
+        last = current;
+        current = current->get_next();
+        count++;
+    }
+
+    if (count > l.len)
+        res.fail(where + "there are more nodes than len " + std::to_string(l.len));
+    else if (count != l.len)
+        res.fail(where + "len is " + std::to_string(l.len) + " but there are " +
+                 std::to_string(count) + " nodes");
+    else if (last != l.tail)
+        res.fail(where + "tail is not the last node");
+
+    res.items += count;
+    res.bytes_used += sizeof(pnode<VAL_T, ROOT_T>) * count;
+    res.bytes_allocated += sizeof(pnode<VAL_T, ROOT_T>) * count;
+}
@@ -0,0 +1,137 @@
+#ifndef _PCOWVECTOR_H
+#define _PCOWVECTOR_H
+
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/mutex.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/transaction.hpp>
+#include <iostream>
+#include <stdexcept>
+#include "../pstats/pstats.h"
+#include "../ptx/ptx.h"
+
+using namespace pmem;
+using namespace pmem::obj;
+
+// each node of the radix tree holds 2^PCOW_BITS children or values
+#define PCOW_BITS 6
+#define PCOW_WIDTH (1 << PCOW_BITS)
+#define PCOW_MASK (PCOW_WIDTH - 1)
+
+// forward declaration of classes
+template <typename VAL_T, typename ROOT_T>
+class pcowsnapshot;
+
+template <typename VAL_T, typename ROOT_T>
+class pcowvector;
+
+// forward declare the friend function so generics work
+template <typename VAL_T, typename ROOT_T>
+std::ostream& operator<<(std::ostream&, const pcowvector<VAL_T, ROOT_T>&);
+
+// A block of the radix tree. Blocks are shared between the live vector and any snapshots;
+// refs counts how many parents or owners point at one, and only a block with a single
+// reference may be edited in place.
+class pcowblock {
+public:
+    p<int> refs;
+};
+
+// An interior block, whose children are interior blocks or, on the last level, leaves.
+class pcownode : public pcowblock {
+public:
+    persistent_ptr<pcowblock> kids[PCOW_WIDTH];
+};
+
+// A leaf block, holding PCOW_WIDTH values.
+template <typename VAL_T>
+class pcowleaf : public pcowblock {
+public:
+    VAL_T vals[PCOW_WIDTH];
+};
+
+// Find the leaf holding the given index in the tree with the given root and level count.
+template <typename VAL_T>
+persistent_ptr<pcowleaf<VAL_T>> pcow_find_leaf(persistent_ptr<pcowblock>, int, int);
+
+// A frozen version of a pcowvector. Taking one is O(1) and it never changes afterwards, so
+// any number of threads may read it without locks while the vector keeps being edited.
+// Hand it back to the vector's release() when done so unshared blocks can be reclaimed.
+template <typename VAL_T, typename ROOT_T>
+class pcowsnapshot {
+private:
+    persistent_ptr<pcowblock> root;
+    p<int> len;
+    p<int> levels;
+
+    friend class pcowvector<VAL_T, ROOT_T>;
+
+public:
+    // Constructor
+    pcowsnapshot(persistent_ptr<pcowblock>, int, int);
+
+    // Operator Overloads
+    const VAL_T& operator[](int) const;
+
+    // Get/Set
+    int get_length() const;
+
+    // Misc.
+    template <typename F>
+    void for_each(F&&) const;
+};
+
+template <typename VAL_T, typename ROOT_T>
+class pcowvector {
+private:
+    // the live version
+    persistent_ptr<pcowblock> root;
+    p<int> len;
+    // number of levels in the tree, counting the leaves
+    p<int> levels;
+
+    // serializes editors with snapshot() and release() until their transaction ends;
+    // readers of snapshots never take it
+    pmem::obj::mutex wlock;
+    pool<ROOT_T> pop;
+
+    int capacity() const;
+    VAL_T& writable(int);
+    void grow();
+    persistent_ptr<pcowblock> unshare(persistent_ptr<pcowblock>, bool);
+    void release_block(persistent_ptr<pcowblock>, int);
+
+public:
+    // Constructor
+    explicit pcowvector(pool<ROOT_T>);
+
+    // Operator Overloads
+    const VAL_T& operator[](int) const;
+    friend std::ostream& operator<< <>(std::ostream&, const pcowvector<VAL_T, ROOT_T>&);
+
+    // Push/Pop
+    void push_back(const VAL_T&);
+    VAL_T pop_back();
+
+    void insert(const VAL_T&, int);
+    VAL_T remove(int);
+
+    // Get/Set
+    void set(int, const VAL_T&);
+    int get_length() const;
+
+    // Snapshots
+    persistent_ptr<pcowsnapshot<VAL_T, ROOT_T>> snapshot();
+    void release(persistent_ptr<pcowsnapshot<VAL_T, ROOT_T>>);
+
+    // Misc.
+    template <typename F>
+    void batch(F&&);
+    void refresh_pool(pool<ROOT_T>);
+    void clear();
+    void destroy();
+};
+
+#include "pcowvector.hpp"
+
+#endif
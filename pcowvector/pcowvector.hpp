@@ -0,0 +1,457 @@
+#include "pcowvector.h"
+
+/* ========================================================================= */
+/* ****************************** radix tree ******************************* */
+/* ========================================================================= */
+
+// Find the leaf holding the given index in the tree with the given root and level count.
+// Only reads, so it is safe on a snapshot while the live vector is being edited.
+template <typename VAL_T>
+persistent_ptr<pcowleaf<VAL_T>> pcow_find_leaf(persistent_ptr<pcowblock> block, int levels, int idx) {
+    // walk down the interior levels, picking the child by that level's bits of the index
+    for (int level = levels - 1; level > 0 && block != nullptr; level--) {
+        persistent_ptr<pcownode> node(block.raw());
+        block = node->kids[(idx >> (level * PCOW_BITS)) & PCOW_MASK];
+    }
+
+    return persistent_ptr<pcowleaf<VAL_T>>(block.raw());
+}
+
+/* ========================================================================= */
+/* ***************************** pcowsnapshot ****************************** */
+/* ========================================================================= */
+
+/* ============================ CONSTRUCTORS =============================== */
+
+// Create a snapshot of the tree with the given root, length and level count. Only
+// pcowvector::snapshot() should call this, as it also takes the reference on the root.
+template <typename VAL_T, typename ROOT_T>
+pcowsnapshot<VAL_T, ROOT_T>::pcowsnapshot(persistent_ptr<pcowblock> root_in, int len_in, int levels_in) {
+    root = root_in;
+    len = len_in;
+    levels = levels_in;
+}
+
+/* ========================== OPERATOR OVERLOADS =========================== */
+
+// Get the item at the given index as of when the snapshot was taken.
+template <typename VAL_T, typename ROOT_T>
+const VAL_T& pcowsnapshot<VAL_T, ROOT_T>::operator[](int idx) const {
+    if (idx < 0 || idx >= len)
+        throw std::out_of_range("Cannot access past the range of the snapshot.");
+
+    return pcow_find_leaf<VAL_T>(root, levels, idx)->vals[idx & PCOW_MASK];
+}
+
+/* =============================== GET/SET ================================= */
+
+// Get the length of the vector as of when the snapshot was taken.
+template <typename VAL_T, typename ROOT_T>
+int pcowsnapshot<VAL_T, ROOT_T>::get_length() const {
+    return len;
+}
+
+/* ================================ MISC. ================================== */
+
+// Call the given function on every item in order, one leaf at a time.
+template <typename VAL_T, typename ROOT_T>
+template <typename F>
+void pcowsnapshot<VAL_T, ROOT_T>::for_each(F&& fn) const {
+    for (int base = 0; base < len; base += PCOW_WIDTH) {
+        auto leaf = pcow_find_leaf<VAL_T>(root, levels, base);
+        int n = len - base < PCOW_WIDTH ? len - base : PCOW_WIDTH;
+
+        for (int i = 0; i < n; i++)
+            fn(leaf->vals[i]);
+    }
+}
+
+/* ========================================================================= */
+/* ****************************** pcowvector ******************************* */
+/* ========================================================================= */
+
+/* ============================ CONSTRUCTORS =============================== */
+
+// Create a new, empty pcowvector. Blocks are only allocated once items are added.
+template <typename VAL_T, typename ROOT_T>
+pcowvector<VAL_T, ROOT_T>::pcowvector(pool<ROOT_T> pop_in) {
+    PSTATS_OP(PSTATS_PCOWVECTOR, "construct");
+    pop = pop_in;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PCOWVECTOR);
+        root = nullptr;
+        len = 0;
+        levels = 0;
+    });
+}
+
+/* ========================== OPERATOR OVERLOADS =========================== */
+
+// Get the item at the given index of the live version.
+template <typename VAL_T, typename ROOT_T>
+const VAL_T& pcowvector<VAL_T, ROOT_T>::operator[](int idx) const {
+    if (idx < 0 || idx >= len)
+        throw std::out_of_range("Cannot access past the range of the vector.");
+
+    return pcow_find_leaf<VAL_T>(root, levels, idx)->vals[idx & PCOW_MASK];
+}
+
+// Print the live version to the given output stream.
+template <typename VAL_T, typename ROOT_T>
+std::ostream& operator<<(std::ostream& os, const pcowvector<VAL_T, ROOT_T>& v) {
+    PSTATS_OP(PSTATS_PCOWVECTOR, "operator<<");
+    os << "[";
+
+    for (int i = 0; i < v.len; i++) {
+        if (i > 0)
+            os << ", ";
+
+        os << v[i];
+    }
+
+    os << "]";
+
+    return os;
+}
+
+/* ============================== PUSH/POP ================================= */
+
+// Insert the given value at the back of the vector, growing the tree if necessary.
+template <typename VAL_T, typename ROOT_T>
+void pcowvector<VAL_T, ROOT_T>::push_back(const VAL_T& val) {
+    PSTATS_OP(PSTATS_PCOWVECTOR, "push_back");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PCOWVECTOR);
+        ptx::lock(wlock);
+
+        if (len >= capacity())
+            grow();
+
+        writable(len) = val;
+        len++;
+    });
+}
+
+// Remove and return the value at the back of the vector. Blocks are kept for reuse.
+template <typename VAL_T, typename ROOT_T>
+VAL_T pcowvector<VAL_T, ROOT_T>::pop_back() {
+    PSTATS_OP(PSTATS_PCOWVECTOR, "pop_back");
+
+    VAL_T val;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PCOWVECTOR);
+        ptx::lock(wlock);
+
+        if (len == 0)
+            throw std::out_of_range("Cannot pop the back of an empty vector.");
+
+        val = (*this)[len - 1];
+        len--;
+    });
+
+    return val;
+}
+
+// Insert the given value at the given index, shifting later items back.
+template <typename VAL_T, typename ROOT_T>
+void pcowvector<VAL_T, ROOT_T>::insert(const VAL_T& val, int idx) {
+    PSTATS_OP(PSTATS_PCOWVECTOR, "insert");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PCOWVECTOR);
+        ptx::lock(wlock);
+
+        if (idx < 0 || idx > len)
+            throw std::out_of_range("Cannot insert past the range of the vector.");
+
+        if (len >= capacity())
+            grow();
+
+        // shared blocks are copied the first time they are written, then edited in place
+        for (int i = len; i > idx; i--) {
+            VAL_T prev = (*this)[i - 1];
+            writable(i) = prev;
+        }
+
+        writable(idx) = val;
+        len++;
+    });
+}
+
+// Remove the item at the given index and return the removed value.
+template <typename VAL_T, typename ROOT_T>
+VAL_T pcowvector<VAL_T, ROOT_T>::remove(int idx) {
+    PSTATS_OP(PSTATS_PCOWVECTOR, "remove");
+
+    VAL_T val;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PCOWVECTOR);
+        ptx::lock(wlock);
+
+        if (idx < 0 || idx >= len)
+            throw std::out_of_range("Cannot remove past the range of the vector.");
+
+        val = (*this)[idx];
+
+        for (int i = idx; i < len - 1; i++) {
+            VAL_T next = (*this)[i + 1];
+            writable(i) = next;
+        }
+
+        len--;
+    });
+
+    return val;
+}
+
+/* =============================== GET/SET ================================= */
+
+// Set the item at the given index, copying any block it shares with a snapshot first.
+template <typename VAL_T, typename ROOT_T>
+void pcowvector<VAL_T, ROOT_T>::set(int idx, const VAL_T& val) {
+    PSTATS_OP(PSTATS_PCOWVECTOR, "set");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PCOWVECTOR);
+        ptx::lock(wlock);
+
+        if (idx < 0 || idx >= len)
+            throw std::out_of_range("Cannot set past the range of the vector.");
+
+        writable(idx) = val;
+    });
+}
+
+// Get the length of the live version.
+template <typename VAL_T, typename ROOT_T>
+int pcowvector<VAL_T, ROOT_T>::get_length() const {
+    return len;
+}
+
+/* =============================== SNAPSHOTS =============================== */
+
+// Freeze the live version in O(1): the snapshot takes a reference on the root, and any
+// later edit copies the blocks on its path instead of changing them.
+template <typename VAL_T, typename ROOT_T>
+persistent_ptr<pcowsnapshot<VAL_T, ROOT_T>> pcowvector<VAL_T, ROOT_T>::snapshot() {
+    PSTATS_OP(PSTATS_PCOWVECTOR, "snapshot");
+
+    persistent_ptr<pcowsnapshot<VAL_T, ROOT_T>> snap;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PCOWVECTOR);
+        ptx::lock(wlock);
+        PSTATS_ALLOC(PSTATS_PCOWVECTOR, sizeof(pcowsnapshot<VAL_T, ROOT_T>));
+
+        if (root != nullptr)
+            root->refs++;
+
+        snap = make_persistent<pcowsnapshot<VAL_T, ROOT_T>>(root, len, levels);
+    });
+
+    return snap;
+}
+
+// Give back a snapshot taken from this vector, freeing every block only it still uses.
+template <typename VAL_T, typename ROOT_T>
+void pcowvector<VAL_T, ROOT_T>::release(persistent_ptr<pcowsnapshot<VAL_T, ROOT_T>> snap) {
+    PSTATS_OP(PSTATS_PCOWVECTOR, "release");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PCOWVECTOR);
+        ptx::lock(wlock);
+
+        release_block(snap->root, snap->levels - 1);
+
+        PSTATS_FREE(PSTATS_PCOWVECTOR, sizeof(pcowsnapshot<VAL_T, ROOT_T>));
+        delete_persistent<pcowsnapshot<VAL_T, ROOT_T>>(snap);
+    });
+}
+
+/* ================================ MISC. ================================== */
+
+// Get how many items the tree can hold without adding a level.
+template <typename VAL_T, typename ROOT_T>
+int pcowvector<VAL_T, ROOT_T>::capacity() const {
+    return levels == 0 ? 0 : 1 << (levels * PCOW_BITS);
+}
+
+// Add a level on top of the tree, with the old root as its first child.
+template <typename VAL_T, typename ROOT_T>
+void pcowvector<VAL_T, ROOT_T>::grow() {
+    if (root != nullptr) {
+        PSTATS_ALLOC(PSTATS_PCOWVECTOR, sizeof(pcownode));
+
+        // the new root takes over our reference on the old one, so no refcounts change
+        auto node = make_persistent<pcownode>();
+        node->refs = 1;
+        node->kids[0] = root;
+
+        root = persistent_ptr<pcowblock>(node.raw());
+    }
+
+    levels++;
+}
+
+// Get a block that only we reference, ready to be edited in place: a fresh one if there
+// is none yet, the given one if it is not shared, or otherwise a copy of it. Must run
+// inside a transaction.
+template <typename VAL_T, typename ROOT_T>
+persistent_ptr<pcowblock> pcowvector<VAL_T, ROOT_T>::unshare(persistent_ptr<pcowblock> block, bool leaf) {
+    if (block != nullptr && block->refs == 1)
+        return block;
+
+    persistent_ptr<pcowblock> copy;
+
+    if (leaf) {
+        PSTATS_ALLOC(PSTATS_PCOWVECTOR, sizeof(pcowleaf<VAL_T>));
+        auto fresh = make_persistent<pcowleaf<VAL_T>>();
+
+        if (block != nullptr) {
+            persistent_ptr<pcowleaf<VAL_T>> old(block.raw());
+
+            for (int i = 0; i < PCOW_WIDTH; i++)
+                fresh->vals[i] = old->vals[i];
+        }
+
+        copy = persistent_ptr<pcowblock>(fresh.raw());
+    }
+    else {
+        PSTATS_ALLOC(PSTATS_PCOWVECTOR, sizeof(pcownode));
+        auto fresh = make_persistent<pcownode>();
+
+        if (block != nullptr) {
+            persistent_ptr<pcownode> old(block.raw());
+
+            // the copy is one more parent for every child
+            for (int i = 0; i < PCOW_WIDTH; i++) {
+                fresh->kids[i] = old->kids[i];
+
+                if (fresh->kids[i] != nullptr)
+                    fresh->kids[i]->refs++;
+            }
+        }
+
+        copy = persistent_ptr<pcowblock>(fresh.raw());
+    }
+
+    copy->refs = 1;
+
+    // our parent will point at the copy now, so the original loses that reference
+    if (block != nullptr)
+        block->refs--;
+
+    return copy;
+}
+
+// Get a reference to the slot for the given index, unsharing every block on its path.
+// The slot is added to the transaction, so it may be assigned directly.
+template <typename VAL_T, typename ROOT_T>
+VAL_T& pcowvector<VAL_T, ROOT_T>::writable(int idx) {
+    persistent_ptr<pcowblock>* slot = &root;
+
+    for (int level = levels - 1; level >= 0; level--) {
+        auto block = unshare(*slot, level == 0);
+
+        if (block != *slot)
+            *slot = block;
+
+        if (level == 0)
+            break;
+
+        persistent_ptr<pcownode> node(block.raw());
+        slot = &node->kids[(idx >> (level * PCOW_BITS)) & PCOW_MASK];
+    }
+
+    persistent_ptr<pcowleaf<VAL_T>> leaf(slot->raw());
+    VAL_T& val = leaf->vals[idx & PCOW_MASK];
+
+    flat_transaction::snapshot(&val);
+
+    return val;
+}
+
+// Drop one reference to the given block on the given level (0 for leaves), freeing it and
+// releasing its children once nothing references it. Must run inside a transaction.
+template <typename VAL_T, typename ROOT_T>
+void pcowvector<VAL_T, ROOT_T>::release_block(persistent_ptr<pcowblock> block, int level) {
+    if (block == nullptr)
+        return;
+
+    block->refs--;
+
+    if (block->refs > 0)
+        return;
+
+    if (level == 0) {
+        PSTATS_FREE(PSTATS_PCOWVECTOR, sizeof(pcowleaf<VAL_T>));
+        delete_persistent<pcowleaf<VAL_T>>(persistent_ptr<pcowleaf<VAL_T>>(block.raw()));
+    }
+    else {
+        persistent_ptr<pcownode> node(block.raw());
+
+        for (int i = 0; i < PCOW_WIDTH; i++)
+            release_block(node->kids[i], level - 1);
+
+        PSTATS_FREE(PSTATS_PCOWVECTOR, sizeof(pcownode));
+        delete_persistent<pcownode>(node);
+    }
+}
+
+// Refresh the reference to the pool that this vector lives in. Must be called
+// when using a pcowvector from an existing file.
+template <typename VAL_T, typename ROOT_T>
+void pcowvector<VAL_T, ROOT_T>::refresh_pool(pool<ROOT_T> new_pop) {
+    pop = new_pop;
+}
+
+// Remove all items from the live version. Blocks still used by snapshots are kept
+// until those are released.
+template <typename VAL_T, typename ROOT_T>
+void pcowvector<VAL_T, ROOT_T>::clear() {
+    PSTATS_OP(PSTATS_PCOWVECTOR, "clear");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PCOWVECTOR);
+        ptx::lock(wlock);
+
+        release_block(root, levels - 1);
+
+        root = nullptr;
+        len = 0;
+        levels = 0;
+    });
+}
+
+// Completely destroy this object and the blocks only it uses. Snapshots taken from it
+// must be released first.
+template <typename VAL_T, typename ROOT_T>
+void pcowvector<VAL_T, ROOT_T>::destroy() {
+    PSTATS_OP(PSTATS_PCOWVECTOR, "destroy");
+
+    clear();
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PCOWVECTOR);
+        PSTATS_FREE(PSTATS_PCOWVECTOR, sizeof(pcowvector<VAL_T, ROOT_T>));
+
+        delete_persistent<pcowvector<VAL_T, ROOT_T>>(this);
+    });
+}
+
+// Run the given function as a single transaction, so every edit made inside it commits
+// together. Only call snapshot() and release() inside it from the same thread.
+template <typename VAL_T, typename ROOT_T>
+template <typename F>
+void pcowvector<VAL_T, ROOT_T>::batch(F&& fn) {
+    PSTATS_OP(PSTATS_PCOWVECTOR, "batch");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PCOWVECTOR);
+        fn();
+    });
+}
@@ -0,0 +1,81 @@
+#ifndef _PDUMP_H
+#define _PDUMP_H
+
+#include <charconv>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../pstats/pstats.h"
+
+// how many bytes of text a dump formats in DRAM before each write
+#define PDUMP_CHUNK ((size_t)(64 * 1024))
+// fewest items each thread of a parallel dump formats at a time
+#define PDUMP_GRAIN (1 << 16)
+
+// Where a text dump goes: a file descriptor, written with large write(2) and writev(2)
+// calls, or any std::ostream, written a chunk at a time. Floating point values are
+// written with the given number of significant digits, like "%g", or with as many as it
+// takes to read them back exactly if it is negative. An ostream sink takes the precision
+// and the fixed or scientific notation of the stream. Other stream settings (width, fill,
+// base, locale, ...) are not reproduced, so operator<< checks reproduces() first and
+// streams the items itself when it is false.
+class pdump_sink {
+private:
+    std::ostream* os;
+    int fd;
+    int precision;
+    std::chars_format format;
+
+public:
+    // Constructors
+    explicit pdump_sink(int, int precision = -1);
+    explicit pdump_sink(std::ostream&);
+
+    // Writing
+    void write(const char*, size_t);
+    void write(const std::vector<std::string>&, size_t);
+
+    // Get/Set
+    int get_precision() const;
+    std::chars_format get_format() const;
+    static bool reproduces(const std::ostream&);
+};
+
+// Text formatted in DRAM on its way to a sink. Items are appended into a buffer that is
+// written out whenever it holds PDUMP_CHUNK bytes, so a dump costs a write per chunk
+// instead of a stream call per item. Call flush() at the end to write out the rest.
+// Numbers are formatted with std::to_chars, with no locale or stream state to consult;
+// anything else goes through its operator<<.
+class pdump {
+private:
+    pdump_sink* sink;
+    int precision;
+    std::chars_format format;
+    std::string buf;
+
+public:
+    // Constructors
+    explicit pdump(pdump_sink&);
+    explicit pdump(int, std::chars_format format = std::chars_format::general);
+
+    pdump(const pdump&) = delete;
+    pdump& operator=(const pdump&) = delete;
+
+    // Writing
+    void put(char);
+    void put(std::string_view);
+    template <typename T>
+    void put_value(const T&);
+    void flush();
+
+    // Misc.
+    std::string& text();
+    template <typename F>
+    static void parallel(pdump_sink&, int, int, F&&);
+};
+
+#include "pdump.hpp"
+
+#endif
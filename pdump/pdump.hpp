@@ -0,0 +1,295 @@
+#include "pdump.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <ios>
+#include <limits>
+#include <locale>
+#include <exception>
+#include <sstream>
+#include <stdexcept>
+#include <sys/uio.h>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+
+/* ========================================================================= */
+/* ****************************** pdump_sink ******************************* */
+/* ========================================================================= */
+
+/* ============================ CONSTRUCTORS =============================== */
+
+// Write to the given file descriptor, which stays open and owned by the caller.
+inline pdump_sink::pdump_sink(int fd_in, int precision_in) {
+    os = nullptr;
+    fd = fd_in;
+    precision = precision_in;
+    format = std::chars_format::general;
+}
+
+// Write to the given output stream, which must outlive this sink.
+inline pdump_sink::pdump_sink(std::ostream& os_in) {
+    os = &os_in;
+    fd = -1;
+    precision = (int)os_in.precision();
+
+    auto floatfield = os_in.flags() & std::ios_base::floatfield;
+    if (floatfield == std::ios_base::fixed)
+        format = std::chars_format::fixed;
+    else if (floatfield == std::ios_base::scientific)
+        format = std::chars_format::scientific;
+    else
+        format = std::chars_format::general;
+}
+
+/* ================================ WRITING ================================ */
+
+// Write the given n bytes.
+inline void pdump_sink::write(const char* data, size_t n) {
+    if (os != nullptr) {
+        os->write(data, n);
+        return;
+    }
+
+    while (n > 0) {
+        ssize_t done = ::write(fd, data, n);
+
+        if (done < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("Cannot write dump: ") + strerror(errno));
+        }
+
+        data += done;
+        n -= done;
+    }
+}
+
+// Write the first n of the given parts, in order, gathering as many as the kernel takes
+// into each writev call.
+inline void pdump_sink::write(const std::vector<std::string>& parts, size_t n) {
+    if (os != nullptr) {
+        for (size_t i = 0; i < n; i++)
+            os->write(parts[i].data(), parts[i].size());
+        return;
+    }
+
+    std::vector<struct iovec> iov;
+    for (size_t i = 0; i < n; i++) {
+        if (!parts[i].empty())
+            iov.push_back({(void*)parts[i].data(), parts[i].size()});
+    }
+
+    size_t at = 0;
+
+    while (at < iov.size()) {
+        int count = (int)std::min(iov.size() - at, (size_t)IOV_MAX);
+        ssize_t done = ::writev(fd, &iov[at], count);
+
+        if (done < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("Cannot write dump: ") + strerror(errno));
+        }
+
+        // skip what was written whole, and trim what was written in part
+        while (at < iov.size() && (size_t)done >= iov[at].iov_len) {
+            done -= iov[at].iov_len;
+            at++;
+        }
+
+        if (done > 0) {
+            iov[at].iov_base = (char*)iov[at].iov_base + done;
+            iov[at].iov_len -= done;
+        }
+    }
+}
+
+/* =============================== GET/SET ================================= */
+
+// Get the significant digits written for floating point values, or -1 for as many as it
+// takes to read them back exactly.
+inline int pdump_sink::get_precision() const {
+    return precision;
+}
+
+// Get the notation written for floating point values.
+inline std::chars_format pdump_sink::get_format() const {
+    return format;
+}
+
+// Get whether a sink on the given stream writes numbers exactly as the stream itself
+// would: no width or fill, decimal, no flags but fixed or scientific (not both, which is
+// hexfloat), and the classic locale.
+inline bool pdump_sink::reproduces(const std::ostream& os) {
+    const auto allowed = std::ios_base::dec | std::ios_base::fixed | std::ios_base::scientific |
+                         std::ios_base::skipws | std::ios_base::unitbuf;
+
+    return os.width() == 0 && os.fill() == os.widen(' ') && (os.flags() & ~allowed) == 0 &&
+           (os.flags() & std::ios_base::floatfield) != std::ios_base::floatfield &&
+           os.getloc() == std::locale::classic();
+}
+
+/* ========================================================================= */
+/* ********************************* pdump ********************************* */
+/* ========================================================================= */
+
+/* ============================ CONSTRUCTORS =============================== */
+
+// Format text for the given sink.
+inline pdump::pdump(pdump_sink& sink_in) {
+    sink = &sink_in;
+    precision = sink_in.get_precision();
+    format = sink_in.get_format();
+    buf.reserve(PDUMP_CHUNK + 64);
+}
+
+// Format text with the given precision and notation that is only kept, for the caller to
+// take with text(), and never written anywhere.
+inline pdump::pdump(int precision_in, std::chars_format format_in) {
+    sink = nullptr;
+    precision = precision_in;
+    format = format_in;
+}
+
+/* ================================ WRITING ================================ */
+
+// Append the given character.
+inline void pdump::put(char c) {
+    buf.push_back(c);
+
+    if (sink != nullptr && buf.size() >= PDUMP_CHUNK)
+        flush();
+}
+
+// Append the given characters. A run bigger than a chunk is written straight from where it
+// lies instead of being copied.
+inline void pdump::put(std::string_view str) {
+    if (sink != nullptr && str.size() >= PDUMP_CHUNK) {
+        flush();
+        sink->write(str.data(), str.size());
+        return;
+    }
+
+    buf.append(str.data(), str.size());
+
+    if (sink != nullptr && buf.size() >= PDUMP_CHUNK)
+        flush();
+}
+
+// Append the given value as operator<< would print it: bools as 1 or 0, characters as
+// themselves, numbers through std::to_chars, and anything else through its operator<<.
+template <typename T>
+void pdump::put_value(const T& val) {
+    if constexpr (std::is_same<T, bool>::value) {
+        put(val ? '1' : '0');
+    }
+    else if constexpr (std::is_same<T, char>::value || std::is_same<T, signed char>::value ||
+                       std::is_same<T, unsigned char>::value) {
+        put((char)val);
+    }
+    else if constexpr (std::is_arithmetic<T>::value) {
+        char num[64];
+        std::to_chars_result res;
+
+        if constexpr (std::is_floating_point<T>::value) {
+            if (precision < 0) {
+                res = std::to_chars(num, num + sizeof(num), val);
+            }
+            else {
+                // "%g" treats a precision of 0 as 1, while "%f" and "%e" take it as is
+                int digits = format == std::chars_format::general && precision == 0 ? 1 : precision;
+                res = std::to_chars(num, num + sizeof(num), val, format, digits);
+
+                // a large value in fixed notation can take hundreds of digits
+                if (res.ec == std::errc::value_too_large) {
+                    std::string wide(std::numeric_limits<T>::max_exponent10 + digits + 8, '\0');
+                    res = std::to_chars(wide.data(), wide.data() + wide.size(), val, format, digits);
+                    put(std::string_view(wide.data(), res.ptr - wide.data()));
+                    return;
+                }
+            }
+        }
+        else {
+            res = std::to_chars(num, num + sizeof(num), val);
+        }
+
+        put(std::string_view(num, res.ptr - num));
+    }
+    else {
+        std::ostringstream ss;
+        ss << val;
+        put(ss.str());
+    }
+}
+
+// Write out everything appended so far.
+inline void pdump::flush() {
+    if (sink == nullptr || buf.empty())
+        return;
+
+    sink->write(buf.data(), buf.size());
+    buf.clear();
+}
+
+/* ================================ MISC. ================================== */
+
+// Get the text kept so far.
+inline std::string& pdump::text() {
+    return buf;
+}
+
+// Format n items on the given number of threads and write them to the given sink in
+// order. Each round, every thread formats the next PDUMP_GRAIN items into text of its
+// own, calling fn(out, lo, hi) for items lo to hi, and the texts are then written with
+// one gathering write, so no more than a round of text is ever held in DRAM.
+template <typename F>
+void pdump::parallel(pdump_sink& sink, int n, int threads, F&& fn) {
+    PSTATS_OP(PSTATS_OTHER, "pdump::parallel");
+
+    if (threads < 1)
+        threads = 1;
+
+    std::vector<std::string> parts(threads);
+    std::vector<std::exception_ptr> failures(threads);
+
+    for (long round = 0; round < n; round += (long)threads * PDUMP_GRAIN) {
+        std::vector<std::thread> workers;
+        size_t count = 0;
+
+        for (int t = 0; t < threads; t++) {
+            long lo = round + (long)t * PDUMP_GRAIN;
+            long hi = std::min(lo + PDUMP_GRAIN, (long)n);
+
+            if (lo >= n)
+                break;
+
+            count++;
+            workers.emplace_back([&, t, lo, hi] {
+                try {
+                    pdump out(sink.get_precision(), sink.get_format());
+                    out.text().swap(parts[t]);
+                    out.text().clear();
+                    fn(out, (int)lo, (int)hi);
+                    out.text().swap(parts[t]);
+                }
+                catch (...) {
+                    failures[t] = std::current_exception();
+                }
+            });
+        }
+
+        for (auto& w : workers)
+            w.join();
+
+        for (auto& f : failures) {
+            if (f)
+                std::rethrow_exception(f);
+        }
+
+        sink.write(parts, count);
+    }
+}
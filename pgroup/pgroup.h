@@ -0,0 +1,95 @@
+#ifndef _PGROUP_H
+#define _PGROUP_H
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../pstats/pstats.h"
+#include "../ptx/ptx.h"
+
+using namespace pmem;
+using namespace pmem::obj;
+
+// Relaxed-durability front end for any of the collections. Mutations are staged in
+// DRAM and applied to the container in groups, one transaction per group.
+//
+// Durability contract:
+//   - a staged mutation is NOT durable; a crash loses everything not yet flushed
+//   - a group is applied atomically: after a crash the container holds every mutation
+//     of a flushed group or none of them, and groups are applied in staging order
+//   - a group is flushed once it holds max_ops mutations, once its oldest mutation is
+//     max_delay old (checked by a background thread, or on the next stage() if that
+//     thread is disabled), or when sync() is called
+//   - sync() returns only once everything staged before it is durable
+//   - groups are applied on whichever thread flushes them, including the background
+//     one, so the container must only be read through read(), which holds off flushes
+//     while it runs; it sees every flushed group but no staged mutation, so call sync()
+//     first to read your own writes
+//
+// If a mutation throws while its group is applied, the whole group is rolled back and
+// the exception is rethrown from sync(), or from the next stage() for background flushes.
+template <typename CONT_T, typename ROOT_T>
+class pgroup {
+private:
+    pool<ROOT_T> pop;
+    persistent_ptr<CONT_T> target;
+
+    size_t max_ops;
+    std::chrono::milliseconds max_delay;
+
+    // mutations waiting for the next group, and when the oldest of them was staged
+    std::vector<std::function<void(CONT_T&)>> staged;
+    std::chrono::steady_clock::time_point oldest;
+
+    // guards staged/oldest/failure/stopping; flush_lock keeps groups applied in order
+    std::mutex lock;
+    std::mutex flush_lock;
+    std::condition_variable wake;
+    std::thread flusher;
+    bool stopping;
+    std::exception_ptr failure;
+
+    void flush_loop();
+    void rethrow_failure();
+
+public:
+    // Constructor/Destructor
+    pgroup(pool<ROOT_T>, persistent_ptr<CONT_T>, size_t max_ops = 1024,
+           std::chrono::milliseconds max_delay = std::chrono::milliseconds(10),
+           bool background = true);
+    ~pgroup();
+
+    pgroup(const pgroup&) = delete;
+    pgroup& operator=(const pgroup&) = delete;
+
+    // Staging
+    void stage(std::function<void(CONT_T&)>);
+
+    template <typename VAL_T>
+    void push_back(const VAL_T&);
+    template <typename VAL_T>
+    void push_front(const VAL_T&);
+    template <typename VAL_T>
+    void insert(const VAL_T&, int);
+
+    // Get/Set
+    size_t get_pending();
+    size_t get_max_ops() const;
+    std::chrono::milliseconds get_max_delay() const;
+
+    // Misc.
+    void sync();
+    template <typename F>
+    void read(F&&);
+};
+
+#include "pgroup.hpp"
+
+#endif
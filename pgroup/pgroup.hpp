@@ -0,0 +1,208 @@
+#include "pgroup.h"
+
+/* ========================================================================= */
+/* ******************************** pgroup ********************************* */
+/* ========================================================================= */
+
+/* ======================== CONSTRUCTORS/DESTRUCTOR ======================== */
+
+// Create a group-commit front end for the given container. Groups are flushed at
+// max_ops mutations or max_delay after their first one, whichever comes first.
+template <typename CONT_T, typename ROOT_T>
+pgroup<CONT_T, ROOT_T>::pgroup(pool<ROOT_T> pop_in, persistent_ptr<CONT_T> target_in,
+                               size_t max_ops_in, std::chrono::milliseconds max_delay_in,
+                               bool background) {
+    pop = pop_in;
+    target = target_in;
+    max_ops = max_ops_in > 0 ? max_ops_in : 1;
+    max_delay = max_delay_in;
+    stopping = false;
+
+    staged.reserve(max_ops);
+
+    if (background)
+        flusher = std::thread([this] { flush_loop(); });
+}
+
+// Flush whatever is still staged and stop the background flusher.
+template <typename CONT_T, typename ROOT_T>
+pgroup<CONT_T, ROOT_T>::~pgroup() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    if (flusher.joinable())
+        flusher.join();
+
+    // a destructor cannot report a failed group, so the last one is best-effort
+    try {
+        sync();
+    }
+    catch (...) {
+    }
+}
+
+/* ================================ STAGING ================================ */
+
+// Stage an arbitrary mutation of the container for the next group.
+template <typename CONT_T, typename ROOT_T>
+void pgroup<CONT_T, ROOT_T>::stage(std::function<void(CONT_T&)> fn) {
+    PSTATS_OP(PSTATS_OTHER, "pgroup::stage");
+
+    rethrow_failure();
+
+    bool full = false;
+    bool late = false;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        if (staged.empty())
+            oldest = std::chrono::steady_clock::now();
+
+        staged.push_back(std::move(fn));
+
+        full = staged.size() >= max_ops;
+        late = !flusher.joinable() && std::chrono::steady_clock::now() - oldest >= max_delay;
+    }
+
+    // the thread that fills a group pays for flushing it
+    if (full || late)
+        sync();
+}
+
+// Stage a push_back of the given value.
+template <typename CONT_T, typename ROOT_T>
+template <typename VAL_T>
+void pgroup<CONT_T, ROOT_T>::push_back(const VAL_T& val) {
+    stage([val](CONT_T& c) { c.push_back(val); });
+}
+
+// Stage a push_front of the given value.
+template <typename CONT_T, typename ROOT_T>
+template <typename VAL_T>
+void pgroup<CONT_T, ROOT_T>::push_front(const VAL_T& val) {
+    stage([val](CONT_T& c) { c.push_front(val); });
+}
+
+// Stage an insert of the given value at the given index. The index is checked when the
+// group is applied, against the container as it is at that point.
+template <typename CONT_T, typename ROOT_T>
+template <typename VAL_T>
+void pgroup<CONT_T, ROOT_T>::insert(const VAL_T& val, int idx) {
+    stage([val, idx](CONT_T& c) { c.insert(val, idx); });
+}
+
+/* =============================== GET/SET ================================= */
+
+// Get the number of mutations staged but not yet flushed.
+template <typename CONT_T, typename ROOT_T>
+size_t pgroup<CONT_T, ROOT_T>::get_pending() {
+    std::lock_guard<std::mutex> guard(lock);
+    return staged.size();
+}
+
+// Get the number of mutations that triggers a flush.
+template <typename CONT_T, typename ROOT_T>
+size_t pgroup<CONT_T, ROOT_T>::get_max_ops() const {
+    return max_ops;
+}
+
+// Get how long the oldest staged mutation may wait before its group is flushed.
+template <typename CONT_T, typename ROOT_T>
+std::chrono::milliseconds pgroup<CONT_T, ROOT_T>::get_max_delay() const {
+    return max_delay;
+}
+
+/* ================================ MISC. ================================== */
+
+// Apply every staged mutation to the container in a single transaction, returning once
+// it has committed.
+template <typename CONT_T, typename ROOT_T>
+void pgroup<CONT_T, ROOT_T>::sync() {
+    PSTATS_OP(PSTATS_OTHER, "pgroup::sync");
+
+    // hold the flush lock across the swap so groups commit in the order they were staged
+    std::lock_guard<std::mutex> order(flush_lock);
+    std::vector<std::function<void(CONT_T&)>> group;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        group.swap(staged);
+        staged.reserve(max_ops);
+    }
+
+    if (group.empty()) {
+        rethrow_failure();
+        return;
+    }
+
+    auto& cont = *target;
+
+    // every operation joins this transaction through ptx::run, so the group costs one commit
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_OTHER);
+
+        for (auto& fn : group)
+            fn(cont);
+    });
+}
+
+// Call the given function on the container, with no group being applied to it meanwhile.
+// It sees every group flushed so far and none of the mutations still staged.
+template <typename CONT_T, typename ROOT_T>
+template <typename F>
+void pgroup<CONT_T, ROOT_T>::read(F&& fn) {
+    PSTATS_OP(PSTATS_OTHER, "pgroup::read");
+
+    std::lock_guard<std::mutex> order(flush_lock);
+    fn((const CONT_T&)*target);
+}
+
+// Flush groups that have waited max_delay until told to stop.
+template <typename CONT_T, typename ROOT_T>
+void pgroup<CONT_T, ROOT_T>::flush_loop() {
+    std::unique_lock<std::mutex> guard(lock);
+
+    while (!stopping) {
+        if (staged.empty()) {
+            wake.wait_for(guard, max_delay);
+            continue;
+        }
+
+        auto due = oldest + max_delay;
+        if (std::chrono::steady_clock::now() < due) {
+            wake.wait_until(guard, due);
+            continue;
+        }
+
+        guard.unlock();
+
+        try {
+            sync();
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> fail_guard(lock);
+            failure = std::current_exception();
+        }
+
+        guard.lock();
+    }
+}
+
+// Rethrow the failure of an earlier background flush, if there was one.
+template <typename CONT_T, typename ROOT_T>
+void pgroup<CONT_T, ROOT_T>::rethrow_failure() {
+    std::exception_ptr err;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        err = failure;
+        failure = nullptr;
+    }
+
+    if (err)
+        std::rethrow_exception(err);
+}
@@ -1,20 +1,42 @@
 #ifndef _PHASHTABLE_H
 #define _PHASHTABLE_H
 
+#include <algorithm>
+#include <climits>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <libpmemobj++/make_persistent.hpp>
 #include <libpmemobj++/persistent_ptr.hpp>
 #include <libpmemobj++/transaction.hpp>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 #include "../pvector/pvector.h"
 #include "../plist/plist.h"
+#include "../preclaim/preclaim.h"
+#include "../pstats/pstats.h"
+#include "../pstorage/pstorage.h"
+#include "../ptx/ptx.h"
+#include "../ptraits/ptraits.h"
 
 using namespace pmem;
 using namespace pmem::obj;
 
+// the integrity checker and read-only views look at the buckets directly
+class pcheck;
+template <typename ROOT_T>
+class pview;
+
 static const unsigned int max_prime = 1301081;
 static const unsigned int default_capacity = 11;
 
+// fewest pairs each thread of build_from() gets, below which threads cost more than they save
+#define PHASHTABLE_BUILD_GRAIN (1 << 16)
+// nodes each thread of build_from() links per transaction
+#define PHASHTABLE_BUILD_STEP 4096
+
 // the pair struct for a Key-Value pair that is the basis for the hash table
 template <typename KEY_T, typename VAL_T>
 struct ppair {
@@ -22,36 +44,91 @@ struct ppair {
     p<VAL_T> val;
 };
 
+// a pair moves bytewise whenever both of its halves do
+template <typename KEY_T, typename VAL_T>
+struct is_prelocatable<ppair<KEY_T, VAL_T>>
+    : std::integral_constant<bool, is_prelocatable<KEY_T>::value && is_prelocatable<VAL_T>::value> {};
+
 template<typename KEY_T, typename VAL_T, typename ROOT_T>
 class phashtable {
+public:
+    // where this container lives, picked by ROOT_T (see pstorage)
+    typedef pstorage<ROOT_T> storage;
+    template <typename T>
+    using ptr_t = typename storage::template ptr<T>;
+    typedef typename storage::pool_type pool_t;
+
 private:
-    persistent_ptr<pvector<plist<ppair<KEY_T, VAL_T>, ROOT_T>, ROOT_T>> data;
+    ptr_t<pvector<plist<ppair<KEY_T, VAL_T>, ROOT_T>, ROOT_T>> data;
+    // number of pairs stored
     p<int> len;
-    pool<ROOT_T> pop;
-    persistent_ptr<std::hash<KEY_T>> hash_function;
+    // number of buckets in data
+    p<int> buckets;
+    pool_t pop;
+    ptr_t<std::hash<KEY_T>> hash_function;
+    // buckets not in use: those build_from() is filling, until they are swapped in, then the
+    // ones they replaced, until they are freed; only a crash leaves any between calls
+    ptr_t<pvector<plist<ppair<KEY_T, VAL_T>, ROOT_T>, ROOT_T>> staged;
 
     // helper functions
     void rehash();
+    template <typename IT>
+    int stage(IT, IT, int);
+    void drop_staged();
+    ptr_t<pvector<plist<ppair<KEY_T, VAL_T>, ROOT_T>, ROOT_T>> make_buckets(int);
     int hash(const KEY_T&) const;
-    unsigned long prime_below(unsigned long);
-    void set_primes(std::vector<bool>&);
+    int find(const plist<ppair<KEY_T, VAL_T>, ROOT_T>&, const KEY_T&) const;
+    static unsigned long prime_below(unsigned long);
+    static void set_primes(std::vector<bool>&);
+
+    friend class pstream;
+    friend class pcheck;
+    template <typename>
+    friend class pview;
 
 public:
     // Constructors
-    phashtable(pool<ROOT_T>);
+    phashtable(pool_t);
+    phashtable(pool_t, int);
 
     // Operator Overloads
 
     // Push/Pop
+    void insert(const KEY_T&, const VAL_T&);
+    VAL_T remove(const KEY_T&);
+    template <typename IT>
+    void build_from(IT, IT, int threads = 0);
+    template <typename IT>
+    void build_from(IT, IT, preclaim&, int threads = 0);
 
     // Get/Set
+    VAL_T get(const KEY_T&) const;
+    bool contains(const KEY_T&) const;
     int get_length() const;
+    int get_buckets() const;
+    bool is_empty() const;
+
+    // Layout
+    plist_layout layout() const;
+    plist_relayout relayout(int step = PLIST_RELAYOUT_STEP);
 
     // Misc.
-    void refresh_pool(pool<ROOT_T>);
+    template <typename F>
+    void batch(F&&);
+    template <typename F>
+    void for_each(F&&) const;
+    void refresh_pool(pool_t);
+    static void register_classes(pool_t);
+    void clear();
+    void clear(preclaim&);
     void destroy();
+    void destroy(preclaim&);
 };
 
+// a phashtable is just pool offsets, an int and a pool handle, so it can be moved bytewise
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+struct is_prelocatable<phashtable<KEY_T, VAL_T, ROOT_T>> : std::true_type {};
+
 #include "phashtable.hpp"
 
 #endif
\ No newline at end of file
@@ -6,20 +6,32 @@
 
 /* ============================ CONSTRUCTORS =============================== */
 
-// Construct a new, empty phashtable with default length.
+// Construct a new, empty phashtable with the default number of buckets.
 template <typename KEY_T, typename VAL_T, typename ROOT_T>
-phashtable<KEY_T, VAL_T, ROOT_T>::phashtable(pool<ROOT_T> pop_in) {
+phashtable<KEY_T, VAL_T, ROOT_T>::phashtable(pool_t pop_in)
+    : phashtable(pop_in, default_capacity) {
+}
+
+// Construct a new, empty phashtable with the given number of buckets, e.g. to avoid
+// rehashing when the number of pairs is known ahead of time.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+phashtable<KEY_T, VAL_T, ROOT_T>::phashtable(pool_t pop_in, int num_buckets) {
+    PSTATS_OP(PSTATS_PHASHTABLE, "construct");
     pop = pop_in;
 
-    flat_transaction::run(pop, [&] {
-        hash_function = make_persistent<std::hash<KEY_T>>();
-        len = default_capacity;
-        data = make_persistent<pvector<plist<ppair<KEY_T, VAL_T>, ROOT_T>, ROOT_T>>(pop, len);
+    if (num_buckets < 1)
+        throw std::out_of_range("A hashtable needs at least one bucket.");
 
-        // set all the lists to have the right pool reference too
-        for (int i = 0; i < len; i++) {
-            data[i].refresh_pool(pop);
-        }
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PHASHTABLE);
+        PSTATS_ALLOC(PSTATS_PHASHTABLE, sizeof(std::hash<KEY_T>));
+        PSTATS_ALLOC(PSTATS_PHASHTABLE, sizeof(pvector<plist<ppair<KEY_T, VAL_T>, ROOT_T>, ROOT_T>));
+
+        hash_function = storage::template make<std::hash<KEY_T>>();
+        staged = nullptr;
+        len = 0;
+        buckets = num_buckets;
+        data = make_buckets(buckets);
     });
 }
 
@@ -27,20 +39,529 @@ phashtable<KEY_T, VAL_T, ROOT_T>::phashtable(pool<ROOT_T> pop_in) {
 
 /* ============================== PUSH/POP ================================= */
 
+// Insert the given key with the given value, replacing the value if the key is already
+// present. Grows the table once there are more pairs than buckets.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void phashtable<KEY_T, VAL_T, ROOT_T>::insert(const KEY_T& key, const VAL_T& val) {
+    PSTATS_OP(PSTATS_PHASHTABLE, "insert");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PHASHTABLE);
+        PSTATS_SNAPSHOT(PSTATS_PHASHTABLE, sizeof(len));
+
+        auto& bucket = (*data)[hash(key)];
+        int idx = find(bucket, key);
+
+        // replace an existing pair rather than storing the key twice
+        if (idx >= 0)
+            bucket.remove(idx);
+        else
+            len++;
+
+        bucket.push_back(ppair<KEY_T, VAL_T>{key, val});
+
+        if (len > buckets)
+            rehash();
+    });
+}
+
+// Remove the pair with the given key, returning its value.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+VAL_T phashtable<KEY_T, VAL_T, ROOT_T>::remove(const KEY_T& key) {
+    PSTATS_OP(PSTATS_PHASHTABLE, "remove");
+
+    auto& bucket = (*data)[hash(key)];
+    int idx = find(bucket, key);
+
+    if (idx < 0)
+        throw std::out_of_range("Cannot remove a key that is not in the hashtable.");
+
+    VAL_T val;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PHASHTABLE);
+        PSTATS_SNAPSHOT(PSTATS_PHASHTABLE, sizeof(len));
+
+        val = bucket.remove(idx).val;
+        len--;
+    });
+
+    return val;
+}
+
+// Replace every pair with the pairs of key and value in [first, last), e.g. std::pairs or
+// the items of a std::map, where a key given more than once keeps its last value. The
+// buckets are sized once for the input, then the pairs are split by bucket across the
+// given number of threads (one per core by default), and each thread links the nodes of
+// its own range of buckets in transactions of about PHASHTABLE_BUILD_STEP nodes. The new
+// buckets are swapped in whole, in one small transaction that parks the old ones where the
+// new ones were, and the old ones are then freed in transactions of the same size. A crash
+// part way leaves either the old or the new pairs, and the next build_from() or destroy()
+// frees whatever buckets are left parked. Must not be called inside a transaction.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+template <typename IT>
+void phashtable<KEY_T, VAL_T, ROOT_T>::build_from(IT first, IT last, int threads) {
+    PSTATS_OP(PSTATS_PHASHTABLE, "build_from");
+
+    int count = stage(first, last, threads);
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PHASHTABLE);
+        PSTATS_SNAPSHOT(PSTATS_PHASHTABLE, sizeof(data) + sizeof(staged) + sizeof(len) + sizeof(buckets));
+
+        auto old_data = data;
+
+        data = staged;
+        buckets = staged->get_length();
+        staged = old_data;
+        len = count;
+    });
+
+    drop_staged();
+}
+
+// Replace every pair as above, deferring the old buckets, nodes and all, to the given
+// reclamation list (see preclaim) rather than freeing them in the swap. A table on the
+// heap has no log to outgrow, so its old buckets are simply freed.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+template <typename IT>
+void phashtable<KEY_T, VAL_T, ROOT_T>::build_from(IT first, IT last, preclaim& trash, int threads) {
+    PSTATS_OP(PSTATS_PHASHTABLE, "build_from");
+
+    if constexpr (std::is_same<ROOT_T, pdram>::value) {
+        build_from(first, last, threads);
+    }
+    else {
+        int count = stage(first, last, threads);
+
+        ptx::run(pop, [&] {
+            PSTATS_TX(PSTATS_PHASHTABLE);
+            PSTATS_SNAPSHOT(PSTATS_PHASHTABLE, sizeof(data) + sizeof(staged) + sizeof(len) + sizeof(buckets));
+
+            auto old_data = data;
+
+            data = staged;
+            buckets = staged->get_length();
+            staged = nullptr;
+            len = count;
+
+            old_data->destroy(trash);
+        });
+    }
+}
+
 /* =============================== GET/SET ================================= */
 
+// Get the value stored for the given key.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+VAL_T phashtable<KEY_T, VAL_T, ROOT_T>::get(const KEY_T& key) const {
+    PSTATS_OP(PSTATS_PHASHTABLE, "get");
+
+    auto& bucket = (*data)[hash(key)];
+    int idx = find(bucket, key);
+
+    if (idx < 0)
+        throw std::out_of_range("Cannot get a key that is not in the hashtable.");
+
+    return bucket[idx].val;
+}
+
+// Get whether the given key is in the hashtable.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+bool phashtable<KEY_T, VAL_T, ROOT_T>::contains(const KEY_T& key) const {
+    PSTATS_OP(PSTATS_PHASHTABLE, "contains");
+
+    return find((*data)[hash(key)], key) >= 0;
+}
+
+// Get the number of pairs in the hashtable.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+int phashtable<KEY_T, VAL_T, ROOT_T>::get_length() const {
+    return len;
+}
+
+// Get the number of buckets in the hashtable.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+int phashtable<KEY_T, VAL_T, ROOT_T>::get_buckets() const {
+    return buckets;
+}
+
+// Get whether or not the hashtable is empty.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+bool phashtable<KEY_T, VAL_T, ROOT_T>::is_empty() const {
+    return len == 0;
+}
+
+/* ================================ LAYOUT ================================= */
+
+// Get how scattered the pairs are across the pool, in the order for_each() walks them.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+plist_layout phashtable<KEY_T, VAL_T, ROOT_T>::layout() const {
+    PSTATS_OP(PSTATS_PHASHTABLE, "layout");
+
+    plist_layout res;
+
+    for (int i = 0; i < buckets; i++)
+        (*data)[i].measure(res);
+
+    return res;
+}
+
+// Reallocate the nodes of every bucket chain in bucket order, so a walk over the table
+// moves forward through the pool. Whole buckets are moved in transactions of about step
+// nodes each, so the table is whole between them. Returns the layout before and after.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+plist_relayout phashtable<KEY_T, VAL_T, ROOT_T>::relayout(int step) {
+    PSTATS_OP(PSTATS_PHASHTABLE, "relayout");
+
+    if (step < 1)
+        throw std::out_of_range("Cannot relayout fewer than one node at a time.");
+
+    plist_relayout res;
+    res.before = layout();
+
+    int i = 0;
+
+    while (i < buckets) {
+        ptx::run(pop, [&] {
+            PSTATS_TX(PSTATS_PHASHTABLE);
+            int moved = 0;
+
+            while (i < buckets && moved < step) {
+                auto& bucket = (*data)[i];
+
+                if (bucket.len > 0) {
+                    bucket.move_nodes(nullptr, bucket.len);
+                    moved += bucket.len;
+                }
+
+                i++;
+            }
+        });
+    }
+
+    res.after = layout();
+
+    return res;
+}
+
 /* ================================ MISC. ================================== */
 
-// Update the reference to the current pmem pool object.
+// Update the reference to the current pmem pool object, in this table and in every bucket.
 template <typename KEY_T, typename VAL_T, typename ROOT_T>
-void phashtable<KEY_T, VAL_T, ROOT_T>::refresh_pool(pool<ROOT_T> new_pop) {
+void phashtable<KEY_T, VAL_T, ROOT_T>::refresh_pool(pool_t new_pop) {
+    PSTATS_OP(PSTATS_PHASHTABLE, "refresh_pool");
     pop = new_pop;
-} 
 
-// Hash the given index, getting the index of the vector.
+    data->refresh_pool(new_pop);
+
+    for (int i = 0; i < buckets; i++)
+        (*data)[i].refresh_pool(new_pop);
+
+    // and the leftovers of a build cut short, so the next build can free them
+    if (staged != nullptr) {
+        staged->refresh_pool(new_pop);
+
+        for (int i = 0; i < staged->get_length(); i++)
+            (*staged)[i].refresh_pool(new_pop);
+    }
+}
+
+// Give the bucket nodes of every phashtable of this type an allocation class of their
+// exact size in the given pool (see palloc). Must be called each time the pool is created
+// or opened.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void phashtable<KEY_T, VAL_T, ROOT_T>::register_classes(pool_t new_pop) {
+    plist<ppair<KEY_T, VAL_T>, ROOT_T>::register_classes(new_pop);
+}
+
+// Hash the given key, getting the index of its bucket.
 template <typename KEY_T, typename VAL_T, typename ROOT_T>
 int phashtable<KEY_T, VAL_T, ROOT_T>::hash(const KEY_T& key) const {
-    return hash_function(key) % len;
+    return (*hash_function)(key) % (size_t)buckets;
+}
+
+// Get the index of the pair with the given key in the given bucket, or -1 if it is not there.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+int phashtable<KEY_T, VAL_T, ROOT_T>::find(const plist<ppair<KEY_T, VAL_T>, ROOT_T>& bucket,
+                                           const KEY_T& key) const {
+    int found = -1;
+    int i = 0;
+
+    bucket.for_each([&](const ppair<KEY_T, VAL_T>& pair) {
+        if (found < 0 && pair.key.get_ro() == key)
+            found = i;
+
+        i++;
+    });
+
+    return found;
+}
+
+// Move every pair into a table with about twice as many buckets. Must run inside a transaction.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void phashtable<KEY_T, VAL_T, ROOT_T>::rehash() {
+    PSTATS_OP(PSTATS_PHASHTABLE, "rehash");
+
+    // we cannot grow past the largest prime we know of
+    if (buckets >= (int)max_prime)
+        return;
+
+    unsigned long target = 2UL * buckets + 1;
+    int new_buckets = prime_below(target < max_prime ? target : max_prime);
+
+    PSTATS_SNAPSHOT(PSTATS_PHASHTABLE, sizeof(data) + sizeof(buckets));
+    PSTATS_ALLOC(PSTATS_PHASHTABLE, sizeof(pvector<plist<ppair<KEY_T, VAL_T>, ROOT_T>, ROOT_T>));
+
+    auto old_data = data;
+    int old_buckets = buckets;
+
+    data = make_buckets(new_buckets);
+    buckets = new_buckets;
+
+    // hash everything again against the new bucket count, emptying the old buckets as we go
+    for (int i = 0; i < old_buckets; i++) {
+        auto& bucket = (*old_data)[i];
+
+        bucket.for_each([&](const ppair<KEY_T, VAL_T>& pair) {
+            (*data)[hash(pair.key.get_ro())].push_back(pair);
+        });
+
+        bucket.clear();
+    }
+
+    old_data->destroy();
+}
+
+// Fill a new set of buckets, sized for the pairs in [first, last), with those pairs on
+// the given number of threads (one per core if 0), and get the number of distinct keys.
+// The buckets hang off staged until they are swapped in.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+template <typename IT>
+int phashtable<KEY_T, VAL_T, ROOT_T>::stage(IT first, IT last, int threads) {
+    // a pair on its way to a bucket, while the input is split up in DRAM
+    struct staged_pair {
+        int bucket;
+        KEY_T key;
+        VAL_T val;
+    };
+
+    if (ptx::in_tx())
+        throw std::runtime_error("Cannot build a hashtable inside a transaction.");
+
+    long n = std::distance(first, last);
+
+    if (n > INT_MAX)
+        throw std::out_of_range("Cannot build a hashtable of more pairs than it can count.");
+
+    // as many buckets as rehash() would have grown to
+    unsigned long target = std::min(2UL * n + 1, (unsigned long)max_prime);
+    int new_buckets = prime_below(std::max(target, (unsigned long)default_capacity));
+
+    int cores = threads > 0 ? threads : (int)std::thread::hardware_concurrency();
+    int parts = 1;
+
+    while (parts < cores && parts < new_buckets && n / (parts + 1) >= PHASHTABLE_BUILD_GRAIN)
+        parts++;
+
+    drop_staged();
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PHASHTABLE);
+        PSTATS_SNAPSHOT(PSTATS_PHASHTABLE, sizeof(staged));
+        PSTATS_ALLOC(PSTATS_PHASHTABLE, sizeof(pvector<plist<ppair<KEY_T, VAL_T>, ROOT_T>, ROOT_T>));
+
+        staged = make_buckets(new_buckets);
+    });
+
+    // run fn(i) for every i below count on threads of its own, rethrowing the first failure
+    auto parallel = [](int count, auto&& fn) {
+        if (count == 1) {
+            fn(0);
+            return;
+        }
+
+        std::vector<std::thread> workers;
+        std::vector<std::exception_ptr> failures(count);
+
+        for (int i = 0; i < count; i++) {
+            workers.emplace_back([&, i] {
+                try {
+                    fn(i);
+                }
+                catch (...) {
+                    failures[i] = std::current_exception();
+                }
+            });
+        }
+
+        for (auto& t : workers)
+            t.join();
+
+        for (auto& f : failures) {
+            if (f)
+                std::rethrow_exception(f);
+        }
+    };
+
+    // each thread takes a slice of the input and sorts it by the range of buckets, or
+    // part, that each pair lands in; part p holds the buckets from first_bucket(p) on
+    auto first_bucket = [&](int p) { return (int)(((long)new_buckets * p + parts - 1) / parts); };
+
+    std::vector<IT> slices(parts + 1, first);
+    for (int t = 0; t < parts; t++)
+        slices[t + 1] = std::next(slices[t], n * (t + 1) / parts - n * t / parts);
+
+    std::vector<std::vector<std::vector<staged_pair>>> split(parts);
+
+    parallel(parts, [&](int t) {
+        split[t].resize(parts);
+
+        for (auto& part : split[t])
+            part.reserve(n / parts / parts + 16);
+
+        for (IT it = slices[t]; it != slices[t + 1]; ++it) {
+            const auto& kv = *it;
+            int b = (*hash_function)(kv.first) % (size_t)new_buckets;
+
+            split[t][(long)b * parts / new_buckets].push_back(staged_pair{b, kv.first, kv.second});
+        }
+    });
+
+    // then each thread links the nodes of one part, taking the slices in order so the last
+    // pair given for a key is the last one it sees
+    std::vector<int> counts(parts, 0);
+
+    parallel(parts, [&](int p) {
+        int lo = first_bucket(p);
+        int hi = first_bucket(p + 1);
+
+        // order the part's pairs by bucket, each bucket's from start[b - lo] on
+        std::vector<int> start(hi - lo + 1, 0);
+
+        for (int t = 0; t < parts; t++) {
+            for (const auto& sp : split[t][p])
+                start[sp.bucket - lo + 1]++;
+        }
+
+        for (int b = lo; b < hi; b++)
+            start[b - lo + 1] += start[b - lo];
+
+        std::vector<const staged_pair*> order(start[hi - lo]);
+        std::vector<int> at(start.begin(), start.end() - 1);
+
+        for (int t = 0; t < parts; t++) {
+            for (const auto& sp : split[t][p])
+                order[at[sp.bucket - lo]++] = &sp;
+        }
+
+        std::vector<const staged_pair*> kept;
+        int b = lo;
+
+        while (b < hi) {
+            ptx::run(pop, [&] {
+                PSTATS_TX(PSTATS_PHASHTABLE);
+
+                int end = b;
+                for (int nodes = 0; end < hi && nodes < PHASHTABLE_BUILD_STEP; end++)
+                    nodes += start[end - lo + 1] - start[end - lo];
+
+                PSTATS_SNAPSHOT(PSTATS_PHASHTABLE, sizeof(plist<ppair<KEY_T, VAL_T>, ROOT_T>) * (end - b));
+                storage::snapshot(&(*staged)[b], end - b);
+
+                for (; b < end; b++) {
+                    auto& bucket = (*staged)[b];
+
+                    // keep the last pair of each key, walking the bucket back to front
+                    kept.clear();
+
+                    for (int i = start[b - lo + 1] - 1; i >= start[b - lo]; i--) {
+                        bool seen = false;
+
+                        for (auto k : kept)
+                            seen = seen || k->key == order[i]->key;
+
+                        if (!seen)
+                            kept.push_back(order[i]);
+                    }
+
+                    // and link them front to back, in the order they were given
+                    ptr_t<pnode<ppair<KEY_T, VAL_T>, ROOT_T>> prev = nullptr;
+
+                    for (auto k = kept.rbegin(); k != kept.rend(); ++k) {
+                        PSTATS_ALLOC(PSTATS_PHASHTABLE, sizeof(pnode<ppair<KEY_T, VAL_T>, ROOT_T>));
+                        auto node = storage::template make<pnode<ppair<KEY_T, VAL_T>, ROOT_T>>(
+                            pop, ppair<KEY_T, VAL_T>{(*k)->key, (*k)->val});
+
+                        if (prev == nullptr)
+                            bucket.head = node;
+                        else
+                            prev->set_next(node);
+
+                        prev = node;
+                    }
+
+                    bucket.tail = prev;
+                    bucket.len = (int)kept.size();
+                    counts[p] += (int)kept.size();
+                }
+            });
+        }
+    });
+
+    int total = 0;
+    for (int c : counts)
+        total += c;
+
+    return total;
+}
+
+// Free the buckets parked in staged, if there are any, emptying them in transactions of
+// about PHASHTABLE_BUILD_STEP nodes. Buckets already emptied before a crash are skipped.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void phashtable<KEY_T, VAL_T, ROOT_T>::drop_staged() {
+    if (staged == nullptr)
+        return;
+
+    int n = staged->get_length();
+
+    for (int i = 0; i < n;) {
+        ptx::run(pop, [&] {
+            PSTATS_TX(PSTATS_PHASHTABLE);
+
+            for (int freed = 0; i < n && freed < PHASHTABLE_BUILD_STEP; i++) {
+                auto& bucket = (*staged)[i];
+
+                if (bucket.get_length() > 0) {
+                    freed += bucket.get_length();
+                    bucket.clear();
+                }
+            }
+        });
+    }
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PHASHTABLE);
+        PSTATS_SNAPSHOT(PSTATS_PHASHTABLE, sizeof(staged));
+
+        staged->destroy();
+        staged = nullptr;
+    });
+}
+
+// Allocate a vector of the given number of empty buckets, inside the open transaction.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+typename phashtable<KEY_T, VAL_T, ROOT_T>::template ptr_t<pvector<plist<ppair<KEY_T, VAL_T>, ROOT_T>, ROOT_T>>
+phashtable<KEY_T, VAL_T, ROOT_T>::make_buckets(int n) {
+    auto v = storage::template make<pvector<plist<ppair<KEY_T, VAL_T>, ROOT_T>, ROOT_T>>(pop, n);
+
+    // fill the vector with empty lists that have the right pool reference too
+    for (int i = 0; i < n; i++) {
+        v->push_back(plist<ppair<KEY_T, VAL_T>, ROOT_T>());
+        (*v)[i].refresh_pool(pop);
+    }
+
+    return v;
 }
 
 // Get the largest prime less than or equal to the given number.
@@ -48,7 +569,7 @@ template <typename KEY_T, typename VAL_T, typename ROOT_T>
 unsigned long phashtable<KEY_T, VAL_T, ROOT_T>::prime_below(unsigned long n) {
     // error out on very small or very large values
     if (n > max_prime || n <= 1) {
-        throw std::exception("Given value is too large or too small.");
+        throw std::out_of_range("Given value is too large or too small.");
     }
 
     // shortcut to this if the given value is known to be prime
@@ -76,7 +597,7 @@ void phashtable<KEY_T, VAL_T, ROOT_T>::set_primes(std::vector<bool>& v) {
     v[0] = false;
     v[1] = false;
 
-    int n = v.capacity();
+    int n = v.size();
 
     for (int i = 2; i < n; i++) {
         v[i] = true;
@@ -84,9 +605,124 @@ void phashtable<KEY_T, VAL_T, ROOT_T>::set_primes(std::vector<bool>& v) {
 
     for (int i = 2; i * i < n; i++) {
         if (v[i]) {
-            for (int j = i + i; j < n; j++) {
+            for (int j = i + i; j < n; j += i) {
                 v[j] = false;
             }
         }
     }
-}
\ No newline at end of file
+}
+
+// Run the given function as one transaction, so its inserts and removes commit together.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+template <typename F>
+void phashtable<KEY_T, VAL_T, ROOT_T>::batch(F&& fn) {
+    PSTATS_OP(PSTATS_PHASHTABLE, "batch");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PHASHTABLE);
+        fn();
+    });
+}
+
+// Call the given function with the key and value of every pair, bucket by bucket.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+template <typename F>
+void phashtable<KEY_T, VAL_T, ROOT_T>::for_each(F&& fn) const {
+    for (int i = 0; i < buckets; i++) {
+        (*data)[i].for_each([&](const ppair<KEY_T, VAL_T>& pair) {
+            fn(pair.key.get_ro(), pair.val.get_ro());
+        });
+    }
+}
+
+// Remove every pair, keeping the buckets allocated.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void phashtable<KEY_T, VAL_T, ROOT_T>::clear() {
+    PSTATS_OP(PSTATS_PHASHTABLE, "clear");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PHASHTABLE);
+        PSTATS_SNAPSHOT(PSTATS_PHASHTABLE, sizeof(len));
+
+        for (int i = 0; i < buckets; i++)
+            (*data)[i].clear();
+
+        len = 0;
+    });
+}
+
+// Remove every pair in one small transaction, swapping in the default number of fresh
+// empty buckets and deferring the old ones, nodes and all, to the given reclamation list
+// (see preclaim). The table grows back as it is refilled. A table on the heap has no log
+// to outgrow, so it is simply cleared.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void phashtable<KEY_T, VAL_T, ROOT_T>::clear(preclaim& trash) {
+    PSTATS_OP(PSTATS_PHASHTABLE, "clear");
+
+    if constexpr (std::is_same<ROOT_T, pdram>::value) {
+        clear();
+    }
+    else {
+        ptx::run(pop, [&] {
+            PSTATS_TX(PSTATS_PHASHTABLE);
+            PSTATS_SNAPSHOT(PSTATS_PHASHTABLE, sizeof(data) + sizeof(len) + sizeof(buckets));
+            PSTATS_ALLOC(PSTATS_PHASHTABLE, sizeof(pvector<plist<ppair<KEY_T, VAL_T>, ROOT_T>, ROOT_T>));
+
+            // a full set of buckets would cost O(buckets) here, so start over from the fewest
+            auto old_data = data;
+            data = make_buckets(default_capacity);
+            buckets = default_capacity;
+            old_data->destroy(trash);
+
+            len = 0;
+        });
+    }
+}
+
+// Completely destroy this object and its allocated memory.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void phashtable<KEY_T, VAL_T, ROOT_T>::destroy() {
+    PSTATS_OP(PSTATS_PHASHTABLE, "destroy");
+
+    clear();
+    drop_staged();
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PHASHTABLE);
+        PSTATS_FREE(PSTATS_PHASHTABLE, sizeof(std::hash<KEY_T>));
+        PSTATS_FREE(PSTATS_PHASHTABLE, sizeof(phashtable<KEY_T, VAL_T, ROOT_T>));
+
+        data->destroy();
+        storage::template destroy<std::hash<KEY_T>>(hash_function);
+
+        storage::template destroy<phashtable<KEY_T, VAL_T, ROOT_T>>(this);
+    });
+}
+
+// Destroy this object in one small transaction, deferring the buckets and every node in
+// them to the given reclamation list. A table on the heap is simply destroyed.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void phashtable<KEY_T, VAL_T, ROOT_T>::destroy(preclaim& trash) {
+    PSTATS_OP(PSTATS_PHASHTABLE, "destroy");
+
+    if constexpr (std::is_same<ROOT_T, pdram>::value) {
+        destroy();
+    }
+    else {
+        ptx::run(pop, [&] {
+            PSTATS_TX(PSTATS_PHASHTABLE);
+            PSTATS_FREE(PSTATS_PHASHTABLE, sizeof(std::hash<KEY_T>));
+            PSTATS_FREE(PSTATS_PHASHTABLE, sizeof(phashtable<KEY_T, VAL_T, ROOT_T>));
+
+            data->destroy(trash);
+
+            // along with the leftovers of a build cut short, if any
+            if (staged != nullptr)
+                staged->destroy(trash);
+
+            storage::template destroy<std::hash<KEY_T>>(hash_function);
+
+            storage::template destroy<phashtable<KEY_T, VAL_T, ROOT_T>>(this);
+        });
+    }
+}
@@ -4,12 +4,53 @@
 #include <libpmemobj++/make_persistent.hpp>
 #include <libpmemobj++/persistent_ptr.hpp>
 #include <libpmemobj++/transaction.hpp>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <new>
 #include <stdexcept>
+#include <utility>
+#include "../pdump/pdump.h"
+#include "../preclaim/preclaim.h"
+#include "../pstats/pstats.h"
+#include "../pstorage/pstorage.h"
+#include "../ptx/ptx.h"
+#include "../ptraits/ptraits.h"
 
 using namespace pmem;
 using namespace pmem::obj;
 
+// the integrity checker and read-only views walk the nodes directly
+class pcheck;
+template <typename ROOT_T>
+class pview;
+
+// a link counts as local when it points forward by at most one page
+#define PLIST_LOCAL_BYTES 4096
+// nodes moved per transaction by relayout()
+#define PLIST_RELAYOUT_STEP 1024
+
+// How scattered a chain of nodes is across the pool, counted link by link in the order
+// the nodes are walked.
+struct plist_layout {
+    int nodes;
+    int links;
+    // links that are not local
+    int jumps;
+    // pool offset of the last node counted
+    uint64_t last;
+
+    plist_layout();
+    void add(uint64_t);
+    double fragmentation() const;
+};
+
+// The layout of a container before and after a relayout().
+struct plist_relayout {
+    plist_layout before;
+    plist_layout after;
+};
+
 // forward declaration of classes
 template <typename VAL_T, typename ROOT_T>
 class pnode;
@@ -23,36 +64,64 @@ std::ostream& operator<<(std::ostream&, const plist<VAL_T, ROOT_T>&);
 
 template <typename VAL_T, typename ROOT_T>
 class pnode {
+public:
+    // where this container lives, picked by ROOT_T (see pstorage)
+    typedef pstorage<ROOT_T> storage;
+    template <typename T>
+    using ptr_t = typename storage::template ptr<T>;
+    typedef typename storage::pool_type pool_t;
+
 private:
     p<VAL_T> val;
-    persistent_ptr<pnode<VAL_T, ROOT_T>> next;
-    pool<ROOT_T> pop;
+    ptr_t<pnode<VAL_T, ROOT_T>> next;
+    pool_t pop;
 
 public:
-    // Constructor
-    pnode(const VAL_T&, pool<ROOT_T>);
+    // Constructors
+    pnode(const VAL_T&, pool_t);
+    template <typename... Args>
+    pnode(pool_t, Args&&...);
 
     // Getters/Setters
     void set_value(const VAL_T&);
     VAL_T get_value() const;
-    void set_next(persistent_ptr<pnode<VAL_T, ROOT_T>>);
-    persistent_ptr<pnode<VAL_T, ROOT_T>> get_next() const;
+    void set_next(ptr_t<pnode<VAL_T, ROOT_T>>);
+    ptr_t<pnode<VAL_T, ROOT_T>> get_next() const;
+    static uint32_t get_link_offset();
 
     // Misc.
-    void refresh_pool(pool<ROOT_T>);
+    void refresh_pool(pool_t);
 };
 
 template <typename VAL_T, typename ROOT_T>
 class plist {
+public:
+    // where this container lives, picked by ROOT_T (see pstorage)
+    typedef pstorage<ROOT_T> storage;
+    template <typename T>
+    using ptr_t = typename storage::template ptr<T>;
+    typedef typename storage::pool_type pool_t;
+
 private:
-    persistent_ptr<pnode<VAL_T, ROOT_T>> head;
-    persistent_ptr<pnode<VAL_T, ROOT_T>> tail;
+    ptr_t<pnode<VAL_T, ROOT_T>> head;
+    ptr_t<pnode<VAL_T, ROOT_T>> tail;
     p<int> len;
-    pool<ROOT_T> pop;
+    pool_t pop;
+
+    void measure(plist_layout&) const;
+    ptr_t<pnode<VAL_T, ROOT_T>> move_nodes(ptr_t<pnode<VAL_T, ROOT_T>>, int);
+
+    friend class pcheck;
+    template <typename>
+    friend class pview;
+    friend struct preclaim_chain<plist<VAL_T, ROOT_T>>;
+    // hashtables lay out their bucket chains with the same helpers
+    template <typename, typename, typename>
+    friend class phashtable;
 
 public:
     // Constructor
-    explicit plist(pool<ROOT_T>);
+    explicit plist(pool_t);
     // required for phashtable implementation -- DO NOT CALL DIRECTLY
     plist() = default;
 
@@ -62,22 +131,54 @@ public:
 
     // Push/Pop
     void push_back(const VAL_T&);
+    void push_back(VAL_T&&);
+    template <typename... Args>
+    void emplace_back(Args&&...);
     VAL_T pop_back();
 
     void push_front(const VAL_T&);
+    void push_front(VAL_T&&);
+    template <typename... Args>
+    void emplace_front(Args&&...);
     VAL_T pop_front();
 
     void insert(const VAL_T&, int);
+    void insert(VAL_T&&, int);
+    template <typename... Args>
+    void emplace(int, Args&&...);
     VAL_T remove(int);
 
     // Get/Set
     int get_length() const;
     bool is_empty() const;
-    
+
+    // Layout
+    plist_layout layout() const;
+    plist_relayout relayout(int step = PLIST_RELAYOUT_STEP);
+
     // Misc.
+    template <typename F>
+    void batch(F&&);
+    template <typename F>
+    void for_each(F&&) const;
+    void dump(pdump_sink&) const;
     void clear();
-    void refresh_pool(pool<ROOT_T>);
+    void clear(preclaim&);
+    void refresh_pool(pool_t);
+    static void register_classes(pool_t);
     void destroy();
+    void destroy(preclaim&);
+};
+
+// a plist is just pool offsets, an int and a pool handle, so it can be moved bytewise
+template <typename VAL_T, typename ROOT_T>
+struct is_prelocatable<plist<VAL_T, ROOT_T>> : std::true_type {};
+
+// a plist roots a chain of nodes, so an array of them can be deferred with their nodes
+template <typename VAL_T, typename ROOT_T>
+struct preclaim_chain<plist<VAL_T, ROOT_T>> : std::true_type {
+    static uint32_t head_offset();
+    static uint32_t link_offset();
 };
 
 #include "plist.hpp"
@@ -1,5 +1,38 @@
 #include "plist.h"
 
+/* ========================================================================= */
+/* ***************************** plist_layout ****************************** */
+/* ========================================================================= */
+
+// Start an empty count.
+inline plist_layout::plist_layout() {
+    nodes = 0;
+    links = 0;
+    jumps = 0;
+    last = 0;
+}
+
+// Count the node at the given pool offset, which follows the last one counted.
+inline void plist_layout::add(uint64_t off) {
+    if (nodes > 0) {
+        links++;
+
+        if (off <= last || off - last > PLIST_LOCAL_BYTES)
+            jumps++;
+    }
+
+    last = off;
+    nodes++;
+}
+
+// Get the share of links that are not local.
+inline double plist_layout::fragmentation() const {
+    if (links == 0)
+        return 0;
+
+    return (double)jumps / links;
+}
+
 /* ========================================================================= */
 /* ******************************** pnode ********************************** */
 /* ========================================================================= */
@@ -8,24 +41,47 @@
 
 // Construct a new pnode with the given VAL_T value within the given pmem pool.
 template <typename VAL_T, typename ROOT_T>
-pnode<VAL_T, ROOT_T>::pnode(const VAL_T& val_in, pool<ROOT_T> pop_in) {
+pnode<VAL_T, ROOT_T>::pnode(const VAL_T& val_in, pool_t pop_in) {
     // set this pnode's parent pool for later transactions to use
     pop = pop_in;
 
     // and safely edit the pmem of this pnode to have given values
-    flat_transaction::run(pop, [&] {
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PLIST);
         val = val_in;
         next = nullptr;
     });
 }
 
+// Construct a new pnode within the given pmem pool whose value is built in place from the
+// given arguments.
+template <typename VAL_T, typename ROOT_T>
+template <typename... Args>
+pnode<VAL_T, ROOT_T>::pnode(pool_t pop_in, Args&&... args) {
+    // set this pnode's parent pool for later transactions to use
+    pop = pop_in;
+
+    // build the value straight into this pnode's pmem rather than copying one in
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PLIST);
+
+        VAL_T* slot = &val.get_rw();
+        slot->~VAL_T();
+        new (slot) VAL_T(std::forward<Args>(args)...);
+
+        next = nullptr;
+    });
+}
+
 /* ========================== GETTERS/SETTERS ============================== */
 
 // Set the value of this pnode to the new VAL_T value.
 template <typename VAL_T, typename ROOT_T>
 void pnode<VAL_T, ROOT_T>::set_value(const VAL_T& new_val) {
     // editing pmem, so use a transaction
-    flat_transaction::run(pop, [&] { 
+    ptx::run(pop, [&] { 
+        PSTATS_TX(PSTATS_PLIST);
+        PSTATS_SNAPSHOT(PSTATS_PLIST, sizeof(val));
         val = new_val;
     });
 }
@@ -38,25 +94,34 @@ VAL_T pnode<VAL_T, ROOT_T>::get_value() const {
 
 // Set the pointer to the next item in the plist to the given pointer.
 template <typename VAL_T, typename ROOT_T>
-void pnode<VAL_T, ROOT_T>::set_next(persistent_ptr<pnode<VAL_T, ROOT_T>> new_next) {
+void pnode<VAL_T, ROOT_T>::set_next(ptr_t<pnode<VAL_T, ROOT_T>> new_next) {
     // editing pmem, so use a transaction
-    flat_transaction::run(pop, [&] { 
+    ptx::run(pop, [&] { 
+        PSTATS_TX(PSTATS_PLIST);
+        PSTATS_SNAPSHOT(PSTATS_PLIST, sizeof(next));
         next = new_next;
     });
 }
 
 // Get the current pointer to the next item in the plist.
 template <typename VAL_T, typename ROOT_T>
-persistent_ptr<pnode<VAL_T, ROOT_T>> pnode<VAL_T, ROOT_T>::get_next() const {
+typename pnode<VAL_T, ROOT_T>::template ptr_t<pnode<VAL_T, ROOT_T>> pnode<VAL_T, ROOT_T>::get_next() const {
     return next;
 }
 
+// Get the offset of the pointer to the next node within a node, for walking a detached
+// chain without its type (see preclaim).
+template <typename VAL_T, typename ROOT_T>
+uint32_t pnode<VAL_T, ROOT_T>::get_link_offset() {
+    return offsetof(pnode, next);
+}
+
 /* ================================ MISC. ================================== */
 
 // Refresh the current pool object that the pnode stores. Must be called when loading
 // an existing pool file from disk.
 template <typename VAL_T, typename ROOT_T>
-void pnode<VAL_T, ROOT_T>::refresh_pool(pool<ROOT_T> new_pop) {
+void pnode<VAL_T, ROOT_T>::refresh_pool(pool_t new_pop) {
     pop = new_pop;
 }
 
@@ -68,12 +133,15 @@ void pnode<VAL_T, ROOT_T>::refresh_pool(pool<ROOT_T> new_pop) {
 
 // Construct a new plist within the given pmem pool.
 template <typename VAL_T, typename ROOT_T>
-plist<VAL_T, ROOT_T>::plist(pool<ROOT_T> pop_in) {
+plist<VAL_T, ROOT_T>::plist(pool_t pop_in) {
+    PSTATS_OP(PSTATS_PLIST, "construct");
+
     // set this plist's parent pool for later use
     pop = pop_in;
 
     // and edit the newly acquired pmem to default values
-    flat_transaction::run(pop, [&] {
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PLIST);
         head = nullptr;
         tail = nullptr;
         len = 0;
@@ -85,6 +153,8 @@ plist<VAL_T, ROOT_T>::plist(pool<ROOT_T> pop_in) {
 // Overload the [] operator to get the item at the given index.
 template <typename VAL_T, typename ROOT_T>
 VAL_T plist<VAL_T, ROOT_T>::operator[](int idx) const {
+    PSTATS_OP(PSTATS_PLIST, "operator[]");
+
     if (idx >= len)
         throw std::out_of_range("Given index was greater than the size of the plist.");
 
@@ -101,27 +171,28 @@ VAL_T plist<VAL_T, ROOT_T>::operator[](int idx) const {
     return current->get_value();
 }
 
-// Print the items in the plist to the given output stream, separated by commas.
+// Print the items in the plist to the given output stream, separated by commas. Numbers
+// are formatted in bulk (see pdump) unless the stream has settings that only its own
+// operator<< applies.
 template <typename VAL_T, typename ROOT_T>
 std::ostream& operator<<(std::ostream& os, const plist<VAL_T, ROOT_T>& l) {
-    os << "[";
-
-    auto current = l.head;
-    int i = 0;
-
-    // step through the whole plist except the last element and print value plus comma
-    while (i < l.len - 1 && current != nullptr) {
-        os << current->get_value() << ", ";
+    PSTATS_OP(PSTATS_PLIST, "operator<<");
 
-        current = current->get_next();
-        i++;
+    if (std::is_arithmetic<VAL_T>::value && pdump_sink::reproduces(os)) {
+        pdump_sink sink(os);
+        l.dump(sink);
+        return os;
     }
 
-    // do not print a comma after the last item
-    if (l.len > 0) {
-        os << current->get_value();
-    }
+    bool first = true;
 
+    os << "[";
+    l.for_each([&](const VAL_T& val) {
+        if (!first)
+            os << ", ";
+        os << val;
+        first = false;
+    });
     os << "]";
 
     return os;
@@ -132,10 +203,33 @@ std::ostream& operator<<(std::ostream& os, const plist<VAL_T, ROOT_T>& l) {
 // Add the given value to the end of the plist.
 template <typename VAL_T, typename ROOT_T>
 void plist<VAL_T, ROOT_T>::push_back(const VAL_T& val) {
+    PSTATS_OP(PSTATS_PLIST, "push_back");
+
+    emplace_back(val);
+}
+
+// Move the given value onto the end of the plist.
+template <typename VAL_T, typename ROOT_T>
+void plist<VAL_T, ROOT_T>::push_back(VAL_T&& val) {
+    PSTATS_OP(PSTATS_PLIST, "push_back");
+
+    emplace_back(std::move(val));
+}
+
+// Add a new value built in place from the given arguments to the end of the plist.
+template <typename VAL_T, typename ROOT_T>
+template <typename... Args>
+void plist<VAL_T, ROOT_T>::emplace_back(Args&&... args) {
+    PSTATS_OP(PSTATS_PLIST, "emplace_back");
+
     // we are editing the actual memory, so run a transaction
-    flat_transaction::run(pop, [&] {
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PLIST);
+        PSTATS_SNAPSHOT(PSTATS_PLIST, sizeof(head) + sizeof(tail) + sizeof(len));
+
         // allocate the new pnode
-        auto n = make_persistent<pnode<VAL_T, ROOT_T>>(val, pop);
+        PSTATS_ALLOC(PSTATS_PLIST, sizeof(pnode<VAL_T, ROOT_T>));
+        auto n = storage::template make<pnode<VAL_T, ROOT_T>>(pop, std::forward<Args>(args)...);
 
         // if this is the first push, the head & tail both point to the same pnode
         if (len == 0) {
@@ -155,6 +249,8 @@ void plist<VAL_T, ROOT_T>::push_back(const VAL_T& val) {
 // Remove and return the value at the back of the plist.
 template <typename VAL_T, typename ROOT_T>
 VAL_T plist<VAL_T, ROOT_T>::pop_back() {
+    PSTATS_OP(PSTATS_PLIST, "pop_back");
+
     if (len == 0)
         throw std::out_of_range("Cannot pop the back of an empty plist.");
 
@@ -166,19 +262,29 @@ VAL_T plist<VAL_T, ROOT_T>::pop_back() {
     int i = 0;
 
     // we will be deleting some pmem, so use a transaction
-    flat_transaction::run(pop, [&] {
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PLIST);
+        PSTATS_SNAPSHOT(PSTATS_PLIST, sizeof(head) + sizeof(tail) + sizeof(len));
+
         // step through the plist until we have hit second to last item
-        while (i < len - 1 && current != nullptr) {
+        while (i < len - 2 && current != nullptr) {
             current = current->get_next();
             i++;
         }
 
         // delete the old tail persistent memory
-        delete_persistent<pnode<VAL_T, ROOT_T>>(tail);
+        PSTATS_FREE(PSTATS_PLIST, sizeof(pnode<VAL_T, ROOT_T>));
+        storage::template destroy<pnode<VAL_T, ROOT_T>>(tail);
 
-        // update the tail to point to the correct pnode now
-        tail = current;
-        tail->set_next(nullptr);
+        // update the tail to point to the correct pnode now, or empty the list
+        if (len == 1) {
+            head = nullptr;
+            tail = nullptr;
+        }
+        else {
+            tail = current;
+            tail->set_next(nullptr);
+        }
 
         len--;
     });
@@ -190,10 +296,33 @@ VAL_T plist<VAL_T, ROOT_T>::pop_back() {
 // Add the given value to the front of the plist.
 template <typename VAL_T, typename ROOT_T>
 void plist<VAL_T, ROOT_T>::push_front(const VAL_T& val) {
+    PSTATS_OP(PSTATS_PLIST, "push_front");
+
+    emplace_front(val);
+}
+
+// Move the given value onto the front of the plist.
+template <typename VAL_T, typename ROOT_T>
+void plist<VAL_T, ROOT_T>::push_front(VAL_T&& val) {
+    PSTATS_OP(PSTATS_PLIST, "push_front");
+
+    emplace_front(std::move(val));
+}
+
+// Add a new value built in place from the given arguments to the front of the plist.
+template <typename VAL_T, typename ROOT_T>
+template <typename... Args>
+void plist<VAL_T, ROOT_T>::emplace_front(Args&&... args) {
+    PSTATS_OP(PSTATS_PLIST, "emplace_front");
+
     // editing memory, so run a transaction
-    flat_transaction::run(pop, [&] {
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PLIST);
+        PSTATS_SNAPSHOT(PSTATS_PLIST, sizeof(head) + sizeof(tail) + sizeof(len));
+
         // allocate the new pnode
-        auto n = make_persistent<pnode<VAL_T, ROOT_T>>(val, pop);
+        PSTATS_ALLOC(PSTATS_PLIST, sizeof(pnode<VAL_T, ROOT_T>));
+        auto n = storage::template make<pnode<VAL_T, ROOT_T>>(pop, std::forward<Args>(args)...);
 
         // if this is the first push, head & tail both point to the same pnode
         if (len == 0) {
@@ -214,6 +343,8 @@ void plist<VAL_T, ROOT_T>::push_front(const VAL_T& val) {
 // Remove and return the value at the front of the plist.
 template <typename VAL_T, typename ROOT_T>
 VAL_T plist<VAL_T, ROOT_T>::pop_front() {
+  PSTATS_OP(PSTATS_PLIST, "pop_front");
+
   if (len == 0)
     throw std::out_of_range("Cannot pop the front of an empty plist.");
 
@@ -221,14 +352,20 @@ VAL_T plist<VAL_T, ROOT_T>::pop_front() {
   VAL_T val = head->get_value();
 
   // we will be deleting some pmem, so use a transaction
-  flat_transaction::run(pop, [&] {
+  ptx::run(pop, [&] {
+    PSTATS_TX(PSTATS_PLIST);
+    PSTATS_SNAPSHOT(PSTATS_PLIST, sizeof(head) + sizeof(tail) + sizeof(len));
+
     auto new_head = head->get_next();
 
     // delete the old head persistent memory
-    delete_persistent<pnode<VAL_T, ROOT_T>>(head);
+    PSTATS_FREE(PSTATS_PLIST, sizeof(pnode<VAL_T, ROOT_T>));
+    storage::template destroy<pnode<VAL_T, ROOT_T>>(head);
 
-    // update the head to point to the correct pnode now
+    // update the head to point to the correct pnode now, and the tail too if that emptied us
     head = new_head;
+    if (head == nullptr)
+      tail = nullptr;
 
     len--;
   });
@@ -240,38 +377,64 @@ VAL_T plist<VAL_T, ROOT_T>::pop_front() {
 // Insert the given value at the given index into the list.
 template <typename VAL_T, typename ROOT_T>
 void plist<VAL_T, ROOT_T>::insert(const VAL_T& val, int idx) {
+    PSTATS_OP(PSTATS_PLIST, "insert");
+
+    emplace(idx, val);
+}
+
+// Move the given value into the given index of the list.
+template <typename VAL_T, typename ROOT_T>
+void plist<VAL_T, ROOT_T>::insert(VAL_T&& val, int idx) {
+    PSTATS_OP(PSTATS_PLIST, "insert");
+
+    emplace(idx, std::move(val));
+}
+
+// Insert a new value built in place from the given arguments at the given index.
+template <typename VAL_T, typename ROOT_T>
+template <typename... Args>
+void plist<VAL_T, ROOT_T>::emplace(int idx, Args&&... args) {
+    PSTATS_OP(PSTATS_PLIST, "emplace");
+
     if (idx < 0 || idx > len) 
         throw std::out_of_range("Given index is outside the range of the list.");
 
-    // we edit pmem, so use a transaction
-    flat_transaction::run(pop, [&] {
-        auto n = make_persistent<pnode<VAL_T, ROOT_T>>(val, pop);
-        
-        // if there are no existing nodes, head & tail both point to the new node
-        if (len == 0) {
-            head = n;
-            tail = n;
-        }
-        else {
-            auto current = head;
-            int i = 0;
+    // the ends have to move head or tail, so let the end-specific versions handle them
+    if (idx == 0) {
+        emplace_front(std::forward<Args>(args)...);
+        return;
+    }
+    if (idx == len) {
+        emplace_back(std::forward<Args>(args)...);
+        return;
+    }
 
-            // get node right before the chosen index
-            while (i < idx - 1 && current != nullptr) {
-                current = current->get_next();
-                i++;
-            }
+    // we edit pmem, so use a transaction
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PLIST);
+        PSTATS_SNAPSHOT(PSTATS_PLIST, sizeof(len));
+        PSTATS_ALLOC(PSTATS_PLIST, sizeof(pnode<VAL_T, ROOT_T>));
 
-            // save node's new next value
-            auto new_next = current->get_next();
+        auto n = storage::template make<pnode<VAL_T, ROOT_T>>(pop, std::forward<Args>(args)...);
 
-            // set current to point to the new node
-            current->set_next(n);
+        auto current = head;
+        int i = 0;
 
-            // set the new node to point current's previous next element
-            n->set_next(new_next);
+        // get node right before the chosen index
+        while (i < idx - 1 && current != nullptr) {
+            current = current->get_next();
+            i++;
         }
 
+        // save node's new next value
+        auto new_next = current->get_next();
+
+        // set current to point to the new node
+        current->set_next(n);
+
+        // set the new node to point current's previous next element
+        n->set_next(new_next);
+
         len++;
     });
 }
@@ -279,13 +442,25 @@ void plist<VAL_T, ROOT_T>::insert(const VAL_T& val, int idx) {
 // Remove the node at the given index, returning the value of the item removed.
 template <typename VAL_T, typename ROOT_T>
 VAL_T plist<VAL_T, ROOT_T>::remove(int idx) {
+    PSTATS_OP(PSTATS_PLIST, "remove");
+
     if (idx < 0 || idx >= len)
         throw std::out_of_range("Cannot remove beyond range of the list.");
 
+    // the ends also have to move head or tail, which their pops already handle
+    if (idx == 0)
+        return pop_front();
+
+    if (idx == len - 1)
+        return pop_back();
+
     VAL_T val;
 
     // we edit pmem
-    flat_transaction::run(pop, [&] {
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PLIST);
+        PSTATS_SNAPSHOT(PSTATS_PLIST, sizeof(head) + sizeof(tail) + sizeof(len));
+
         auto current = head;
         int i = 0;
 
@@ -307,7 +482,8 @@ VAL_T plist<VAL_T, ROOT_T>::remove(int idx) {
         to_delete->set_next(nullptr);
 
         // delete the node
-        delete_persistent<pnode<VAL_T, ROOT_T>>(to_delete);
+        PSTATS_FREE(PSTATS_PLIST, sizeof(pnode<VAL_T, ROOT_T>));
+        storage::template destroy<pnode<VAL_T, ROOT_T>>(to_delete);
 
         len--;
     });
@@ -329,38 +505,166 @@ bool plist<VAL_T, ROOT_T>::is_empty() const {
     return len == 0;
 }
 
+/* ================================ LAYOUT ================================= */
+
+// Get how scattered the nodes are across the pool, in list order.
+template <typename VAL_T, typename ROOT_T>
+plist_layout plist<VAL_T, ROOT_T>::layout() const {
+    PSTATS_OP(PSTATS_PLIST, "layout");
+
+    plist_layout res;
+    measure(res);
+
+    return res;
+}
+
+// Reallocate every node in list order, so the allocator can place them next to each
+// other, and relink them. Runs as one transaction per step nodes, so it never holds up
+// other work on the pool for long, and a crash loses at most the step in progress; the
+// list is whole between steps. Returns the layout before and after.
+template <typename VAL_T, typename ROOT_T>
+plist_relayout plist<VAL_T, ROOT_T>::relayout(int step) {
+    PSTATS_OP(PSTATS_PLIST, "relayout");
+
+    if (step < 1)
+        throw std::out_of_range("Cannot relayout fewer than one node at a time.");
+
+    plist_relayout res;
+    res.before = layout();
+
+    ptr_t<pnode<VAL_T, ROOT_T>> prev = nullptr;
+    int done = 0;
+
+    while (done < len) {
+        int n = len - done < step ? len - done : step;
+
+        ptx::run(pop, [&] {
+            PSTATS_TX(PSTATS_PLIST);
+            prev = move_nodes(prev, n);
+        });
+
+        done += n;
+    }
+
+    res.after = layout();
+
+    return res;
+}
+
+// Add every node to the given layout count, in list order.
+template <typename VAL_T, typename ROOT_T>
+void plist<VAL_T, ROOT_T>::measure(plist_layout& res) const {
+    auto current = head;
+    int i = 0;
+
+    while (i < len && current != nullptr) {
+        res.add(current.raw().off);
+
+        current = current->get_next();
+        i++;
+    }
+}
+
+// Replace the n nodes after the given one (or from the head if it is null) with fresh
+// copies allocated one after the other, returning the last copy. Must run inside a
+// transaction.
+template <typename VAL_T, typename ROOT_T>
+typename plist<VAL_T, ROOT_T>::template ptr_t<pnode<VAL_T, ROOT_T>> plist<VAL_T, ROOT_T>::move_nodes(
+    ptr_t<pnode<VAL_T, ROOT_T>> prev, int n) {
+    auto current = prev == nullptr ? head : prev->get_next();
+
+    for (int i = 0; i < n && current != nullptr; i++) {
+        auto next = current->get_next();
+
+        PSTATS_ALLOC(PSTATS_PLIST, sizeof(pnode<VAL_T, ROOT_T>));
+        auto fresh = storage::template make<pnode<VAL_T, ROOT_T>>(current->get_value(), pop);
+        fresh->set_next(next);
+
+        // point whatever led to the old node at its copy
+        if (prev == nullptr)
+            head = fresh;
+        else
+            prev->set_next(fresh);
+
+        if (current == tail)
+            tail = fresh;
+
+        PSTATS_FREE(PSTATS_PLIST, sizeof(pnode<VAL_T, ROOT_T>));
+        storage::template destroy<pnode<VAL_T, ROOT_T>>(current);
+
+        prev = fresh;
+        current = next;
+    }
+
+    return prev;
+}
+
 /* ================================ MISC. ================================== */
 
 // Completely clear the list, removing all elements but leaving this object allocated.
 template <typename VAL_T, typename ROOT_T>
 void plist<VAL_T, ROOT_T>::clear() {
+    PSTATS_OP(PSTATS_PLIST, "clear");
+
     auto current = head;
     int i = 0;
 
     // we edit pmem
-    flat_transaction::run(pop, [&] {
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PLIST);
+
         // step through and delete all nodes
         while (i < len && current != nullptr) {
             // get the next item and store it
             auto next = current->get_next();
 
             // delete the current node
-            delete_persistent<pnode<VAL_T, ROOT_T>>(current);
+            PSTATS_FREE(PSTATS_PLIST, sizeof(pnode<VAL_T, ROOT_T>));
+            storage::template destroy<pnode<VAL_T, ROOT_T>>(current);
 
             // and set the current to be the stored node
             current = next;
 
             i++;
         }
+
+        head = nullptr;
+        tail = nullptr;
+        len = 0;
     });
+}
 
-    len = 0;
+// Clear the list in O(1) by detaching the whole chain of nodes and deferring it to the
+// given reclamation list, which frees it in bounded steps later (see preclaim). A list
+// on the heap has no log to outgrow, so it is simply cleared.
+template <typename VAL_T, typename ROOT_T>
+void plist<VAL_T, ROOT_T>::clear(preclaim& trash) {
+    PSTATS_OP(PSTATS_PLIST, "clear");
+
+    if constexpr (std::is_same<ROOT_T, pdram>::value) {
+        clear();
+    }
+    else {
+        ptx::run(pop, [&] {
+            PSTATS_TX(PSTATS_PLIST);
+            PSTATS_SNAPSHOT(PSTATS_PLIST, sizeof(head) + sizeof(tail) + sizeof(len));
+
+            if (head != nullptr)
+                trash.defer_chain(head, head->get_link_offset());
+
+            head = nullptr;
+            tail = nullptr;
+            len = 0;
+        });
+    }
 }
 
 // Refresh the current pool object that the plist stores. Must be called when loading
 // an existing pool file from disk.
 template <typename VAL_T, typename ROOT_T>
-void plist<VAL_T, ROOT_T>::refresh_pool(pool<ROOT_T> new_pop) {
+void plist<VAL_T, ROOT_T>::refresh_pool(pool_t new_pop) {
+    PSTATS_OP(PSTATS_PLIST, "refresh_pool");
+
     auto current = head;
     int i = 0;
 
@@ -374,12 +678,103 @@ void plist<VAL_T, ROOT_T>::refresh_pool(pool<ROOT_T> new_pop) {
     pop = new_pop;
 }
 
+// Give the nodes of every plist of this type an allocation class of their exact size in
+// the given pool (see palloc). Must be called each time the pool is created or opened.
+template <typename VAL_T, typename ROOT_T>
+void plist<VAL_T, ROOT_T>::register_classes(pool_t new_pop) {
+    if constexpr (!std::is_same<ROOT_T, pdram>::value)
+        palloc::add<pnode<VAL_T, ROOT_T>>(new_pop);
+}
+
+// Call the given function on the value of every node, from head to tail.
+template <typename VAL_T, typename ROOT_T>
+template <typename F>
+void plist<VAL_T, ROOT_T>::for_each(F&& fn) const {
+    auto current = head;
+    int i = 0;
+
+    while (i < len && current != nullptr) {
+        fn(current->get_value());
+
+        current = current->get_next();
+        i++;
+    }
+}
+
+// Write the values as text to the given sink, as "[a, b, c]" like operator<<, formatting
+// them into large buffers instead of streaming them one at a time (see pdump).
+template <typename VAL_T, typename ROOT_T>
+void plist<VAL_T, ROOT_T>::dump(pdump_sink& sink) const {
+    PSTATS_OP(PSTATS_PLIST, "dump");
+
+    pdump out(sink);
+    bool first = true;
+
+    out.put('[');
+    for_each([&](const VAL_T& val) {
+        if (!first)
+            out.put(", ");
+        out.put_value(val);
+        first = false;
+    });
+    out.put(']');
+    out.flush();
+}
+
 // Completely destroy this object and its allocated memory.
 template <typename VAL_T, typename ROOT_T>
 void plist<VAL_T, ROOT_T>::destroy() {
+    PSTATS_OP(PSTATS_PLIST, "destroy");
+
     clear();
 
-    flat_transaction::run(pop, [&] {
-        delete_persistent<plist<VAL_T, ROOT_T>>(this);
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PLIST);
+        PSTATS_FREE(PSTATS_PLIST, sizeof(plist<VAL_T, ROOT_T>));
+
+        storage::template destroy<plist<VAL_T, ROOT_T>>(this);
+    });
+}
+
+// Destroy this object in O(1), deferring its nodes to the given reclamation list.
+template <typename VAL_T, typename ROOT_T>
+void plist<VAL_T, ROOT_T>::destroy(preclaim& trash) {
+    PSTATS_OP(PSTATS_PLIST, "destroy");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PLIST);
+        PSTATS_FREE(PSTATS_PLIST, sizeof(plist<VAL_T, ROOT_T>));
+
+        clear(trash);
+        storage::template destroy<plist<VAL_T, ROOT_T>>(this);
     });
-}
\ No newline at end of file
+}
+
+// Run the given function as one transaction that every edit made inside it joins.
+template <typename VAL_T, typename ROOT_T>
+template <typename F>
+void plist<VAL_T, ROOT_T>::batch(F&& fn) {
+    PSTATS_OP(PSTATS_PLIST, "batch");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PLIST);
+        fn();
+    });
+}
+
+/* ========================================================================= */
+/* **************************** preclaim_chain ***************************** */
+/* ========================================================================= */
+
+// Get the offset of the head pointer within a list, which is null for an empty one.
+template <typename VAL_T, typename ROOT_T>
+uint32_t preclaim_chain<plist<VAL_T, ROOT_T>>::head_offset() {
+    typedef plist<VAL_T, ROOT_T> list_t;
+    return offsetof(list_t, head);
+}
+
+// Get the offset of the pointer to the next node within a node.
+template <typename VAL_T, typename ROOT_T>
+uint32_t preclaim_chain<plist<VAL_T, ROOT_T>>::link_offset() {
+    return pnode<VAL_T, ROOT_T>::get_link_offset();
+}
@@ -0,0 +1,123 @@
+#ifndef _PPACKEDVECTOR_H
+#define _PPACKEDVECTOR_H
+
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/transaction.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "../pvector/pvector.h"
+#include "../pstats/pstats.h"
+#include "../pstorage/pstorage.h"
+#include "../ptx/ptx.h"
+#include "../ptraits/ptraits.h"
+
+using namespace pmem;
+using namespace pmem::obj;
+
+// values per packed block
+#define PPACKED_BLOCK 128
+
+// Where and how one block of PPACKED_BLOCK values is packed.
+struct ppacked_block {
+    // first value of the block, used by delta blocks
+    uint64_t base;
+    // subtracted from every value (frame of reference) or delta before packing
+    uint64_t ref;
+    // index of the block's first word
+    uint32_t offset;
+    // bits per packed value, 0 to 64
+    uint8_t width;
+    // whether deltas rather than values are packed
+    uint8_t delta;
+};
+
+// Block kernels, vectorized 4 values at a time when built with AVX2 (`make AVX2=1`). A block
+// packs its 128 values into 4 interleaved bit streams, value i going to stream i % 4, and
+// word k of stream l is stored at 4 * k + l. Position j of every stream then sits at the
+// same word and shift, so one 256-bit load and shift yields values 4j to 4j + 3.
+inline int ppacked_words(int);
+inline void ppacked_pack(const uint64_t*, int, uint64_t*);
+inline void ppacked_unpack(const uint64_t*, int, uint64_t*);
+inline uint64_t ppacked_extract(const uint64_t*, int, int);
+inline void ppacked_prefix(uint64_t*, uint64_t, uint64_t);
+
+// An append-only sequence of integers, compressed in blocks of PPACKED_BLOCK values. Each
+// full block is packed either as offsets from its smallest value (frame of reference) or
+// as the deltas between neighbours, whichever needs fewer bits, so monotonic timestamps
+// and small counters take a few bits per value instead of 4 or 8 bytes. The last, partial
+// block is kept unpacked until it fills up.
+//
+// Reads decode a whole block at a time, which is what scans want. Random access into a
+// frame-of-reference block reads a single value, while a delta block is decoded up to
+// the value asked for.
+template <typename INT_T, typename ROOT_T>
+class ppackedvector {
+    static_assert(std::is_integral<INT_T>::value && sizeof(INT_T) <= 8,
+                  "ppackedvector holds integers of at most 64 bits.");
+
+public:
+    // where this container lives, picked by ROOT_T (see pstorage)
+    typedef pstorage<ROOT_T> storage;
+    template <typename T>
+    using ptr_t = typename storage::template ptr<T>;
+    typedef typename storage::pool_type pool_t;
+
+private:
+    ptr_t<pvector<uint64_t, ROOT_T>> words;
+    ptr_t<pvector<ppacked_block, ROOT_T>> blocks;
+    // the unpacked values of the partial block
+    ptr_t<INT_T[]> tail;
+    p<int> len;
+    pool_t pop;
+
+    int sealed() const;
+    void seal();
+    void decode(int, uint64_t*) const;
+
+public:
+    // Constructors
+    ppackedvector(pool_t);
+
+    // Operator Overloads
+    INT_T operator[](int) const;
+
+    // Push/Pop
+    void push_back(INT_T);
+    template <typename It>
+    void append(It, It);
+
+    // Get/Set
+    int get_length() const;
+    int get_blocks() const;
+    size_t get_bytes() const;
+    double get_ratio() const;
+
+    // Scans
+    int decode_block(int, INT_T*) const;
+    template <typename F>
+    void for_each(F&&) const;
+
+    // Misc.
+    template <typename F>
+    void batch(F&&);
+    void refresh_pool(pool_t);
+    void shrink();
+    void clear();
+    void destroy();
+};
+
+// a ppackedvector is pool offsets, an int and a pool handle, so it can be moved bytewise
+template <typename INT_T, typename ROOT_T>
+struct is_prelocatable<ppackedvector<INT_T, ROOT_T>> : std::true_type {};
+
+#include "ppackedvector.hpp"
+
+#endif
@@ -0,0 +1,459 @@
+#include "ppackedvector.h"
+
+/* ========================================================================= */
+/* ******************************* kernels ********************************* */
+/* ========================================================================= */
+
+// Get the number of words a block packed at the given bit width takes: each of the 4
+// streams holds 32 values and is rounded up to a whole word.
+inline int ppacked_words(int width) {
+    return 4 * ((width + 1) / 2);
+}
+
+// Pack the 128 values of a block, each below 2^width, into interleaved streams.
+inline void ppacked_pack(const uint64_t* vals, int width, uint64_t* w) {
+    memset(w, 0, sizeof(uint64_t) * ppacked_words(width));
+
+    if (width == 0)
+        return;
+
+    for (int i = 0; i < PPACKED_BLOCK; i++) {
+        int pos = (i >> 2) * width;
+        int k = 4 * (pos >> 6) + (i & 3);
+        int s = pos & 63;
+
+        w[k] |= vals[i] << s;
+        if (s + width > 64)
+            w[k + 4] |= vals[i] >> (64 - s);
+    }
+}
+
+// Unpack the 128 values of a block packed at bit width W, in order. With the width known at
+// compile time, every word index and shift below is a constant once the loop is unrolled.
+// With AVX2, the 4 values at each stream position are shifted out of the 4 streams at once.
+template <int W>
+inline void ppacked_unpack_fixed(const uint64_t* w, uint64_t* out) {
+    if constexpr (W == 0) {
+        memset(out, 0, sizeof(uint64_t) * PPACKED_BLOCK);
+    }
+    else {
+        const uint64_t mask = ~0ULL >> (64 - W);
+
+#ifdef __AVX2__
+        const __m256i m = _mm256_set1_epi64x((long long)mask);
+
+#pragma GCC unroll 32
+        for (int j = 0; j < PPACKED_BLOCK / 4; j++) {
+            const int pos = j * W;
+            const int k = 4 * (pos >> 6);
+            const int s = pos & 63;
+
+            __m256i x = _mm256_srli_epi64(_mm256_loadu_si256((const __m256i*)(w + k)), s);
+            if (s + W > 64) {
+                __m256i hi = _mm256_loadu_si256((const __m256i*)(w + k + 4));
+                x = _mm256_or_si256(x, _mm256_slli_epi64(hi, 64 - s));
+            }
+
+            _mm256_storeu_si256((__m256i*)(out + 4 * j), _mm256_and_si256(x, m));
+        }
+#else
+#pragma GCC unroll 32
+        for (int j = 0; j < PPACKED_BLOCK / 4; j++) {
+            const int pos = j * W;
+            const int k = 4 * (pos >> 6);
+            const int s = pos & 63;
+
+            for (int l = 0; l < 4; l++) {
+                uint64_t x = w[k + l] >> s;
+                if (s + W > 64)
+                    x |= w[k + 4 + l] << ((64 - s) & 63);
+
+                out[4 * j + l] = x & mask;
+            }
+        }
+#endif
+    }
+}
+
+// Pick the unpacking kernel for each width out of a table built at compile time.
+template <size_t... W>
+inline void ppacked_unpack_width(const uint64_t* w, int width, uint64_t* out, std::index_sequence<W...>) {
+    static void (*const kernels[])(const uint64_t*, uint64_t*) = {&ppacked_unpack_fixed<(int)W>...};
+
+    kernels[width](w, out);
+}
+
+// Unpack the 128 values of a block packed at the given bit width, in order.
+inline void ppacked_unpack(const uint64_t* w, int width, uint64_t* out) {
+    ppacked_unpack_width(w, width, out, std::make_index_sequence<65>());
+}
+
+// Unpack the single value at the given index of a block packed at the given bit width.
+inline uint64_t ppacked_extract(const uint64_t* w, int width, int i) {
+    if (width == 0)
+        return 0;
+
+    uint64_t mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+    int pos = (i >> 2) * width;
+    int k = 4 * (pos >> 6) + (i & 3);
+    int s = pos & 63;
+
+    uint64_t x = w[k] >> s;
+    if (s + width > 64)
+        x |= w[k + 4] << (64 - s);
+
+    return x & mask;
+}
+
+// Turn the unpacked deltas of a block back into values, in place: the first value is the
+// base, and every later one is the value before it plus ref plus its packed delta. With
+// AVX2, each group of 4 is first summed within its register, independently of the other
+// groups, and the running total is then carried across the groups with one scalar add
+// per group.
+inline void ppacked_prefix(uint64_t* vals, uint64_t base, uint64_t ref) {
+    // the first packed delta is always 0, so starting one ref back lands on the base
+    uint64_t acc = base - ref;
+
+#ifdef __AVX2__
+    const __m256i r = _mm256_set1_epi64x((long long)ref);
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (int i = 0; i < PPACKED_BLOCK; i += 4) {
+        __m256i x = _mm256_add_epi64(_mm256_loadu_si256((const __m256i*)(vals + i)), r);
+
+        // [a, b, c, d] -> [a, a+b, b+c, c+d] -> [a, a+b, a+b+c, a+b+c+d]
+        x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0x90), zero, 0x03));
+        x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0x40), zero, 0x0f));
+
+        _mm256_storeu_si256((__m256i*)(vals + i), x);
+    }
+
+    for (int i = 0; i < PPACKED_BLOCK; i += 4) {
+        uint64_t carry = acc;
+        acc += vals[i + 3];
+
+        __m256i x = _mm256_loadu_si256((const __m256i*)(vals + i));
+        _mm256_storeu_si256((__m256i*)(vals + i), _mm256_add_epi64(x, _mm256_set1_epi64x((long long)carry)));
+    }
+#else
+    for (int i = 0; i < PPACKED_BLOCK; i++) {
+        acc += vals[i] + ref;
+        vals[i] = acc;
+    }
+#endif
+}
+
+/* ========================================================================= */
+/* ***************************** ppackedvector ***************************** */
+/* ========================================================================= */
+
+/* ============================ CONSTRUCTORS =============================== */
+
+// Create a new, empty packed vector.
+template <typename INT_T, typename ROOT_T>
+ppackedvector<INT_T, ROOT_T>::ppackedvector(pool_t pop_in) {
+    PSTATS_OP(PSTATS_PPACKEDVECTOR, "construct");
+    pop = pop_in;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PPACKEDVECTOR);
+        PSTATS_ALLOC(PSTATS_PPACKEDVECTOR, sizeof(pvector<uint64_t, ROOT_T>) +
+                                           sizeof(pvector<ppacked_block, ROOT_T>) +
+                                           sizeof(INT_T) * PPACKED_BLOCK);
+
+        words = storage::template make<pvector<uint64_t, ROOT_T>>(pop);
+        blocks = storage::template make<pvector<ppacked_block, ROOT_T>>(pop);
+        tail = storage::template make<INT_T[]>(PPACKED_BLOCK);
+        len = 0;
+    });
+}
+
+/* ========================== OPERATOR OVERLOADS =========================== */
+
+// Get the value at the given index.
+template <typename INT_T, typename ROOT_T>
+INT_T ppackedvector<INT_T, ROOT_T>::operator[](int idx) const {
+    if (idx < 0 || idx >= len)
+        throw std::out_of_range("Cannot access past the range of the packed vector.");
+
+    int b = idx / PPACKED_BLOCK;
+    int i = idx % PPACKED_BLOCK;
+
+    if (b == sealed())
+        return tail[i];
+
+    const ppacked_block& hdr = (*blocks)[b];
+
+    // a delta block has to be summed up to the value, so decode the lot
+    if (hdr.delta) {
+        uint64_t vals[PPACKED_BLOCK];
+        decode(b, vals);
+        return (INT_T)vals[i];
+    }
+
+    const uint64_t* w = hdr.width ? &(*words)[hdr.offset] : nullptr;
+    return (INT_T)(ppacked_extract(w, hdr.width, i) + hdr.ref);
+}
+
+/* ============================== PUSH/POP ================================= */
+
+// Append the given value, packing the partial block once it fills up.
+template <typename INT_T, typename ROOT_T>
+void ppackedvector<INT_T, ROOT_T>::push_back(INT_T val) {
+    PSTATS_OP(PSTATS_PPACKEDVECTOR, "push_back");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PPACKEDVECTOR);
+        PSTATS_SNAPSHOT(PSTATS_PPACKEDVECTOR, sizeof(INT_T) + sizeof(len));
+
+        int i = len % PPACKED_BLOCK;
+
+        storage::snapshot(&tail[i]);
+        tail[i] = val;
+        len++;
+
+        if (i + 1 == PPACKED_BLOCK)
+            seal();
+    });
+}
+
+// Append every value in the given range in one transaction.
+template <typename INT_T, typename ROOT_T>
+template <typename It>
+void ppackedvector<INT_T, ROOT_T>::append(It first, It last) {
+    PSTATS_OP(PSTATS_PPACKEDVECTOR, "append");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PPACKEDVECTOR);
+
+        for (; first != last; ++first)
+            push_back(*first);
+    });
+}
+
+/* =============================== GET/SET ================================= */
+
+// Get the number of values.
+template <typename INT_T, typename ROOT_T>
+int ppackedvector<INT_T, ROOT_T>::get_length() const {
+    return len;
+}
+
+// Get the number of blocks, counting a partial last block.
+template <typename INT_T, typename ROOT_T>
+int ppackedvector<INT_T, ROOT_T>::get_blocks() const {
+    return (len + PPACKED_BLOCK - 1) / PPACKED_BLOCK;
+}
+
+// Get the bytes allocated for the packed words, block headers and partial block,
+// including spare capacity.
+template <typename INT_T, typename ROOT_T>
+size_t ppackedvector<INT_T, ROOT_T>::get_bytes() const {
+    return sizeof(uint64_t) * words->get_capacity() + sizeof(ppacked_block) * blocks->get_capacity() +
+           sizeof(INT_T) * PPACKED_BLOCK;
+}
+
+// Get how many times smaller the values are than they would be stored plainly.
+template <typename INT_T, typename ROOT_T>
+double ppackedvector<INT_T, ROOT_T>::get_ratio() const {
+    return (double)sizeof(INT_T) * len / get_bytes();
+}
+
+/* ================================ SCANS ================================== */
+
+// Decode the block at the given index into the given array, which must have room for
+// PPACKED_BLOCK values, returning the number of values in the block.
+template <typename INT_T, typename ROOT_T>
+int ppackedvector<INT_T, ROOT_T>::decode_block(int b, INT_T* out) const {
+    if (b < 0 || b >= get_blocks())
+        throw std::out_of_range("Cannot decode past the last block of the packed vector.");
+
+    if (b == sealed()) {
+        int n = len % PPACKED_BLOCK;
+        std::copy(&tail[0], &tail[0] + n, out);
+        return n;
+    }
+
+    uint64_t vals[PPACKED_BLOCK];
+    decode(b, vals);
+
+    for (int i = 0; i < PPACKED_BLOCK; i++)
+        out[i] = (INT_T)vals[i];
+
+    return PPACKED_BLOCK;
+}
+
+// Call the given function with every value in order, decoding a block at a time.
+template <typename INT_T, typename ROOT_T>
+template <typename F>
+void ppackedvector<INT_T, ROOT_T>::for_each(F&& fn) const {
+    INT_T vals[PPACKED_BLOCK];
+
+    for (int b = 0; b < get_blocks(); b++) {
+        int n = decode_block(b, vals);
+
+        for (int i = 0; i < n; i++)
+            fn(vals[i]);
+    }
+}
+
+/* ================================ MISC. ================================== */
+
+// Get the number of full, packed blocks.
+template <typename INT_T, typename ROOT_T>
+int ppackedvector<INT_T, ROOT_T>::sealed() const {
+    return len / PPACKED_BLOCK;
+}
+
+// Pack the full partial block, as offsets from its smallest value or as deltas, whichever
+// is narrower, and append it. Must run inside the transaction that filled it.
+template <typename INT_T, typename ROOT_T>
+void ppackedvector<INT_T, ROOT_T>::seal() {
+    uint64_t vals[PPACKED_BLOCK];
+    uint64_t packed[PPACKED_BLOCK];
+
+    // signed values are sign-extended, and all the arithmetic wraps, so decoding gives
+    // back exactly what went in; the smallest values are only picked to keep widths down
+    for (int i = 0; i < PPACKED_BLOCK; i++)
+        vals[i] = (uint64_t)tail[i];
+
+    uint64_t fmin = vals[0];
+    uint64_t dmin = vals[1] - vals[0];
+    for (int i = 1; i < PPACKED_BLOCK; i++) {
+        if ((int64_t)vals[i] < (int64_t)fmin)
+            fmin = vals[i];
+        if ((int64_t)(vals[i] - vals[i - 1]) < (int64_t)dmin)
+            dmin = vals[i] - vals[i - 1];
+    }
+
+    uint64_t fspan = 0;
+    uint64_t dspan = 0;
+    for (int i = 0; i < PPACKED_BLOCK; i++) {
+        fspan = std::max(fspan, vals[i] - fmin);
+        if (i > 0)
+            dspan = std::max(dspan, vals[i] - vals[i - 1] - dmin);
+    }
+
+    ppacked_block hdr;
+    int fwidth = fspan ? 64 - __builtin_clzll(fspan) : 0;
+    int dwidth = dspan ? 64 - __builtin_clzll(dspan) : 0;
+
+    hdr.base = vals[0];
+    hdr.delta = dwidth < fwidth;
+    hdr.width = hdr.delta ? dwidth : fwidth;
+    hdr.ref = hdr.delta ? dmin : fmin;
+    hdr.offset = words->get_length();
+
+    if (hdr.delta) {
+        for (int i = PPACKED_BLOCK - 1; i > 0; i--)
+            vals[i] = vals[i] - vals[i - 1] - dmin;
+        vals[0] = 0;
+    }
+    else {
+        for (int i = 0; i < PPACKED_BLOCK; i++)
+            vals[i] -= fmin;
+    }
+
+    int n = ppacked_words(hdr.width);
+    ppacked_pack(vals, hdr.width, packed);
+
+    // grow by an eighth at a time, so appends stay amortized O(1) without leaving much
+    // of the saved space allocated and unused
+    if (words->get_length() + n > words->get_capacity())
+        words->reserve(words->get_length() + n + words->get_capacity() / 8);
+    if (blocks->get_length() + 1 > blocks->get_capacity())
+        blocks->reserve(blocks->get_length() + 1 + blocks->get_capacity() / 8);
+
+    PSTATS_ALLOC(PSTATS_PPACKEDVECTOR, sizeof(uint64_t) * n + sizeof(ppacked_block));
+
+    for (int k = 0; k < n; k++)
+        words->push_back(packed[k]);
+    blocks->push_back(hdr);
+}
+
+// Decode the full block at the given index into the given array of PPACKED_BLOCK values.
+template <typename INT_T, typename ROOT_T>
+void ppackedvector<INT_T, ROOT_T>::decode(int b, uint64_t* vals) const {
+    const ppacked_block& hdr = (*blocks)[b];
+    const uint64_t* w = hdr.width ? &(*words)[hdr.offset] : nullptr;
+
+    ppacked_unpack(w, hdr.width, vals);
+
+    if (hdr.delta) {
+        ppacked_prefix(vals, hdr.base, hdr.ref);
+    }
+    else {
+        for (int i = 0; i < PPACKED_BLOCK; i++)
+            vals[i] += hdr.ref;
+    }
+}
+
+// Run the given function as one transaction, so the values appended inside it commit together.
+template <typename INT_T, typename ROOT_T>
+template <typename F>
+void ppackedvector<INT_T, ROOT_T>::batch(F&& fn) {
+    PSTATS_OP(PSTATS_PPACKEDVECTOR, "batch");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PPACKEDVECTOR);
+        fn();
+    });
+}
+
+// Refresh the reference to the pool that this vector lives in. Must be called when using a
+// ppackedvector from an existing file.
+template <typename INT_T, typename ROOT_T>
+void ppackedvector<INT_T, ROOT_T>::refresh_pool(pool_t new_pop) {
+    pop = new_pop;
+    words->refresh_pool(new_pop);
+    blocks->refresh_pool(new_pop);
+}
+
+// Give back the spare capacity of the packed words and block headers, e.g. once a column
+// is done growing.
+template <typename INT_T, typename ROOT_T>
+void ppackedvector<INT_T, ROOT_T>::shrink() {
+    PSTATS_OP(PSTATS_PPACKEDVECTOR, "shrink");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PPACKEDVECTOR);
+
+        if (words->get_length() > 0)
+            words->shrink();
+        if (blocks->get_length() > 0)
+            blocks->shrink();
+    });
+}
+
+// Remove every value.
+template <typename INT_T, typename ROOT_T>
+void ppackedvector<INT_T, ROOT_T>::clear() {
+    PSTATS_OP(PSTATS_PPACKEDVECTOR, "clear");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PPACKEDVECTOR);
+        PSTATS_SNAPSHOT(PSTATS_PPACKEDVECTOR, sizeof(len));
+
+        words->clear();
+        blocks->clear();
+        len = 0;
+    });
+}
+
+// Completely destroy this object and its allocated memory.
+template <typename INT_T, typename ROOT_T>
+void ppackedvector<INT_T, ROOT_T>::destroy() {
+    PSTATS_OP(PSTATS_PPACKEDVECTOR, "destroy");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PPACKEDVECTOR);
+        PSTATS_FREE(PSTATS_PPACKEDVECTOR, sizeof(INT_T) * PPACKED_BLOCK +
+                                          sizeof(ppackedvector<INT_T, ROOT_T>));
+
+        words->destroy();
+        blocks->destroy();
+        storage::template destroy<INT_T[]>(tail, PPACKED_BLOCK);
+
+        storage::template destroy<ppackedvector<INT_T, ROOT_T>>(this);
+    });
+}
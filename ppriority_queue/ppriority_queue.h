@@ -0,0 +1,79 @@
+#ifndef _PPRIORITY_QUEUE_H
+#define _PPRIORITY_QUEUE_H
+
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/transaction.hpp>
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "../pvector/pvector.h"
+#include "../pstats/pstats.h"
+#include "../pstorage/pstorage.h"
+#include "../ptx/ptx.h"
+#include "../ptraits/ptraits.h"
+
+using namespace pmem;
+using namespace pmem::obj;
+
+// Binary heap kept in a pvector, with the item that COMP_T orders last on top, as in
+// std::priority_queue: std::less<VAL_T> gives a max-heap and std::greater<VAL_T> a
+// min-heap, e.g. for the earliest deadline. COMP_T is default-constructed for every use,
+// so it must not carry state.
+//
+// push and pop move items along a single root-to-leaf path, and only the slots they
+// overwrite are logged, so both log O(log n) slots rather than the whole array.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+class ppriority_queue {
+public:
+    // where this container lives, picked by ROOT_T (see pstorage)
+    typedef pstorage<ROOT_T> storage;
+    template <typename T>
+    using ptr_t = typename storage::template ptr<T>;
+    typedef typename storage::pool_type pool_t;
+
+private:
+    ptr_t<pvector<VAL_T, ROOT_T>> data;
+    // not named pop, which is taken by pop()
+    pool_t ppool;
+
+    void set(int, const VAL_T&);
+    void sift_up(int);
+    void sift_down(int);
+    void restore(int);
+    void grow(int);
+
+public:
+    // Constructors
+    ppriority_queue(pool_t);
+
+    // Push/Pop
+    void push(const VAL_T&);
+    template <typename It>
+    void push_many(It, It);
+    VAL_T pop();
+    template <typename It>
+    void heapify(It, It);
+
+    // Get/Set
+    const VAL_T& top() const;
+    int get_length() const;
+    bool is_empty() const;
+
+    // Misc.
+    template <typename F>
+    void batch(F&&);
+    void refresh_pool(pool_t);
+    void clear();
+    void destroy();
+};
+
+// a ppriority_queue is just a pool offset and a pool handle, so it can be moved bytewise
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+struct is_prelocatable<ppriority_queue<VAL_T, COMP_T, ROOT_T>> : std::true_type {};
+
+#include "ppriority_queue.hpp"
+
+#endif
@@ -0,0 +1,260 @@
+#include "ppriority_queue.h"
+
+/* ========================================================================= */
+/* **************************** ppriority_queue **************************** */
+/* ========================================================================= */
+
+/* ============================ CONSTRUCTORS =============================== */
+
+// Create a new, empty priority queue.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+ppriority_queue<VAL_T, COMP_T, ROOT_T>::ppriority_queue(pool_t pop_in) {
+    PSTATS_OP(PSTATS_PPRIORITY_QUEUE, "construct");
+    ppool = pop_in;
+
+    ptx::run(ppool, [&] {
+        PSTATS_TX(PSTATS_PPRIORITY_QUEUE);
+        PSTATS_ALLOC(PSTATS_PPRIORITY_QUEUE, sizeof(pvector<VAL_T, ROOT_T>));
+
+        data = storage::template make<pvector<VAL_T, ROOT_T>>(ppool);
+    });
+}
+
+/* ============================== PUSH/POP ================================= */
+
+// Add the given item to the queue.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+void ppriority_queue<VAL_T, COMP_T, ROOT_T>::push(const VAL_T& val) {
+    PSTATS_OP(PSTATS_PPRIORITY_QUEUE, "push");
+
+    ptx::run(ppool, [&] {
+        PSTATS_TX(PSTATS_PPRIORITY_QUEUE);
+
+        grow(1);
+        data->push_back(val);
+        sift_up(data->get_length() - 1);
+    });
+}
+
+// Add every item in the given range to the queue in one transaction, restoring the heap
+// once for the whole batch. Only the subtrees above the new items are re-sifted, which
+// costs O(k + log n) for k items instead of O(k log n).
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+template <typename It>
+void ppriority_queue<VAL_T, COMP_T, ROOT_T>::push_many(It first, It last) {
+    PSTATS_OP(PSTATS_PPRIORITY_QUEUE, "push_many");
+
+    ptx::run(ppool, [&] {
+        PSTATS_TX(PSTATS_PPRIORITY_QUEUE);
+        int old_len = data->get_length();
+
+        for (; first != last; ++first) {
+            grow(1);
+            data->push_back(*first);
+        }
+
+        restore(old_len);
+    });
+}
+
+// Remove and return the item on top of the queue.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+VAL_T ppriority_queue<VAL_T, COMP_T, ROOT_T>::pop() {
+    PSTATS_OP(PSTATS_PPRIORITY_QUEUE, "pop");
+
+    if (is_empty())
+        throw std::out_of_range("Cannot pop an empty priority queue.");
+
+    std::optional<VAL_T> val;
+
+    ptx::run(ppool, [&] {
+        PSTATS_TX(PSTATS_PPRIORITY_QUEUE);
+
+        val.emplace((*data)[0]);
+        VAL_T back = data->pop_back();
+
+        // the last leaf fills the hole at the root, then sinks to its place
+        if (!is_empty()) {
+            set(0, back);
+            sift_down(0);
+        }
+    });
+
+    return std::move(*val);
+}
+
+// Replace the contents of the queue with the items in the given range. The heap is built
+// bottom-up in DRAM in O(n) and written out in one transaction into a vector sized for it.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+template <typename It>
+void ppriority_queue<VAL_T, COMP_T, ROOT_T>::heapify(It first, It last) {
+    PSTATS_OP(PSTATS_PPRIORITY_QUEUE, "heapify");
+
+    std::vector<VAL_T> items(first, last);
+    std::make_heap(items.begin(), items.end(), COMP_T());
+
+    ptx::run(ppool, [&] {
+        PSTATS_TX(PSTATS_PPRIORITY_QUEUE);
+
+        data->clear();
+        data->reserve((int)items.size());
+
+        for (const auto& item : items)
+            data->push_back(item);
+    });
+}
+
+/* =============================== GET/SET ================================= */
+
+// Get a read-only reference to the item on top of the queue.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+const VAL_T& ppriority_queue<VAL_T, COMP_T, ROOT_T>::top() const {
+    if (is_empty())
+        throw std::out_of_range("Cannot get the top of an empty priority queue.");
+
+    const auto& v = *data;
+    return v[0];
+}
+
+// Get the number of items in the queue.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+int ppriority_queue<VAL_T, COMP_T, ROOT_T>::get_length() const {
+    return data->get_length();
+}
+
+// Get whether or not the queue is empty.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+bool ppriority_queue<VAL_T, COMP_T, ROOT_T>::is_empty() const {
+    return get_length() == 0;
+}
+
+/* ================================ MISC. ================================== */
+
+// Log the slot at the given index in the open transaction, then overwrite it.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+void ppriority_queue<VAL_T, COMP_T, ROOT_T>::set(int idx, const VAL_T& val) {
+    PSTATS_SNAPSHOT(PSTATS_PPRIORITY_QUEUE, sizeof(VAL_T));
+
+    VAL_T& slot = (*data)[idx];
+    storage::snapshot(&slot);
+    slot = val;
+}
+
+// Move the item at the given index up until its parent does not order before it, shifting
+// the parents it passes down by one level.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+void ppriority_queue<VAL_T, COMP_T, ROOT_T>::sift_up(int idx) {
+    COMP_T comp;
+    const auto& v = *data;
+    VAL_T val = v[idx];
+    int hole = idx;
+
+    while (hole > 0) {
+        int parent = (hole - 1) / 2;
+        if (!comp(v[parent], val))
+            break;
+
+        set(hole, v[parent]);
+        hole = parent;
+    }
+
+    if (hole != idx)
+        set(hole, val);
+}
+
+// Move the item at the given index down until neither child orders after it, shifting the
+// children it passes up by one level.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+void ppriority_queue<VAL_T, COMP_T, ROOT_T>::sift_down(int idx) {
+    COMP_T comp;
+    const auto& v = *data;
+    int len = v.get_length();
+    VAL_T val = v[idx];
+    int hole = idx;
+
+    while (2 * hole + 1 < len) {
+        int child = 2 * hole + 1;
+        if (child + 1 < len && comp(v[child], v[child + 1]))
+            child++;
+        if (!comp(val, v[child]))
+            break;
+
+        set(hole, v[child]);
+        hole = child;
+    }
+
+    if (hole != idx)
+        set(hole, val);
+}
+
+// Restore the heap after items were appended from the given index on, by sifting down
+// every ancestor of a new item, deepest first. The ancestors at each step are a contiguous
+// range of indices that halves as it climbs.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+void ppriority_queue<VAL_T, COMP_T, ROOT_T>::restore(int first) {
+    int lo = first;
+    int hi = get_length() - 1;
+
+    if (lo > hi)
+        return;
+
+    while (hi > 0) {
+        lo = lo > 0 ? (lo - 1) / 2 : 0;
+        hi = (hi - 1) / 2;
+
+        for (int i = hi; i >= lo; i--)
+            sift_down(i);
+    }
+}
+
+// Make room for the given number of new items, doubling the capacity when full so pushes
+// do not reallocate the array each time.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+void ppriority_queue<VAL_T, COMP_T, ROOT_T>::grow(int n) {
+    int len = data->get_length();
+
+    if (len + n > data->get_capacity())
+        data->reserve(std::max(len + n, 2 * len));
+}
+
+// Run the given function as one transaction, so its pushes and pops commit together.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+template <typename F>
+void ppriority_queue<VAL_T, COMP_T, ROOT_T>::batch(F&& fn) {
+    PSTATS_OP(PSTATS_PPRIORITY_QUEUE, "batch");
+
+    ptx::run(ppool, [&] {
+        PSTATS_TX(PSTATS_PPRIORITY_QUEUE);
+        fn();
+    });
+}
+
+// Refresh the reference to the pool that this queue lives in. Must be called when using a
+// ppriority_queue from an existing file.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+void ppriority_queue<VAL_T, COMP_T, ROOT_T>::refresh_pool(pool_t new_pop) {
+    ppool = new_pop;
+    data->refresh_pool(new_pop);
+}
+
+// Remove every item from the queue.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+void ppriority_queue<VAL_T, COMP_T, ROOT_T>::clear() {
+    PSTATS_OP(PSTATS_PPRIORITY_QUEUE, "clear");
+
+    data->clear();
+}
+
+// Completely destroy this object and its allocated memory.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+void ppriority_queue<VAL_T, COMP_T, ROOT_T>::destroy() {
+    PSTATS_OP(PSTATS_PPRIORITY_QUEUE, "destroy");
+
+    ptx::run(ppool, [&] {
+        PSTATS_TX(PSTATS_PPRIORITY_QUEUE);
+        PSTATS_FREE(PSTATS_PPRIORITY_QUEUE, sizeof(ppriority_queue<VAL_T, COMP_T, ROOT_T>));
+
+        data->destroy();
+        storage::template destroy<ppriority_queue<VAL_T, COMP_T, ROOT_T>>(this);
+    });
+}
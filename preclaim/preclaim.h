@@ -0,0 +1,124 @@
+#ifndef _PRECLAIM_H
+#define _PRECLAIM_H
+
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/mutex.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include "../pstats/pstats.h"
+#include "../ptx/ptx.h"
+
+using namespace pmem;
+using namespace pmem::obj;
+
+// units of work (objects freed or slots looked at) per transaction of reclaim()
+#define PRECLAIM_STEP 256
+
+// Whether the items of type T root chains of nodes that must be freed along with an
+// array of them, and where. Containers that root a chain specialize this with value true,
+// a head_offset() giving the offset of the head pointer within an item, which is null for
+// an item with no chain, and a link_offset() giving the offset of the link to the next
+// node within a node.
+template <typename T>
+struct preclaim_chain : std::false_type {};
+
+// Memory detached from a container and waiting to be freed: a block (an object or
+// array), the chains of nodes hanging off the slots of the block, or both.
+struct preclaim_entry {
+    // the detached object or array, freed once the chains are
+    persistent_ptr<char> block;
+    // the slots of the block that may root a chain, and the next one to look at
+    p<int64_t> slots;
+    p<int64_t> cursor;
+    // bytes per slot, offset of the head within a slot, offset of the link within a node
+    p<uint32_t> stride;
+    p<uint32_t> head;
+    p<uint32_t> link;
+    // the next node of the chain being freed
+    persistent_ptr<char> chain;
+    persistent_ptr<preclaim_entry> next;
+};
+
+// A persistent list of memory waiting to be freed, for tearing down large containers
+// without one huge transaction. clear(preclaim&) and destroy(preclaim&) on plist, pvector
+// and phashtable detach everything a container holds in O(1) and defer it here, and
+// reclaim() then frees it in transactions of at most PRECLAIM_STEP objects. Keep the
+// preclaim reachable from the root: after a crash, what was deferred is still here, and
+// reclaiming simply resumes.
+//
+// Objects are freed without running their destructors, which none of the collections
+// rely on: nested collections are only ever released by their own destroy().
+//
+// Deferring and reclaiming lock the list until their transaction ends, so one thread
+// (e.g. a preclaim_worker) can reclaim while others defer.
+class preclaim {
+private:
+    persistent_ptr<preclaim_entry> head;
+    // entries waiting to be freed
+    p<int64_t> pending;
+    pmem::obj::mutex lock;
+    pool_base pop;
+
+    void push(persistent_ptr<char>, int64_t, uint32_t, uint32_t, uint32_t, persistent_ptr<char>);
+
+public:
+    // Constructors
+    explicit preclaim(pool_base);
+
+    // Push/Pop
+    template <typename T>
+    void defer(persistent_ptr<T>);
+    template <typename T>
+    void defer(persistent_ptr<T[]>, int);
+    template <typename T>
+    void defer_chain(persistent_ptr<T>, uint32_t);
+    int reclaim(int step = PRECLAIM_STEP);
+    void reclaim_all(int step = PRECLAIM_STEP);
+
+    // Get/Set
+    int64_t get_pending() const;
+    bool is_empty() const;
+
+    // Misc.
+    void refresh_pool(pool_base);
+    void destroy();
+};
+
+// Frees what is deferred to a preclaim on a background thread, a bounded step at a time,
+// sleeping whenever there is nothing left. Destroying the worker stops it between steps
+// and leaves the rest deferred.
+class preclaim_worker {
+private:
+    persistent_ptr<preclaim> target;
+    int step;
+    std::chrono::milliseconds idle;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::thread thread;
+    bool stopping;
+    std::exception_ptr failure;
+
+    void loop();
+
+public:
+    // Constructor/Destructor
+    preclaim_worker(persistent_ptr<preclaim>, int step = PRECLAIM_STEP,
+                    std::chrono::milliseconds idle = std::chrono::milliseconds(10));
+    ~preclaim_worker();
+
+    // Misc.
+    void notify();
+};
+
+#include "preclaim.hpp"
+
+#endif
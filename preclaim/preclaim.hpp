@@ -0,0 +1,238 @@
+#include "preclaim.h"
+
+/* ========================================================================= */
+/* ******************************* preclaim ******************************** */
+/* ========================================================================= */
+
+/* ============================ CONSTRUCTORS =============================== */
+
+// Create a new, empty reclamation list. Must be created inside a transaction, as with
+// make_persistent.
+inline preclaim::preclaim(pool_base pop_in) {
+    pop = pop_in;
+    head = nullptr;
+    pending = 0;
+}
+
+/* ============================== PUSH/POP ================================= */
+
+// Defer freeing the given object until it is reclaimed.
+template <typename T>
+void preclaim::defer(persistent_ptr<T> obj) {
+    PSTATS_OP(PSTATS_OTHER, "preclaim::defer");
+
+    if (obj == nullptr)
+        return;
+
+    push(persistent_ptr<char>(obj.raw()), 0, 0, 0, 0, nullptr);
+}
+
+// Defer freeing the given array of the given number of items until it is reclaimed, along
+// with the chains of nodes its items root, if T roots any (see preclaim_chain). The items
+// are not looked at here: reclaim() visits every slot and skips those with no chain.
+template <typename T>
+void preclaim::defer(persistent_ptr<T[]> arr, int len) {
+    PSTATS_OP(PSTATS_OTHER, "preclaim::defer");
+
+    if (arr == nullptr)
+        return;
+
+    if constexpr (preclaim_chain<T>::value)
+        push(persistent_ptr<char>(arr.raw()), len, sizeof(T), preclaim_chain<T>::head_offset(),
+             preclaim_chain<T>::link_offset(), nullptr);
+    else
+        push(persistent_ptr<char>(arr.raw()), 0, sizeof(T), 0, 0, nullptr);
+}
+
+// Defer freeing the chain of nodes starting at the given one until it is reclaimed. Each
+// node holds the pointer to the next at the given offset, and the last one holds null.
+template <typename T>
+void preclaim::defer_chain(persistent_ptr<T> first, uint32_t link) {
+    PSTATS_OP(PSTATS_OTHER, "preclaim::defer_chain");
+
+    if (first == nullptr)
+        return;
+
+    push(nullptr, 0, 0, 0, link, persistent_ptr<char>(first.raw()));
+}
+
+// Free up to the given number of deferred objects in one transaction, counting every
+// slot of a deferred array looked at as one more, and return the number of entries still
+// waiting. Called inside an open transaction, the work joins that transaction instead.
+inline int preclaim::reclaim(int step) {
+    PSTATS_OP(PSTATS_OTHER, "preclaim::reclaim");
+
+    int64_t left = 0;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_OTHER);
+        ptx::lock(lock);
+
+        for (int work = 0; work < step && head != nullptr; work++) {
+            preclaim_entry& e = *head;
+
+            // free the next node of the current chain
+            if (e.chain != nullptr) {
+                persistent_ptr<char> node = e.chain;
+                e.chain = *(persistent_ptr<char>*)(node.get() + e.link);
+                delete_persistent<char>(node);
+            }
+            // or start on the chain of the next slot, if any
+            else if (e.cursor < e.slots) {
+                e.chain = *(persistent_ptr<char>*)(e.block.get() + e.cursor * e.stride + e.head);
+                e.cursor++;
+            }
+            // or, with every chain gone, free the block and the entry
+            else {
+                auto done = head;
+                head = e.next;
+                pending--;
+
+                if (done->block != nullptr)
+                    delete_persistent<char>(done->block);
+                delete_persistent<preclaim_entry>(done);
+            }
+        }
+
+        left = pending;
+    });
+
+    return (int)left;
+}
+
+// Free everything deferred, one step per transaction. Called inside an open transaction,
+// it all joins that transaction instead, so call it outside of one.
+inline void preclaim::reclaim_all(int step) {
+    PSTATS_OP(PSTATS_OTHER, "preclaim::reclaim_all");
+
+    while (reclaim(step) > 0) {
+    }
+}
+
+/* =============================== GET/SET ================================= */
+
+// Get the number of entries (detached objects, arrays and chains) still waiting. This
+// reads without the lock, so while other threads defer or reclaim, use the count that
+// reclaim() returns instead.
+inline int64_t preclaim::get_pending() const {
+    return pending;
+}
+
+// Get whether nothing is waiting to be freed.
+inline bool preclaim::is_empty() const {
+    return pending == 0;
+}
+
+/* ================================ MISC. ================================== */
+
+// Add an entry with the given block, slots, stride, head and link offsets and chain to the
+// front of the list.
+inline void preclaim::push(persistent_ptr<char> block, int64_t slots, uint32_t stride,
+                           uint32_t head_off, uint32_t link, persistent_ptr<char> chain) {
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_OTHER);
+        ptx::lock(lock);
+
+        auto e = make_persistent<preclaim_entry>();
+        e->block = block;
+        e->slots = slots;
+        e->cursor = 0;
+        e->stride = stride;
+        e->head = head_off;
+        e->link = link;
+        e->chain = chain;
+        e->next = head;
+
+        head = e;
+        pending++;
+    });
+}
+
+// Refresh the reference to the pool that this list lives in. Must be called when using a
+// preclaim from an existing file, before reclaiming.
+inline void preclaim::refresh_pool(pool_base new_pop) {
+    pop = new_pop;
+}
+
+// Free everything deferred, then this object.
+inline void preclaim::destroy() {
+    PSTATS_OP(PSTATS_OTHER, "preclaim::destroy");
+
+    reclaim_all();
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_OTHER);
+        delete_persistent<preclaim>(this);
+    });
+}
+
+/* ========================================================================= */
+/* **************************** preclaim_worker **************************** */
+/* ========================================================================= */
+
+/* ======================== CONSTRUCTORS/DESTRUCTOR ======================== */
+
+// Start reclaiming from the given list on a background thread, the given number of
+// objects per transaction, checking back every idle period once it is empty.
+inline preclaim_worker::preclaim_worker(persistent_ptr<preclaim> target_in, int step_in,
+                                        std::chrono::milliseconds idle_in) {
+    target = target_in;
+    step = step_in > 0 ? step_in : 1;
+    idle = idle_in;
+    stopping = false;
+
+    thread = std::thread([this] { loop(); });
+}
+
+// Stop the background thread after its current step.
+inline preclaim_worker::~preclaim_worker() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    if (thread.joinable())
+        thread.join();
+}
+
+/* ================================ MISC. ================================== */
+
+// Wake the worker up, e.g. right after deferring a large container, and rethrow the failure
+// of an earlier step, if there was one.
+inline void preclaim_worker::notify() {
+    std::exception_ptr err;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        err = failure;
+        failure = nullptr;
+    }
+    wake.notify_all();
+
+    if (err)
+        std::rethrow_exception(err);
+}
+
+// Reclaim a step at a time until told to stop, waiting whenever nothing is left.
+inline void preclaim_worker::loop() {
+    std::unique_lock<std::mutex> guard(lock);
+
+    while (!stopping) {
+        guard.unlock();
+        int left = 0;
+
+        try {
+            left = target->reclaim(step);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> fail_guard(lock);
+            failure = std::current_exception();
+        }
+
+        guard.lock();
+
+        if (left == 0 && !stopping)
+            wake.wait_for(guard, idle);
+    }
+}
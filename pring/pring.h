@@ -0,0 +1,87 @@
+#ifndef _PRING_H
+#define _PRING_H
+
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/mutex.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/transaction.hpp>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include "../pstats/pstats.h"
+#include "../ptx/ptx.h"
+
+using namespace pmem;
+using namespace pmem::obj;
+
+// Fixed-capacity FIFO queue stored as a persistent array of slots with a persisted head
+// (items dequeued so far) and tail (items enqueued so far). Neither operation allocates or
+// opens a transaction: enqueue writes its slots and makes them durable, then stores and
+// persists the 8-byte tail, and dequeue reads its slots, then stores and persists the
+// 8-byte head. An 8-byte store is atomic on pmem, so a crash leaves every item either
+// fully queued or not queued at all.
+//
+// In the default single-producer/single-consumer mode, one thread may enqueue while
+// another dequeues, without locks. Each side only publishes its index to the other side
+// once it is durable, so a consumer never sees an item whose enqueue could still be lost,
+// and a producer never reuses a slot whose dequeue could still be lost. In MPMC mode,
+// producers serialize on one lock and consumers on another, so producers never wait on
+// consumers. Batched calls move up to N items with a single fence for their slots and one
+// for the index, however large N is.
+//
+// Slots are copied bytewise, so VAL_T must be trivially copyable. The queue is not
+// transactional: do not call it inside a transaction. refresh_pool() must be called after
+// reopening a pool, before the queue is used.
+template <typename VAL_T, typename ROOT_T>
+class pring {
+private:
+    static_assert(std::is_trivially_copyable<VAL_T>::value, "pring values must be trivially copyable");
+
+    persistent_ptr<VAL_T[]> slots;
+    p<int> cap;
+    p<bool> mpmc;
+    pool<ROOT_T> pop;
+
+    // the consumer's side, kept well away from the producer's so the two threads do not
+    // share a cache line. The shared copy is the one the producer reads; it only moves once
+    // head is durable and is rebuilt from it by refresh_pool()
+    p<uint64_t> head;
+    uint64_t head_shared;
+    pmem::obj::mutex head_lock;
+
+    // the producer's side, likewise
+    p<uint64_t> tail;
+    uint64_t tail_shared;
+    pmem::obj::mutex tail_lock;
+
+    void write_slots(uint64_t, const VAL_T*, int);
+    void read_slots(uint64_t, VAL_T*, int) const;
+
+public:
+    // Constructor
+    pring(pool<ROOT_T>, int, bool mpmc = false);
+
+    // Push/Pop
+    bool enqueue(const VAL_T&);
+    int enqueue(const VAL_T*, int);
+    bool dequeue(VAL_T&);
+    int dequeue(VAL_T*, int);
+
+    // Get/Set
+    int get_length() const;
+    int get_capacity() const;
+    bool is_empty() const;
+    bool is_full() const;
+    bool is_mpmc() const;
+
+    // Misc.
+    void refresh_pool(pool<ROOT_T>);
+    void clear();
+    void destroy();
+};
+
+#include "pring.hpp"
+
+#endif
@@ -0,0 +1,217 @@
+#include "pring.h"
+
+/* ========================================================================= */
+/* ******************************** pring ********************************** */
+/* ========================================================================= */
+
+/* ============================ CONSTRUCTORS =============================== */
+
+// Create a new, empty ring with the given number of slots, shared by many producers and
+// consumers if mpmc is set.
+template <typename VAL_T, typename ROOT_T>
+pring<VAL_T, ROOT_T>::pring(pool<ROOT_T> pop_in, int capacity, bool mpmc_in) {
+    PSTATS_OP(PSTATS_PRING, "construct");
+    pop = pop_in;
+
+    if (capacity < 1)
+        throw std::out_of_range("Cannot create a ring with no slots.");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PRING);
+        PSTATS_ALLOC(PSTATS_PRING, sizeof(VAL_T) * capacity);
+        slots = make_persistent<VAL_T[]>(capacity);
+        cap = capacity;
+        mpmc = mpmc_in;
+        head = 0;
+        tail = 0;
+    });
+
+    head_shared = 0;
+    tail_shared = 0;
+}
+
+/* ============================== PUSH/POP ================================= */
+
+// Add the given item to the back of the ring, returning false if the ring is full.
+template <typename VAL_T, typename ROOT_T>
+bool pring<VAL_T, ROOT_T>::enqueue(const VAL_T& val) {
+    return enqueue(&val, 1) == 1;
+}
+
+// Add up to n of the given items to the back of the ring, in order, returning how many
+// fit. The slots are made durable with one fence and the tail with another.
+template <typename VAL_T, typename ROOT_T>
+int pring<VAL_T, ROOT_T>::enqueue(const VAL_T* vals, int n) {
+    PSTATS_OP(PSTATS_PRING, "enqueue");
+
+    std::unique_lock<pmem::obj::mutex> guard(tail_lock, std::defer_lock);
+    if (mpmc)
+        guard.lock();
+
+    uint64_t t = tail;
+    uint64_t h = __atomic_load_n(&head_shared, __ATOMIC_ACQUIRE);
+    int room = cap - (int)(t - h);
+
+    if (n > room)
+        n = room;
+    if (n <= 0)
+        return 0;
+
+    // the items must be durable before the tail that covers them
+    write_slots(t, vals, n);
+    pop.drain();
+
+    tail.get_rw() = t + n;
+    pop.persist(tail);
+
+    __atomic_store_n(&tail_shared, t + n, __ATOMIC_RELEASE);
+
+    return n;
+}
+
+// Remove the item at the front of the ring into the given reference, returning false if
+// the ring is empty.
+template <typename VAL_T, typename ROOT_T>
+bool pring<VAL_T, ROOT_T>::dequeue(VAL_T& out) {
+    return dequeue(&out, 1) == 1;
+}
+
+// Remove up to n items from the front of the ring into the given array, in order,
+// returning how many there were. Only the head is persisted.
+template <typename VAL_T, typename ROOT_T>
+int pring<VAL_T, ROOT_T>::dequeue(VAL_T* out, int n) {
+    PSTATS_OP(PSTATS_PRING, "dequeue");
+
+    std::unique_lock<pmem::obj::mutex> guard(head_lock, std::defer_lock);
+    if (mpmc)
+        guard.lock();
+
+    uint64_t h = head;
+    uint64_t t = __atomic_load_n(&tail_shared, __ATOMIC_ACQUIRE);
+    int avail = (int)(t - h);
+
+    if (n > avail)
+        n = avail;
+    if (n <= 0)
+        return 0;
+
+    read_slots(h, out, n);
+
+    head.get_rw() = h + n;
+    pop.persist(head);
+
+    // only now may the producer reuse the slots
+    __atomic_store_n(&head_shared, h + n, __ATOMIC_RELEASE);
+
+    return n;
+}
+
+/* =============================== GET/SET ================================= */
+
+// Get the number of items in the ring. With other threads using the ring, this is only a
+// snapshot.
+template <typename VAL_T, typename ROOT_T>
+int pring<VAL_T, ROOT_T>::get_length() const {
+    uint64_t h = __atomic_load_n(&head_shared, __ATOMIC_ACQUIRE);
+    uint64_t t = __atomic_load_n(&tail_shared, __ATOMIC_ACQUIRE);
+
+    return t > h ? (int)(t - h) : 0;
+}
+
+// Get the number of slots in the ring.
+template <typename VAL_T, typename ROOT_T>
+int pring<VAL_T, ROOT_T>::get_capacity() const {
+    return cap;
+}
+
+// Get whether or not the ring is empty.
+template <typename VAL_T, typename ROOT_T>
+bool pring<VAL_T, ROOT_T>::is_empty() const {
+    return get_length() == 0;
+}
+
+// Get whether or not every slot of the ring is taken.
+template <typename VAL_T, typename ROOT_T>
+bool pring<VAL_T, ROOT_T>::is_full() const {
+    return get_length() == cap;
+}
+
+// Get whether the ring allows many producers and consumers.
+template <typename VAL_T, typename ROOT_T>
+bool pring<VAL_T, ROOT_T>::is_mpmc() const {
+    return mpmc;
+}
+
+/* ================================ MISC. ================================== */
+
+// Copy n items into the slots starting at the given position, wrapping around the end of
+// the array, and flush them without waiting.
+template <typename VAL_T, typename ROOT_T>
+void pring<VAL_T, ROOT_T>::write_slots(uint64_t pos, const VAL_T* vals, int n) {
+    int at = (int)(pos % cap);
+    int first = n < cap - at ? n : cap - at;
+
+    memcpy(&slots[at], vals, sizeof(VAL_T) * first);
+    pop.flush(&slots[at], sizeof(VAL_T) * first);
+
+    if (n > first) {
+        memcpy(&slots[0], vals + first, sizeof(VAL_T) * (n - first));
+        pop.flush(&slots[0], sizeof(VAL_T) * (n - first));
+    }
+}
+
+// Copy n items out of the slots starting at the given position, wrapping around the end
+// of the array.
+template <typename VAL_T, typename ROOT_T>
+void pring<VAL_T, ROOT_T>::read_slots(uint64_t pos, VAL_T* out, int n) const {
+    int at = (int)(pos % cap);
+    int first = n < cap - at ? n : cap - at;
+
+    memcpy(out, &slots[at], sizeof(VAL_T) * first);
+
+    if (n > first)
+        memcpy(out + first, &slots[0], sizeof(VAL_T) * (n - first));
+}
+
+// Refresh the reference to the pool that this ring lives in, and rebuild the shared
+// indices from the persisted ones. Must be called when using a pring from an existing
+// file, before any thread uses it.
+template <typename VAL_T, typename ROOT_T>
+void pring<VAL_T, ROOT_T>::refresh_pool(pool<ROOT_T> new_pop) {
+    pop = new_pop;
+
+    head_shared = head;
+    tail_shared = tail;
+}
+
+// Drop every item in the ring. This is a dequeue, so it may only run on the consumer side.
+template <typename VAL_T, typename ROOT_T>
+void pring<VAL_T, ROOT_T>::clear() {
+    PSTATS_OP(PSTATS_PRING, "clear");
+
+    std::unique_lock<pmem::obj::mutex> guard(head_lock, std::defer_lock);
+    if (mpmc)
+        guard.lock();
+
+    uint64_t t = __atomic_load_n(&tail_shared, __ATOMIC_ACQUIRE);
+
+    head.get_rw() = t;
+    pop.persist(head);
+
+    __atomic_store_n(&head_shared, t, __ATOMIC_RELEASE);
+}
+
+// Completely destroy this object and its allocated memory. No other thread may be using
+// the ring.
+template <typename VAL_T, typename ROOT_T>
+void pring<VAL_T, ROOT_T>::destroy() {
+    PSTATS_OP(PSTATS_PRING, "destroy");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PRING);
+        PSTATS_FREE(PSTATS_PRING, sizeof(VAL_T) * cap + sizeof(pring<VAL_T, ROOT_T>));
+
+        delete_persistent<VAL_T[]>(slots, cap);
+        delete_persistent<pring<VAL_T, ROOT_T>>(this);
+    });
+}
@@ -0,0 +1,88 @@
+#ifndef _PSHARDED_H
+#define _PSHARDED_H
+
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../phashtable/phashtable.h"
+
+using namespace pmem;
+using namespace pmem::obj;
+
+#define PSHARDED_LAYOUT "PSHARDED"
+// the size each shard's pool file is created with
+#define PSHARDED_POOL_SIZE ((size_t)(1024 * 1024 * 256)) // 256 MB
+
+// The root object of one shard's pool file.
+template <typename KEY_T, typename VAL_T>
+class pshard_root {
+public:
+    persistent_ptr<phashtable<KEY_T, VAL_T, pshard_root<KEY_T, VAL_T>>> table;
+    // which shard this file holds, and how many shards the table was made with
+    p<int> shard;
+    p<int> shards;
+};
+
+// Hash table partitioned by key hash across N pool files, each holding its own phashtable
+// under its own root. Each shard has its own allocator, transaction lanes and lock, so
+// writers on different shards never contend, and the shards can live on different devices.
+// Shard i of a table at path P is the file "P.i". Opening creates any shard file that does
+// not exist yet and recovers the rest, all shards in parallel. Every operation locks only
+// the shard it touches, so the table may be shared between threads.
+//
+// The object itself lives in DRAM: it owns the open pools, and closes them when destroyed.
+template <typename KEY_T, typename VAL_T>
+class psharded {
+private:
+    typedef pshard_root<KEY_T, VAL_T> root_t;
+    typedef phashtable<KEY_T, VAL_T, root_t> table_t;
+
+    std::vector<pool<root_t>> pools;
+    std::vector<persistent_ptr<table_t>> tables;
+    std::unique_ptr<std::mutex[]> locks;
+    std::hash<KEY_T> hasher;
+
+    void open_shard(const std::string&, int, size_t);
+    int shard_of(const KEY_T&) const;
+
+public:
+    // Constructor
+    psharded(const std::string&, int, size_t pool_size = PSHARDED_POOL_SIZE);
+    psharded(const psharded<KEY_T, VAL_T>&) = delete;
+    psharded<KEY_T, VAL_T>& operator=(const psharded<KEY_T, VAL_T>&) = delete;
+    ~psharded();
+
+    // Push/Pop
+    void insert(const KEY_T&, const VAL_T&);
+    VAL_T remove(const KEY_T&);
+
+    // Get/Set
+    VAL_T get(const KEY_T&) const;
+    bool contains(const KEY_T&) const;
+    int get_length() const;
+    int get_shards() const;
+    bool is_empty() const;
+
+    // Misc.
+    template <typename F>
+    void for_each(F&&) const;
+    template <typename F>
+    void for_each_shard(int, F&&) const;
+    void clear();
+    void close();
+};
+
+#include "psharded.hpp"
+
+#endif
@@ -0,0 +1,222 @@
+#include "psharded.h"
+
+/* ========================================================================= */
+/* ******************************* psharded ******************************** */
+/* ========================================================================= */
+
+/* ============================ CONSTRUCTORS =============================== */
+
+// Open the table with the given number of shards at the given path, creating shard files
+// of the given size where they do not exist yet. Every shard is opened (and, after a crash,
+// recovered) on its own thread.
+template <typename KEY_T, typename VAL_T>
+psharded<KEY_T, VAL_T>::psharded(const std::string& path, int shards, size_t pool_size) {
+    if (shards < 1)
+        throw std::out_of_range("A sharded table needs at least one shard.");
+
+    pools.resize(shards);
+    tables.resize(shards);
+    locks.reset(new std::mutex[shards]);
+
+    std::vector<std::exception_ptr> errors(shards);
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < shards; i++) {
+        threads.emplace_back([&, i] {
+            try {
+                open_shard(path, i, pool_size);
+            }
+            catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+
+    for (auto& t : threads)
+        t.join();
+
+    // if any shard failed, give back the ones that did open before reporting it
+    for (int i = 0; i < shards; i++) {
+        if (errors[i] != nullptr) {
+            close();
+            std::rethrow_exception(errors[i]);
+        }
+    }
+}
+
+// Close every shard.
+template <typename KEY_T, typename VAL_T>
+psharded<KEY_T, VAL_T>::~psharded() {
+    try {
+        close();
+    }
+    catch (...) {
+    }
+}
+
+/* ============================== PUSH/POP ================================= */
+
+// Insert the given key with the given value into its shard, replacing the value if the key
+// is already present.
+template <typename KEY_T, typename VAL_T>
+void psharded<KEY_T, VAL_T>::insert(const KEY_T& key, const VAL_T& val) {
+    int s = shard_of(key);
+    std::lock_guard<std::mutex> guard(locks[s]);
+
+    tables[s]->insert(key, val);
+}
+
+// Remove the pair with the given key from its shard, returning its value.
+template <typename KEY_T, typename VAL_T>
+VAL_T psharded<KEY_T, VAL_T>::remove(const KEY_T& key) {
+    int s = shard_of(key);
+    std::lock_guard<std::mutex> guard(locks[s]);
+
+    return tables[s]->remove(key);
+}
+
+/* =============================== GET/SET ================================= */
+
+// Get the value stored for the given key.
+template <typename KEY_T, typename VAL_T>
+VAL_T psharded<KEY_T, VAL_T>::get(const KEY_T& key) const {
+    int s = shard_of(key);
+    std::lock_guard<std::mutex> guard(locks[s]);
+
+    return tables[s]->get(key);
+}
+
+// Get whether the given key is in the table.
+template <typename KEY_T, typename VAL_T>
+bool psharded<KEY_T, VAL_T>::contains(const KEY_T& key) const {
+    int s = shard_of(key);
+    std::lock_guard<std::mutex> guard(locks[s]);
+
+    return tables[s]->contains(key);
+}
+
+// Get the number of pairs across all shards. With other threads writing, each shard is
+// counted at a different moment.
+template <typename KEY_T, typename VAL_T>
+int psharded<KEY_T, VAL_T>::get_length() const {
+    int total = 0;
+
+    for (int i = 0; i < get_shards(); i++) {
+        std::lock_guard<std::mutex> guard(locks[i]);
+        total += tables[i]->get_length();
+    }
+
+    return total;
+}
+
+// Get the number of shards.
+template <typename KEY_T, typename VAL_T>
+int psharded<KEY_T, VAL_T>::get_shards() const {
+    return tables.size();
+}
+
+// Get whether or not every shard is empty.
+template <typename KEY_T, typename VAL_T>
+bool psharded<KEY_T, VAL_T>::is_empty() const {
+    return get_length() == 0;
+}
+
+/* ================================ MISC. ================================== */
+
+// Call the given function with the key and value of every pair, shard by shard. Each shard
+// is locked while it is walked.
+template <typename KEY_T, typename VAL_T>
+template <typename F>
+void psharded<KEY_T, VAL_T>::for_each(F&& fn) const {
+    for (int i = 0; i < get_shards(); i++)
+        for_each_shard(i, fn);
+}
+
+// Call the given function with the key and value of every pair in the given shard, e.g. to
+// walk the shards from a thread each.
+template <typename KEY_T, typename VAL_T>
+template <typename F>
+void psharded<KEY_T, VAL_T>::for_each_shard(int shard, F&& fn) const {
+    if (shard < 0 || shard >= get_shards())
+        throw std::out_of_range("Cannot access a shard past the number of shards.");
+
+    std::lock_guard<std::mutex> guard(locks[shard]);
+    tables[shard]->for_each(fn);
+}
+
+// Remove every pair from every shard.
+template <typename KEY_T, typename VAL_T>
+void psharded<KEY_T, VAL_T>::clear() {
+    for (int i = 0; i < get_shards(); i++) {
+        std::lock_guard<std::mutex> guard(locks[i]);
+        tables[i]->clear();
+    }
+}
+
+// Close every open shard. The table cannot be used afterwards.
+template <typename KEY_T, typename VAL_T>
+void psharded<KEY_T, VAL_T>::close() {
+    for (size_t i = 0; i < tables.size(); i++) {
+        if (tables[i] != nullptr)
+            pools[i].close();
+    }
+
+    pools.clear();
+    tables.clear();
+}
+
+// Create or open shard i of the table at the given path, checking that an existing file
+// belongs to a table with the same number of shards. A file whose root was never set up,
+// because its creator crashed right after creating it, is set up now.
+template <typename KEY_T, typename VAL_T>
+void psharded<KEY_T, VAL_T>::open_shard(const std::string& path, int i, size_t pool_size) {
+    std::string file = path + "." + std::to_string(i);
+    int shards = tables.size();
+    pool<root_t> pop;
+
+    if (access(file.c_str(), F_OK) != 0)
+        pop = pool<root_t>::create(file, PSHARDED_LAYOUT, pool_size, S_IRWXU);
+    else
+        pop = pool<root_t>::open(file, PSHARDED_LAYOUT);
+
+    try {
+        auto proot = pop.root();
+        table_t::register_classes(pop);
+
+        // the root is only ever set up whole, so a missing table means it is still zeroed
+        if (proot->table == nullptr) {
+            flat_transaction::run(pop, [&] {
+                proot->table = make_persistent<table_t>(pop);
+                proot->shard = i;
+                proot->shards = shards;
+            });
+        }
+        else if (proot->shard != i || proot->shards != shards) {
+            throw std::runtime_error(file + " is not shard " + std::to_string(i) + " of a table with " +
+                                     std::to_string(shards) + " shards.");
+        }
+        else {
+            proot->table->refresh_pool(pop);
+        }
+    }
+    catch (...) {
+        pop.close();
+        throw;
+    }
+
+    pools[i] = pop;
+    tables[i] = pop.root()->table;
+}
+
+// Get the shard the given key lives in. The hash is mixed first, since each shard's table
+// takes the same hash modulo its bucket count, and std::hash is the identity for integers.
+template <typename KEY_T, typename VAL_T>
+int psharded<KEY_T, VAL_T>::shard_of(const KEY_T& key) const {
+    uint64_t h = hasher(key);
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+
+    return h % tables.size();
+}
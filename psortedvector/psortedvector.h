@@ -0,0 +1,82 @@
+#ifndef _PSORTEDVECTOR_H
+#define _PSORTEDVECTOR_H
+
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/transaction.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "../pvector/pvector.h"
+#include "../pstats/pstats.h"
+#include "../pstorage/pstorage.h"
+#include "../ptx/ptx.h"
+#include "../ptraits/ptraits.h"
+
+using namespace pmem;
+using namespace pmem::obj;
+
+// A pvector kept in the order given by COMP_T, smallest first with std::less<VAL_T>.
+// Equal items are allowed and keep the order they were inserted in. COMP_T is
+// default-constructed for every use, so it must not carry state, and VAL_T should be a
+// plain value, as items are move assigned from slot to slot.
+//
+// Lookups are branchless binary searches over the array. insert_sorted_batch merges any
+// number of new items in with one backward pass over the array, moving each existing
+// item at most once instead of once per item inserted before it.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+class psortedvector {
+public:
+    // where this container lives, picked by ROOT_T (see pstorage)
+    typedef pstorage<ROOT_T> storage;
+    template <typename T>
+    using ptr_t = typename storage::template ptr<T>;
+    typedef typename storage::pool_type pool_t;
+
+private:
+    ptr_t<pvector<VAL_T, ROOT_T>> data;
+    pool_t pop;
+
+    template <typename PRED>
+    int search(int, PRED) const;
+    void grow(int);
+
+public:
+    // Constructors
+    psortedvector(pool_t);
+
+    // Operator Overloads
+    const VAL_T& operator[](int) const;
+
+    // Push/Pop
+    int insert(const VAL_T&);
+    template <typename It>
+    void insert_sorted_batch(It, It);
+    VAL_T remove(int);
+    bool erase(const VAL_T&);
+
+    // Get/Set
+    int get_length() const;
+    bool is_empty() const;
+
+    // Queries
+    int lower_bound(const VAL_T&) const;
+    int upper_bound(const VAL_T&) const;
+    bool contains(const VAL_T&) const;
+
+    // Misc.
+    template <typename F>
+    void batch(F&&);
+    void refresh_pool(pool_t);
+    void clear();
+    void destroy();
+};
+
+// a psortedvector is just a pool offset and a pool handle, so it can be moved bytewise
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+struct is_prelocatable<psortedvector<VAL_T, COMP_T, ROOT_T>> : std::true_type {};
+
+#include "psortedvector.hpp"
+
+#endif
@@ -0,0 +1,238 @@
+#include "psortedvector.h"
+
+/* ========================================================================= */
+/* ***************************** psortedvector ***************************** */
+/* ========================================================================= */
+
+/* ============================ CONSTRUCTORS =============================== */
+
+// Create a new, empty sorted vector.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+psortedvector<VAL_T, COMP_T, ROOT_T>::psortedvector(pool_t pop_in) {
+    PSTATS_OP(PSTATS_PSORTEDVECTOR, "construct");
+    pop = pop_in;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSORTEDVECTOR);
+        PSTATS_ALLOC(PSTATS_PSORTEDVECTOR, sizeof(pvector<VAL_T, ROOT_T>));
+
+        data = storage::template make<pvector<VAL_T, ROOT_T>>(pop);
+    });
+}
+
+/* ========================== OPERATOR OVERLOADS =========================== */
+
+// Get a read-only reference to the item at the given index. Items cannot be written in
+// place, as that could break the order.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+const VAL_T& psortedvector<VAL_T, COMP_T, ROOT_T>::operator[](int idx) const {
+    const auto& v = *data;
+    return v[idx];
+}
+
+/* ============================== PUSH/POP ================================= */
+
+// Insert the given item after any items equal to it, and return the index it landed at.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+int psortedvector<VAL_T, COMP_T, ROOT_T>::insert(const VAL_T& val) {
+    PSTATS_OP(PSTATS_PSORTEDVECTOR, "insert");
+
+    int idx = upper_bound(val);
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSORTEDVECTOR);
+
+        grow(1);
+        data->insert(val, idx);
+    });
+
+    return idx;
+}
+
+// Insert every item in the given range in one transaction. The items are sorted in DRAM,
+// appended to make room, and then merged in from the back: the largest remaining item of
+// either side is moved to the last free slot, until the new items run out. Only the slots
+// from where the smallest new item lands to the end are logged and written, and each
+// existing item moves once, so k items cost O(k log k + n) rather than O(k n).
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+template <typename It>
+void psortedvector<VAL_T, COMP_T, ROOT_T>::insert_sorted_batch(It first, It last) {
+    PSTATS_OP(PSTATS_PSORTEDVECTOR, "insert_sorted_batch");
+
+    COMP_T comp;
+    std::vector<VAL_T> items(first, last);
+    std::stable_sort(items.begin(), items.end(), comp);
+
+    int k = (int)items.size();
+    if (k == 0)
+        return;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSORTEDVECTOR);
+        int old_len = data->get_length();
+
+        // the new tail slots are logged as they are pushed, so only the moved ones are left
+        grow(k);
+        for (const auto& item : items)
+            data->push_back(item);
+
+        int lo = search(old_len, [&](const VAL_T& x) { return !comp(items[0], x); });
+
+        PSTATS_SNAPSHOT(PSTATS_PSORTEDVECTOR, sizeof(VAL_T) * (old_len - lo));
+        auto& v = *data;
+        if (lo < old_len)
+            storage::snapshot(&v[lo], old_len - lo);
+
+        // new items go after equal old ones, so an old item only moves past a smaller one
+        int i = old_len - 1;
+        int j = k - 1;
+        int dst = old_len + k - 1;
+
+        while (j >= 0) {
+            if (i >= lo && comp(items[j], v[i]))
+                v[dst--] = std::move(v[i--]);
+            else
+                v[dst--] = std::move(items[j--]);
+        }
+    });
+}
+
+// Remove the item at the given index and return it.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+VAL_T psortedvector<VAL_T, COMP_T, ROOT_T>::remove(int idx) {
+    PSTATS_OP(PSTATS_PSORTEDVECTOR, "remove");
+
+    return data->remove(idx);
+}
+
+// Remove the first item equal to the given one, returning whether there was one.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+bool psortedvector<VAL_T, COMP_T, ROOT_T>::erase(const VAL_T& val) {
+    PSTATS_OP(PSTATS_PSORTEDVECTOR, "erase");
+
+    int idx = lower_bound(val);
+    if (idx == get_length() || COMP_T()(val, (*this)[idx]))
+        return false;
+
+    data->remove(idx);
+    return true;
+}
+
+/* =============================== GET/SET ================================= */
+
+// Get the number of items in the vector.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+int psortedvector<VAL_T, COMP_T, ROOT_T>::get_length() const {
+    return data->get_length();
+}
+
+// Get whether or not the vector is empty.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+bool psortedvector<VAL_T, COMP_T, ROOT_T>::is_empty() const {
+    return get_length() == 0;
+}
+
+/* ================================ QUERIES ================================ */
+
+// Get the index of the first item that does not order before the given one, or the length
+// if there is none.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+int psortedvector<VAL_T, COMP_T, ROOT_T>::lower_bound(const VAL_T& val) const {
+    COMP_T comp;
+    return search(get_length(), [&](const VAL_T& x) { return comp(x, val); });
+}
+
+// Get the index of the first item that orders after the given one, or the length if there
+// is none.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+int psortedvector<VAL_T, COMP_T, ROOT_T>::upper_bound(const VAL_T& val) const {
+    COMP_T comp;
+    return search(get_length(), [&](const VAL_T& x) { return !comp(val, x); });
+}
+
+// Get whether or not an item equal to the given one is in the vector.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+bool psortedvector<VAL_T, COMP_T, ROOT_T>::contains(const VAL_T& val) const {
+    int idx = lower_bound(val);
+    return idx < get_length() && !COMP_T()(val, (*this)[idx]);
+}
+
+/* ================================ MISC. ================================== */
+
+// Get the number of items at the front of the first n that the given predicate holds
+// for, where it holds for a prefix of them. Each step halves the range with a conditional
+// move rather than a branch, so the loop never mispredicts, and the two items the next
+// step could probe are prefetched while this one compares.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+template <typename PRED>
+int psortedvector<VAL_T, COMP_T, ROOT_T>::search(int n, PRED pred) const {
+    if (n == 0)
+        return 0;
+
+    const auto& v = *data;
+    const VAL_T* first = &v[0];
+    const VAL_T* base = first;
+
+    while (n > 1) {
+        int half = n / 2;
+        __builtin_prefetch(base + half / 2);
+        __builtin_prefetch(base + half + half / 2);
+
+        base = pred(base[half]) ? base + half : base;
+        n -= half;
+    }
+
+    return (int)(base - first) + (pred(*base) ? 1 : 0);
+}
+
+// Make room for the given number of new items, doubling the capacity when full so inserts
+// do not reallocate the array each time.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+void psortedvector<VAL_T, COMP_T, ROOT_T>::grow(int n) {
+    int len = data->get_length();
+
+    if (len + n > data->get_capacity())
+        data->reserve(std::max(len + n, 2 * len));
+}
+
+// Run the given function as one transaction, so the items inserted inside it commit together.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+template <typename F>
+void psortedvector<VAL_T, COMP_T, ROOT_T>::batch(F&& fn) {
+    PSTATS_OP(PSTATS_PSORTEDVECTOR, "batch");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSORTEDVECTOR);
+        fn();
+    });
+}
+
+// Refresh the reference to the pool that this vector lives in. Must be called when using a
+// psortedvector from an existing file.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+void psortedvector<VAL_T, COMP_T, ROOT_T>::refresh_pool(pool_t new_pop) {
+    pop = new_pop;
+    data->refresh_pool(new_pop);
+}
+
+// Remove every item from the vector.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+void psortedvector<VAL_T, COMP_T, ROOT_T>::clear() {
+    PSTATS_OP(PSTATS_PSORTEDVECTOR, "clear");
+
+    data->clear();
+}
+
+// Completely destroy this object and its allocated memory.
+template <typename VAL_T, typename COMP_T, typename ROOT_T>
+void psortedvector<VAL_T, COMP_T, ROOT_T>::destroy() {
+    PSTATS_OP(PSTATS_PSORTEDVECTOR, "destroy");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSORTEDVECTOR);
+        PSTATS_FREE(PSTATS_PSORTEDVECTOR, sizeof(psortedvector<VAL_T, COMP_T, ROOT_T>));
+
+        data->destroy();
+        storage::template destroy<psortedvector<VAL_T, COMP_T, ROOT_T>>(this);
+    });
+}
@@ -0,0 +1,148 @@
+#ifndef _PSTATS_H
+#define _PSTATS_H
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+
+// Opt-in counters for the collections. Build with -DPCOLLECTIONS_STATS (or `make STATS=1`)
+// to turn them on; otherwise every PSTATS_* macro expands to nothing. Call and transaction
+// counts are exact. Byte counts are estimates: each call site passes the sizeof of what it
+// means to allocate, free or log, which can miss work done underneath it, e.g. the nodes a
+// clear frees.
+
+// the kinds of containers that keep their own set of counters
+enum pstats_kind {
+    PSTATS_PVECTOR,
+    PSTATS_PLIST,
+    PSTATS_PSTRING,
+    PSTATS_PHASHTABLE,
+    PSTATS_PCOWVECTOR,
+    PSTATS_PBTREE,
+    PSTATS_PRING,
+    PSTATS_PBITSET,
+    PSTATS_PPRIORITY_QUEUE,
+    PSTATS_PPACKEDVECTOR,
+    PSTATS_PSORTEDVECTOR,
+    PSTATS_PSTRING_COLUMN,
+    PSTATS_OTHER,
+    PSTATS_KINDS
+};
+
+#define PSTATS_MAX_OPS 48
+
+// call count and total time spent for one named operation
+struct pstats_op {
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> ns;
+};
+
+class pstats {
+private:
+    const char* name;
+
+    std::atomic<uint64_t> tx_begun;
+    std::atomic<uint64_t> tx_nested;
+    std::atomic<uint64_t> tx_max_depth;
+    std::atomic<uint64_t> allocs;
+    std::atomic<uint64_t> alloc_bytes;
+    std::atomic<uint64_t> frees;
+    std::atomic<uint64_t> free_bytes;
+    std::atomic<uint64_t> snapshot_bytes;
+
+    pstats_op ops[PSTATS_MAX_OPS];
+    std::atomic<int> num_ops;
+    // guards claiming op slots; the counters themselves are atomic
+    std::mutex ops_lock;
+
+    // transaction nesting depth of the calling thread, across all containers
+    static inline thread_local int depth = 0;
+    // whether the innermost ptx::run on the calling thread opened its transaction
+    static inline thread_local bool opened = false;
+
+    size_t format(char*, size_t) const;
+
+public:
+    // Constructor
+    explicit pstats(const char*);
+
+    // Lookup
+    static pstats& of(pstats_kind);
+    static pstats& global();
+
+    // Recording
+    static void tx_entry(bool);
+    void tx_begin();
+    void tx_end();
+    void alloc(size_t);
+    void free(size_t);
+    void snapshot(size_t);
+    pstats_op& op(const char*);
+
+    // Get/Set
+    uint64_t get_tx_begun() const;
+    uint64_t get_tx_nested() const;
+    uint64_t get_tx_max_depth() const;
+    uint64_t get_allocs() const;
+    uint64_t get_alloc_bytes() const;
+    uint64_t get_frees() const;
+    uint64_t get_free_bytes() const;
+    uint64_t get_snapshot_bytes() const;
+
+    // Misc.
+    void reset();
+    void dump(std::ostream&) const;
+    void dump_fd(int) const;
+    static void reset_all();
+    static void dump_all(std::ostream&);
+    static void dump_all_fd(int);
+    static void install_signal_handlers(int dump_sig = SIGUSR1, int reset_sig = SIGUSR2);
+};
+
+// Counts a transaction as begun or joined, and nested for as long as it is in scope.
+class pstats_tx_scope {
+private:
+    pstats& stats;
+
+public:
+    explicit pstats_tx_scope(pstats_kind);
+    ~pstats_tx_scope();
+};
+
+// Adds the time spent in its scope to the given operation.
+class pstats_op_timer {
+private:
+    pstats_op& slot;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit pstats_op_timer(pstats_op&);
+    ~pstats_op_timer();
+};
+
+#ifdef PCOLLECTIONS_STATS
+#define PSTATS_TX(kind) pstats_tx_scope _pstats_tx(kind)
+#define PSTATS_TX_ENTRY(outermost) pstats::tx_entry(outermost)
+#define PSTATS_OP(kind, op_name) \
+    static pstats_op& _pstats_slot = pstats::of(kind).op(op_name); \
+    pstats_op_timer _pstats_timer(_pstats_slot)
+#define PSTATS_ALLOC(kind, bytes) pstats::of(kind).alloc(bytes)
+#define PSTATS_FREE(kind, bytes) pstats::of(kind).free(bytes)
+#define PSTATS_SNAPSHOT(kind, bytes) pstats::of(kind).snapshot(bytes)
+#else
+#define PSTATS_TX(kind) ((void)0)
+#define PSTATS_TX_ENTRY(outermost) ((void)0)
+#define PSTATS_OP(kind, op_name) ((void)0)
+#define PSTATS_ALLOC(kind, bytes) ((void)0)
+#define PSTATS_FREE(kind, bytes) ((void)0)
+#define PSTATS_SNAPSHOT(kind, bytes) ((void)0)
+#endif
+
+#include "pstats.hpp"
+
+#endif
@@ -0,0 +1,347 @@
+#include "pstats.h"
+
+#include <unistd.h>
+#include <cstring>
+
+/* ========================================================================= */
+/* ******************************** pstats ********************************* */
+/* ========================================================================= */
+
+/* ============================ CONSTRUCTORS =============================== */
+
+// Create a zeroed set of counters with the given display name.
+inline pstats::pstats(const char* name_in) : name(name_in) {
+    for (int i = 0; i < PSTATS_MAX_OPS; i++)
+        ops[i].name = nullptr;
+
+    num_ops = 0;
+    reset();
+}
+
+/* ================================ LOOKUP ================================= */
+
+// Get the counters for the given kind of container.
+inline pstats& pstats::of(pstats_kind kind) {
+    static pstats kinds[PSTATS_KINDS] = {
+        pstats("pvector"), pstats("plist"), pstats("pstring"), pstats("phashtable"),
+        pstats("pcowvector"), pstats("pbtree"), pstats("pring"), pstats("pbitset"),
+        pstats("ppriority_queue"), pstats("ppackedvector"), pstats("psortedvector"),
+        pstats("pstring_column"), pstats("other")
+    };
+
+    return kinds[kind];
+}
+
+// Get the counters summed over every kind of container.
+inline pstats& pstats::global() {
+    static pstats all("global");
+    return all;
+}
+
+/* =============================== RECORDING =============================== */
+
+// Record whether the ptx::run being entered opens its own transaction, i.e. none was open
+// on this thread yet. The PSTATS_TX at the top of its body picks this up.
+inline void pstats::tx_entry(bool outermost) {
+    opened = outermost;
+}
+
+// Record the start of a transaction body, counting it as begun if its run opened the
+// transaction and as nested if it joined one, and tracking how deeply it is nested.
+inline void pstats::tx_begin() {
+    int d = ++depth;
+    bool outermost = opened;
+    opened = false;
+
+    for (pstats* s : {this, &global()}) {
+        if (outermost)
+            s->tx_begun++;
+        else
+            s->tx_nested++;
+
+        // raise the max depth if we are the deepest seen so far
+        uint64_t seen = s->tx_max_depth;
+        while (seen < (uint64_t)d && !s->tx_max_depth.compare_exchange_weak(seen, d)) {}
+    }
+}
+
+// Record the end of a transaction.
+inline void pstats::tx_end() {
+    depth--;
+}
+
+// Record an allocation of an estimated number of bytes.
+inline void pstats::alloc(size_t bytes) {
+    for (pstats* s : {this, &global()}) {
+        s->allocs++;
+        s->alloc_bytes += bytes;
+    }
+}
+
+// Record a deallocation of an estimated number of bytes.
+inline void pstats::free(size_t bytes) {
+    for (pstats* s : {this, &global()}) {
+        s->frees++;
+        s->free_bytes += bytes;
+    }
+}
+
+// Record an estimated number of bytes being added to the undo log.
+inline void pstats::snapshot(size_t bytes) {
+    snapshot_bytes += bytes;
+    global().snapshot_bytes += bytes;
+}
+
+// Get the slot for the named operation, claiming a new one if needed. Call sites with the
+// same name share a slot. Called once per call site, so the lookup cost is not paid per
+// operation.
+inline pstats_op& pstats::op(const char* op_name) {
+    std::lock_guard<std::mutex> guard(ops_lock);
+
+    for (int i = 0; i < num_ops && i < PSTATS_MAX_OPS; i++) {
+        if (strcmp(ops[i].name, op_name) == 0)
+            return ops[i];
+    }
+
+    int idx = num_ops++;
+
+    // share the last slot rather than overflow if we run out
+    if (idx >= PSTATS_MAX_OPS) {
+        num_ops = PSTATS_MAX_OPS;
+        return ops[PSTATS_MAX_OPS - 1];
+    }
+
+    ops[idx].calls = 0;
+    ops[idx].ns = 0;
+    ops[idx].name = op_name;
+
+    return ops[idx];
+}
+
+/* =============================== GET/SET ================================= */
+
+// Get the number of transactions begun, counting only runs that opened one of their own.
+inline uint64_t pstats::get_tx_begun() const {
+    return tx_begun;
+}
+
+// Get the number of runs made while a transaction was already open, which join it rather
+// than committing on their own.
+inline uint64_t pstats::get_tx_nested() const {
+    return tx_nested;
+}
+
+// Get the deepest transaction nesting seen.
+inline uint64_t pstats::get_tx_max_depth() const {
+    return tx_max_depth;
+}
+
+// Get the number of make_persistent calls.
+inline uint64_t pstats::get_allocs() const {
+    return allocs;
+}
+
+// Get the estimated number of bytes requested through make_persistent.
+inline uint64_t pstats::get_alloc_bytes() const {
+    return alloc_bytes;
+}
+
+// Get the number of delete_persistent calls.
+inline uint64_t pstats::get_frees() const {
+    return frees;
+}
+
+// Get the estimated number of bytes released through delete_persistent.
+inline uint64_t pstats::get_free_bytes() const {
+    return free_bytes;
+}
+
+// Get the estimated number of bytes added to undo logs.
+inline uint64_t pstats::get_snapshot_bytes() const {
+    return snapshot_bytes;
+}
+
+/* ================================ MISC. ================================== */
+
+// Zero every counter, keeping the operation names.
+inline void pstats::reset() {
+    tx_begun = 0;
+    tx_nested = 0;
+    tx_max_depth = 0;
+    allocs = 0;
+    alloc_bytes = 0;
+    frees = 0;
+    free_bytes = 0;
+    snapshot_bytes = 0;
+
+    for (int i = 0; i < num_ops && i < PSTATS_MAX_OPS; i++) {
+        ops[i].calls = 0;
+        ops[i].ns = 0;
+    }
+}
+
+// Append a string to the buffer, never writing past its end.
+inline static size_t pstats_put(char* buf, size_t at, size_t cap, const char* s) {
+    while (*s && at < cap)
+        buf[at++] = *s++;
+
+    return at;
+}
+
+// Append an unsigned number to the buffer, never writing past its end.
+inline static size_t pstats_put(char* buf, size_t at, size_t cap, uint64_t n) {
+    char digits[21];
+    int i = 20;
+    digits[i] = '\0';
+
+    do {
+        digits[--i] = '0' + n % 10;
+        n /= 10;
+    } while (n > 0);
+
+    return pstats_put(buf, at, cap, digits + i);
+}
+
+// Format the counters into the given buffer. Only touches atomics and the buffer so
+// that it can run inside a signal handler.
+inline size_t pstats::format(char* buf, size_t cap) const {
+    size_t at = 0;
+
+    at = pstats_put(buf, at, cap, "[");
+    at = pstats_put(buf, at, cap, name);
+    at = pstats_put(buf, at, cap, "] tx_begun=");
+    at = pstats_put(buf, at, cap, (uint64_t)tx_begun);
+    at = pstats_put(buf, at, cap, " tx_nested=");
+    at = pstats_put(buf, at, cap, (uint64_t)tx_nested);
+    at = pstats_put(buf, at, cap, " tx_max_depth=");
+    at = pstats_put(buf, at, cap, (uint64_t)tx_max_depth);
+    at = pstats_put(buf, at, cap, " allocs=");
+    at = pstats_put(buf, at, cap, (uint64_t)allocs);
+    at = pstats_put(buf, at, cap, " alloc_bytes_est=");
+    at = pstats_put(buf, at, cap, (uint64_t)alloc_bytes);
+    at = pstats_put(buf, at, cap, " frees=");
+    at = pstats_put(buf, at, cap, (uint64_t)frees);
+    at = pstats_put(buf, at, cap, " free_bytes_est=");
+    at = pstats_put(buf, at, cap, (uint64_t)free_bytes);
+    at = pstats_put(buf, at, cap, " snapshot_bytes_est=");
+    at = pstats_put(buf, at, cap, (uint64_t)snapshot_bytes);
+    at = pstats_put(buf, at, cap, "\n");
+
+    for (int i = 0; i < num_ops && i < PSTATS_MAX_OPS; i++) {
+        const char* op_name = ops[i].name;
+        uint64_t calls = ops[i].calls;
+        uint64_t ns = ops[i].ns;
+
+        if (op_name == nullptr || calls == 0)
+            continue;
+
+        at = pstats_put(buf, at, cap, "[");
+        at = pstats_put(buf, at, cap, name);
+        at = pstats_put(buf, at, cap, "] op=");
+        at = pstats_put(buf, at, cap, op_name);
+        at = pstats_put(buf, at, cap, " calls=");
+        at = pstats_put(buf, at, cap, calls);
+        at = pstats_put(buf, at, cap, " total_ns=");
+        at = pstats_put(buf, at, cap, ns);
+        at = pstats_put(buf, at, cap, " avg_ns=");
+        at = pstats_put(buf, at, cap, ns / calls);
+        at = pstats_put(buf, at, cap, "\n");
+    }
+
+    return at;
+}
+
+// Print the counters to the given output stream.
+inline void pstats::dump(std::ostream& os) const {
+    char buf[8192];
+    os.write(buf, format(buf, sizeof(buf)));
+}
+
+// Write the counters to the given file descriptor. Safe to call from a signal handler.
+inline void pstats::dump_fd(int fd) const {
+    char buf[8192];
+    size_t n = format(buf, sizeof(buf));
+
+    if (write(fd, buf, n) < 0) {
+        // nothing sensible to do about a failed debug dump
+    }
+}
+
+// Zero the counters of every kind of container and the global totals.
+inline void pstats::reset_all() {
+    for (int k = 0; k < PSTATS_KINDS; k++)
+        of((pstats_kind)k).reset();
+
+    global().reset();
+}
+
+// Print the counters of every kind of container followed by the global totals.
+inline void pstats::dump_all(std::ostream& os) {
+    for (int k = 0; k < PSTATS_KINDS; k++)
+        of((pstats_kind)k).dump(os);
+
+    global().dump(os);
+}
+
+// Write the counters of every kind of container and the global totals to the given
+// file descriptor. Safe to call from a signal handler.
+inline void pstats::dump_all_fd(int fd) {
+    for (int k = 0; k < PSTATS_KINDS; k++)
+        of((pstats_kind)k).dump_fd(fd);
+
+    global().dump_fd(fd);
+}
+
+// Let a running process be asked to dump (default SIGUSR1, to stderr) or reset
+// (default SIGUSR2) its counters, e.g. with `kill -USR1 <pid>`.
+inline void pstats::install_signal_handlers(int dump_sig, int reset_sig) {
+    // make sure the statics exist before a handler can touch them
+    of(PSTATS_PVECTOR);
+    global();
+
+    static int dump_signal;
+    static int reset_signal;
+    dump_signal = dump_sig;
+    reset_signal = reset_sig;
+
+    auto handler = [](int sig) {
+        if (sig == dump_signal)
+            dump_all_fd(STDERR_FILENO);
+        else if (sig == reset_signal)
+            reset_all();
+    };
+
+    signal(dump_sig, handler);
+    signal(reset_sig, handler);
+}
+
+/* ========================================================================= */
+/* **************************** pstats_tx_scope **************************** */
+/* ========================================================================= */
+
+// Count a transaction as begun or joined, and nested one level deeper.
+inline pstats_tx_scope::pstats_tx_scope(pstats_kind kind) : stats(pstats::of(kind)) {
+    stats.tx_begin();
+}
+
+// Close out the nesting level opened by this scope.
+inline pstats_tx_scope::~pstats_tx_scope() {
+    stats.tx_end();
+}
+
+/* ========================================================================= */
+/* **************************** pstats_op_timer **************************** */
+/* ========================================================================= */
+
+// Start timing an operation.
+inline pstats_op_timer::pstats_op_timer(pstats_op& slot_in) : slot(slot_in) {
+    start = std::chrono::steady_clock::now();
+}
+
+// Stop timing and add the elapsed time to the operation's slot.
+inline pstats_op_timer::~pstats_op_timer() {
+    auto end = std::chrono::steady_clock::now();
+
+    slot.calls++;
+    slot.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
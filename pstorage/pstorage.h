@@ -0,0 +1,112 @@
+#ifndef _PSTORAGE_H
+#define _PSTORAGE_H
+
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/make_persistent_array.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "../palloc/palloc.h"
+
+using namespace pmem;
+using namespace pmem::obj;
+
+// Storage policies for the collections. A container's ROOT_T picks where it lives: any
+// real root type keeps it in that pool, with persistent_ptr, make_persistent and
+// transactions as usual, while pdram in its place keeps it on the heap, with plain
+// pointers, new/delete and transactions that just run their function. The container code
+// and API are the same either way, e.g. pvector<int, root> and pvector<int, pdram>.
+//
+// Heap containers have nothing to recover and nothing to roll back: an exception thrown
+// part way through an operation leaves whatever it had already changed.
+
+// Stands in for the root type to keep a container in DRAM.
+class pdram {};
+
+// The "pool" of a heap container. There is nothing to open or close.
+class pdram_pool {
+public:
+    void close() {}
+};
+
+// Heap pointer with the parts of the persistent_ptr interface the collections use.
+template <typename T>
+class pdram_ptr {
+public:
+    typedef typename std::remove_extent<T>::type element_type;
+
+private:
+    element_type* ptr;
+
+public:
+    // Constructors
+    pdram_ptr();
+    pdram_ptr(std::nullptr_t);
+    pdram_ptr(element_type*);
+
+    // Operator Overloads
+    element_type* operator->() const;
+    element_type& operator*() const;
+    element_type& operator[](std::ptrdiff_t) const;
+    explicit operator bool() const;
+
+    // Get/Set
+    element_type* get() const;
+    PMEMoid raw() const;
+};
+
+template <typename T, typename Y>
+bool operator==(const pdram_ptr<T>&, const pdram_ptr<Y>&);
+template <typename T, typename Y>
+bool operator!=(const pdram_ptr<T>&, const pdram_ptr<Y>&);
+template <typename T>
+bool operator==(const pdram_ptr<T>&, std::nullptr_t);
+template <typename T>
+bool operator!=(const pdram_ptr<T>&, std::nullptr_t);
+
+// The policy for containers in a pool of ROOT_T.
+template <typename ROOT_T>
+class pstorage {
+public:
+    template <typename T>
+    using ptr = persistent_ptr<T>;
+    typedef pool<ROOT_T> pool_type;
+
+    template <typename T, typename... Args>
+    static ptr<T> make(Args&&...);
+    template <typename T, typename... Args>
+    static void destroy(ptr<T>, Args&&...);
+    template <typename T>
+    static void snapshot(const T*, size_t n = 1);
+    static void fill(const void*, size_t);
+};
+
+// The policy for containers on the heap.
+template <>
+class pstorage<pdram> {
+public:
+    template <typename T>
+    using ptr = pdram_ptr<T>;
+    typedef pdram_pool pool_type;
+
+    template <typename T, typename... Args>
+    static typename std::enable_if<!std::is_array<T>::value, ptr<T>>::type make(Args&&...);
+    template <typename T>
+    static typename std::enable_if<std::is_array<T>::value, ptr<T>>::type make(size_t);
+    template <typename T>
+    static typename std::enable_if<!std::is_array<T>::value>::type destroy(ptr<T>);
+    template <typename T>
+    static typename std::enable_if<std::is_array<T>::value>::type destroy(ptr<T>, size_t);
+    template <typename T>
+    static void snapshot(const T*, size_t n = 1);
+    static void fill(const void*, size_t);
+};
+
+#include "pstorage.hpp"
+
+#endif
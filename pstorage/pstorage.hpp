@@ -0,0 +1,170 @@
+#include "pstorage.h"
+
+/* ========================================================================= */
+/* ******************************* pdram_ptr ******************************* */
+/* ========================================================================= */
+
+/* ============================ CONSTRUCTORS =============================== */
+
+// Create a null pointer.
+template <typename T>
+pdram_ptr<T>::pdram_ptr() : ptr(nullptr) {
+}
+
+// Create a null pointer.
+template <typename T>
+pdram_ptr<T>::pdram_ptr(std::nullptr_t) : ptr(nullptr) {
+}
+
+// Point at the given object.
+template <typename T>
+pdram_ptr<T>::pdram_ptr(element_type* ptr_in) : ptr(ptr_in) {
+}
+
+/* ========================== OPERATOR OVERLOADS =========================== */
+
+// Access a member of the object pointed at.
+template <typename T>
+typename pdram_ptr<T>::element_type* pdram_ptr<T>::operator->() const {
+    return ptr;
+}
+
+// Get the object pointed at.
+template <typename T>
+typename pdram_ptr<T>::element_type& pdram_ptr<T>::operator*() const {
+    return *ptr;
+}
+
+// Get the item at the given index of the array pointed at.
+template <typename T>
+typename pdram_ptr<T>::element_type& pdram_ptr<T>::operator[](std::ptrdiff_t idx) const {
+    return ptr[idx];
+}
+
+// Get whether this pointer is not null.
+template <typename T>
+pdram_ptr<T>::operator bool() const {
+    return ptr != nullptr;
+}
+
+// Get whether both pointers point at the same address.
+template <typename T, typename Y>
+bool operator==(const pdram_ptr<T>& a, const pdram_ptr<Y>& b) {
+    return (const void*)a.get() == (const void*)b.get();
+}
+
+// Get whether the pointers point at different addresses.
+template <typename T, typename Y>
+bool operator!=(const pdram_ptr<T>& a, const pdram_ptr<Y>& b) {
+    return !(a == b);
+}
+
+// Get whether the pointer is null.
+template <typename T>
+bool operator==(const pdram_ptr<T>& a, std::nullptr_t) {
+    return a.get() == nullptr;
+}
+
+// Get whether the pointer is not null.
+template <typename T>
+bool operator!=(const pdram_ptr<T>& a, std::nullptr_t) {
+    return a.get() != nullptr;
+}
+
+/* =============================== GET/SET ================================= */
+
+// Get the address pointed at.
+template <typename T>
+typename pdram_ptr<T>::element_type* pdram_ptr<T>::get() const {
+    return ptr;
+}
+
+// Get the address pointed at as an object id, whose offset is the address itself, so
+// layout reports work the same on the heap.
+template <typename T>
+PMEMoid pdram_ptr<T>::raw() const {
+    PMEMoid oid;
+    oid.pool_uuid_lo = 0;
+    oid.off = (uint64_t)(uintptr_t)ptr;
+
+    return oid;
+}
+
+/* ========================================================================= */
+/* ******************************* pstorage ******************************** */
+/* ========================================================================= */
+
+// Allocate and construct an object, or an array if T is one, inside the open transaction.
+// An object whose type has a class of its own (see palloc) is allocated from that class.
+template <typename ROOT_T>
+template <typename T, typename... Args>
+typename pstorage<ROOT_T>::template ptr<T> pstorage<ROOT_T>::make(Args&&... args) {
+    if constexpr (!std::is_array<T>::value) {
+        unsigned id = palloc::get<T>();
+        if (id != 0)
+            return make_persistent<T>(allocation_flag::class_id(id), std::forward<Args>(args)...);
+    }
+
+    return make_persistent<T>(std::forward<Args>(args)...);
+}
+
+// Destroy and free an object, or an array of the given size, inside the open transaction.
+template <typename ROOT_T>
+template <typename T, typename... Args>
+void pstorage<ROOT_T>::destroy(ptr<T> obj, Args&&... args) {
+    delete_persistent<T>(obj, std::forward<Args>(args)...);
+}
+
+// Log the given items in the open transaction before they are changed.
+template <typename ROOT_T>
+template <typename T>
+void pstorage<ROOT_T>::snapshot(const T* first, size_t n) {
+    flat_transaction::snapshot(first, n);
+}
+
+// Add the given bytes, about to be written but holding nothing worth keeping (e.g. past
+// the used end of an array), to the open transaction without logging their old contents,
+// so they are only flushed on commit.
+template <typename ROOT_T>
+void pstorage<ROOT_T>::fill(const void* addr, size_t bytes) {
+    if (bytes == 0)
+        return;
+
+    if (pmemobj_tx_xadd_range_direct(addr, bytes, POBJ_XADD_NO_SNAPSHOT) != 0)
+        throw std::runtime_error("Cannot add a range to the transaction.");
+}
+
+// Allocate and construct an object on the heap.
+template <typename T, typename... Args>
+typename std::enable_if<!std::is_array<T>::value, pstorage<pdram>::ptr<T>>::type
+pstorage<pdram>::make(Args&&... args) {
+    return new T(std::forward<Args>(args)...);
+}
+
+// Allocate an array of n value-initialized items on the heap.
+template <typename T>
+typename std::enable_if<std::is_array<T>::value, pstorage<pdram>::ptr<T>>::type
+pstorage<pdram>::make(size_t n) {
+    return new typename std::remove_extent<T>::type[n]();
+}
+
+// Destroy and free an object on the heap.
+template <typename T>
+typename std::enable_if<!std::is_array<T>::value>::type pstorage<pdram>::destroy(ptr<T> obj) {
+    delete obj.get();
+}
+
+// Destroy and free an array on the heap.
+template <typename T>
+typename std::enable_if<std::is_array<T>::value>::type pstorage<pdram>::destroy(ptr<T> arr, size_t) {
+    delete[] arr.get();
+}
+
+// Nothing on the heap is ever rolled back, so there is nothing to log.
+template <typename T>
+void pstorage<pdram>::snapshot(const T*, size_t) {
+}
+
+// Heap writes need no flushing, so there is nothing to add.
+inline void pstorage<pdram>::fill(const void*, size_t) {
+}
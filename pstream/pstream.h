@@ -0,0 +1,121 @@
+#ifndef _PSTREAM_H
+#define _PSTREAM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+#include <stdexcept>
+#include <type_traits>
+#include "../pvector/pvector.h"
+#include "../plist/plist.h"
+#include "../pstring/pstring.h"
+#include "../phashtable/phashtable.h"
+#include "../pstats/pstats.h"
+#include "../pstorage/pstorage.h"
+#include "../ptx/ptx.h"
+
+using namespace pmem;
+using namespace pmem::obj;
+
+// Binary stream format for moving collections between pools or backing them up:
+//
+//   pstream_header   32 bytes, see below
+//   payload          count items packed back to back, each key_size bytes of key (hashtables
+//                    only) followed by val_size bytes of value; for a pstring, its characters
+//
+// Values are copied bytewise, so only collections of trivially copyable values can be
+// streamed, and a stream can only be read on a machine with the same byte order (checked
+// through the order field).
+#define PSTREAM_MAGIC "PCOL"
+#define PSTREAM_VERSION 1
+#define PSTREAM_ORDER 0x01020304u
+
+// how many bytes export buffers in DRAM and import commits per transaction
+#define PSTREAM_CHUNK ((size_t)(1024 * 1024))
+
+enum pstream_kind {
+    PSTREAM_PVECTOR = 1,
+    PSTREAM_PLIST = 2,
+    PSTREAM_PSTRING = 3,
+    PSTREAM_PHASHTABLE = 4
+};
+
+struct pstream_header {
+    char magic[4];
+    uint16_t version;
+    uint16_t kind;
+    uint32_t order;
+    uint32_t key_size;
+    uint32_t val_size;
+    uint32_t reserved;
+    uint64_t count;
+};
+
+static_assert(sizeof(pstream_header) == 32, "pstream_header must stay 32 bytes");
+
+// Where an import reads from: a file, which is mmapped and copied straight into pmem, or
+// any std::istream, which is read through in chunks.
+class pstream_source {
+private:
+    std::istream* is;
+
+    int fd;
+    const char* map;
+    size_t map_len;
+    size_t at;
+
+public:
+    // Constructors/Destructor
+    explicit pstream_source(const char*);
+    explicit pstream_source(std::istream&);
+    ~pstream_source();
+
+    pstream_source(const pstream_source&) = delete;
+    pstream_source& operator=(const pstream_source&) = delete;
+
+    // Reading
+    void read(void*, size_t);
+    void copy_to(pool_base&, void*, size_t);
+};
+
+// Export and import of the collections in the stream format above. Exports walk the
+// collection once and never hold more than PSTREAM_CHUNK bytes of it in DRAM. Imports
+// build a new collection in the given pool and store it in the given pointer, which should
+// live in pmem (e.g. a field of the root) so partially imported data stays reachable.
+class pstream {
+private:
+    template <typename VAL_T>
+    static void check_value();
+    static pstream_header make_header(pstream_kind, size_t, size_t, size_t);
+    static pstream_header read_header(pstream_source&, pstream_kind, size_t, size_t);
+
+public:
+    // Export
+    template <typename VAL_T, typename ROOT_T>
+    static void write(std::ostream&, const pvector<VAL_T, ROOT_T>&);
+    template <typename VAL_T, typename ROOT_T>
+    static void write(std::ostream&, const plist<VAL_T, ROOT_T>&);
+    template <typename ROOT_T>
+    static void write(std::ostream&, const pstring<ROOT_T>&);
+    template <typename KEY_T, typename VAL_T, typename ROOT_T>
+    static void write(std::ostream&, const phashtable<KEY_T, VAL_T, ROOT_T>&);
+
+    // Import
+    template <typename VAL_T, typename ROOT_T>
+    static void read(pstream_source&, pool<ROOT_T>&, persistent_ptr<pvector<VAL_T, ROOT_T>>&);
+    template <typename VAL_T, typename ROOT_T>
+    static void read(pstream_source&, pool<ROOT_T>&, persistent_ptr<plist<VAL_T, ROOT_T>>&);
+    template <typename ROOT_T>
+    static void read(pstream_source&, pool<ROOT_T>&, persistent_ptr<pstring<ROOT_T>>&);
+    template <typename KEY_T, typename VAL_T, typename ROOT_T>
+    static void read(pstream_source&, pool<ROOT_T>&,
+                     persistent_ptr<phashtable<KEY_T, VAL_T, ROOT_T>>&);
+};
+
+#include "pstream.hpp"
+
+#endif
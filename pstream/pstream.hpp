@@ -0,0 +1,413 @@
+#include "pstream.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+/* ========================================================================= */
+/* **************************** pstream_source ***************************** */
+/* ========================================================================= */
+
+/* ======================== CONSTRUCTORS/DESTRUCTOR ======================== */
+
+// Open the file at the given path and map all of it for reading.
+inline pstream_source::pstream_source(const char* path) {
+    is = nullptr;
+    map = nullptr;
+    map_len = 0;
+    at = 0;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error(std::string("Cannot open ") + path + ": " + strerror(errno));
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        close(fd);
+        throw std::runtime_error(std::string("Cannot stat ") + path + ": " + strerror(err));
+    }
+
+    map_len = st.st_size;
+
+    // an empty file cannot be mapped, and every read from it fails anyway
+    if (map_len > 0) {
+        void* addr = mmap(nullptr, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (addr == MAP_FAILED) {
+            int err = errno;
+            close(fd);
+            throw std::runtime_error(std::string("Cannot map ") + path + ": " + strerror(err));
+        }
+
+        // we read front to back exactly once, so let the kernel read ahead aggressively
+        madvise(addr, map_len, MADV_SEQUENTIAL);
+        map = (const char*)addr;
+    }
+}
+
+// Read from the given input stream, which must outlive this source.
+inline pstream_source::pstream_source(std::istream& is_in) {
+    is = &is_in;
+    fd = -1;
+    map = nullptr;
+    map_len = 0;
+    at = 0;
+}
+
+// Unmap and close the file, if we opened one.
+inline pstream_source::~pstream_source() {
+    if (map != nullptr)
+        munmap((void*)map, map_len);
+
+    if (fd >= 0)
+        close(fd);
+}
+
+/* ================================ READING ================================ */
+
+// Copy the next n bytes of the stream into the given DRAM buffer.
+inline void pstream_source::read(void* dst, size_t n) {
+    if (is == nullptr) {
+        if (n > map_len - at)
+            throw std::runtime_error("Unexpected end of stream.");
+
+        memcpy(dst, map + at, n);
+        at += n;
+    }
+    else {
+        is->read((char*)dst, n);
+
+        if ((size_t)is->gcount() != n)
+            throw std::runtime_error("Unexpected end of stream.");
+    }
+}
+
+// Copy the next n bytes of the stream into the given pmem and make them durable. Nothing is
+// logged, so the destination must not be visible yet (e.g. past the end of a collection).
+inline void pstream_source::copy_to(pool_base& pop, void* dst, size_t n) {
+    if (is == nullptr) {
+        if (n > map_len - at)
+            throw std::runtime_error("Unexpected end of stream.");
+
+        // one copy straight from the page cache, with non-temporal stores for large ranges
+        pop.memcpy_persist(dst, map + at, n);
+        at += n;
+
+        return;
+    }
+
+    // otherwise read straight into pmem a chunk at a time, flushing behind us
+    for (size_t done = 0; done < n;) {
+        size_t step = n - done < PSTREAM_CHUNK ? n - done : PSTREAM_CHUNK;
+        char* to = (char*)dst + done;
+
+        is->read(to, step);
+
+        if ((size_t)is->gcount() != step)
+            throw std::runtime_error("Unexpected end of stream.");
+
+        pop.persist(to, step);
+        done += step;
+    }
+}
+
+/* ========================================================================= */
+/* ******************************** pstream ******************************** */
+/* ========================================================================= */
+
+/* ================================ HELPERS ================================ */
+
+// Refuse at compile time to stream values that cannot be copied bytewise.
+template <typename VAL_T>
+void pstream::check_value() {
+    static_assert(std::is_trivially_copyable<VAL_T>::value,
+                  "pstream can only stream collections of trivially copyable values");
+}
+
+// Build the header for a stream of count items of the given kind and sizes.
+inline pstream_header pstream::make_header(pstream_kind kind, size_t key_size, size_t val_size,
+                                           size_t count) {
+    pstream_header h;
+
+    memcpy(h.magic, PSTREAM_MAGIC, sizeof(h.magic));
+    h.version = PSTREAM_VERSION;
+    h.kind = kind;
+    h.order = PSTREAM_ORDER;
+    h.key_size = key_size;
+    h.val_size = val_size;
+    h.reserved = 0;
+    h.count = count;
+
+    return h;
+}
+
+// Read a header and check that it describes a stream we can import into the given kind
+// of collection with the given key and value sizes.
+inline pstream_header pstream::read_header(pstream_source& src, pstream_kind kind,
+                                           size_t key_size, size_t val_size) {
+    pstream_header h;
+    src.read(&h, sizeof(h));
+
+    if (memcmp(h.magic, PSTREAM_MAGIC, sizeof(h.magic)) != 0)
+        throw std::runtime_error("Not a pcollections stream.");
+
+    if (h.version != PSTREAM_VERSION)
+        throw std::runtime_error("Unsupported pcollections stream version.");
+
+    if (h.order != PSTREAM_ORDER)
+        throw std::runtime_error("Stream was written with a different byte order.");
+
+    if (h.kind != kind)
+        throw std::runtime_error("Stream holds a different kind of collection.");
+
+    if (h.key_size != key_size || h.val_size != val_size)
+        throw std::runtime_error("Stream holds keys or values of a different size.");
+
+    if (h.count > (uint64_t)INT32_MAX)
+        throw std::out_of_range("Stream holds more items than a collection can.");
+
+    return h;
+}
+
+/* ================================ EXPORT ================================= */
+
+// Write the given vector to the stream, straight out of pmem.
+template <typename VAL_T, typename ROOT_T>
+void pstream::write(std::ostream& os, const pvector<VAL_T, ROOT_T>& v) {
+    PSTATS_OP(PSTATS_OTHER, "pstream::write");
+    check_value<VAL_T>();
+
+    pstream_header h = make_header(PSTREAM_PVECTOR, 0, sizeof(VAL_T), v.len);
+    os.write((const char*)&h, sizeof(h));
+
+    // the items are contiguous, so they go out in a single write
+    if (v.len > 0)
+        os.write((const char*)v.arr.get(), sizeof(VAL_T) * v.len);
+
+    if (!os)
+        throw std::runtime_error("Failed to write the stream.");
+}
+
+// Write the given list to the stream, gathering its nodes into chunks.
+template <typename VAL_T, typename ROOT_T>
+void pstream::write(std::ostream& os, const plist<VAL_T, ROOT_T>& l) {
+    PSTATS_OP(PSTATS_OTHER, "pstream::write");
+    check_value<VAL_T>();
+
+    pstream_header h = make_header(PSTREAM_PLIST, 0, sizeof(VAL_T), l.get_length());
+    os.write((const char*)&h, sizeof(h));
+
+    std::vector<char> buf(PSTREAM_CHUNK);
+    size_t used = 0;
+
+    l.for_each([&](const VAL_T& val) {
+        if (used + sizeof(VAL_T) > buf.size()) {
+            os.write(buf.data(), used);
+            used = 0;
+        }
+
+        memcpy(buf.data() + used, &val, sizeof(VAL_T));
+        used += sizeof(VAL_T);
+    });
+
+    os.write(buf.data(), used);
+
+    if (!os)
+        throw std::runtime_error("Failed to write the stream.");
+}
+
+// Write the given string to the stream, without its null-terminator.
+template <typename ROOT_T>
+void pstream::write(std::ostream& os, const pstring<ROOT_T>& s) {
+    PSTATS_OP(PSTATS_OTHER, "pstream::write");
+
+    pstream_header h = make_header(PSTREAM_PSTRING, 0, sizeof(char), s.len);
+    os.write((const char*)&h, sizeof(h));
+
+    if (s.len > 0)
+        os.write(s.arr.get(), s.len);
+
+    if (!os)
+        throw std::runtime_error("Failed to write the stream.");
+}
+
+// Write the pairs of the given hashtable to the stream, gathering them into chunks. Pairs
+// come out in bucket order, which is not meaningful to the importing table.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void pstream::write(std::ostream& os, const phashtable<KEY_T, VAL_T, ROOT_T>& t) {
+    PSTATS_OP(PSTATS_OTHER, "pstream::write");
+    check_value<KEY_T>();
+    check_value<VAL_T>();
+
+    pstream_header h = make_header(PSTREAM_PHASHTABLE, sizeof(KEY_T), sizeof(VAL_T),
+                                   t.get_length());
+    os.write((const char*)&h, sizeof(h));
+
+    std::vector<char> buf(PSTREAM_CHUNK);
+    size_t used = 0;
+
+    t.for_each([&](const KEY_T& key, const VAL_T& val) {
+        if (used + sizeof(KEY_T) + sizeof(VAL_T) > buf.size()) {
+            os.write(buf.data(), used);
+            used = 0;
+        }
+
+        memcpy(buf.data() + used, &key, sizeof(KEY_T));
+        memcpy(buf.data() + used + sizeof(KEY_T), &val, sizeof(VAL_T));
+        used += sizeof(KEY_T) + sizeof(VAL_T);
+    });
+
+    os.write(buf.data(), used);
+
+    if (!os)
+        throw std::runtime_error("Failed to write the stream.");
+}
+
+/* ================================ IMPORT ================================= */
+
+// Read a vector from the stream into a new pvector. The array is allocated whole in one
+// transaction, filled with one unlogged copy (its slots are past the end until we are
+// done), and published by a second transaction that sets the length.
+template <typename VAL_T, typename ROOT_T>
+void pstream::read(pstream_source& src, pool<ROOT_T>& pop,
+                   persistent_ptr<pvector<VAL_T, ROOT_T>>& out) {
+    PSTATS_OP(PSTATS_OTHER, "pstream::read");
+    check_value<VAL_T>();
+
+    pstream_header h = read_header(src, PSTREAM_PVECTOR, 0, sizeof(VAL_T));
+    int n = h.count;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_OTHER);
+        PSTATS_ALLOC(PSTATS_OTHER, sizeof(pvector<VAL_T, ROOT_T>));
+
+        if (n > 0)
+            out = pstorage<ROOT_T>::template make<pvector<VAL_T, ROOT_T>>(pop, n);
+        else
+            out = pstorage<ROOT_T>::template make<pvector<VAL_T, ROOT_T>>(pop);
+    });
+
+    if (n == 0)
+        return;
+
+    src.copy_to(pop, out->arr.get(), sizeof(VAL_T) * n);
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_OTHER);
+        out->len = n;
+    });
+}
+
+// Read a list from the stream into a new plist, committing one chunk of nodes per
+// transaction. Every node is its own allocation, so this is bound by the allocator
+// rather than the copy.
+template <typename VAL_T, typename ROOT_T>
+void pstream::read(pstream_source& src, pool<ROOT_T>& pop,
+                   persistent_ptr<plist<VAL_T, ROOT_T>>& out) {
+    PSTATS_OP(PSTATS_OTHER, "pstream::read");
+    check_value<VAL_T>();
+
+    pstream_header h = read_header(src, PSTREAM_PLIST, 0, sizeof(VAL_T));
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_OTHER);
+        PSTATS_ALLOC(PSTATS_OTHER, sizeof(plist<VAL_T, ROOT_T>));
+
+        out = pstorage<ROOT_T>::template make<plist<VAL_T, ROOT_T>>(pop);
+    });
+
+    size_t per_chunk = PSTREAM_CHUNK / sizeof(VAL_T) > 0 ? PSTREAM_CHUNK / sizeof(VAL_T) : 1;
+    std::vector<VAL_T> buf(per_chunk);
+
+    for (uint64_t done = 0; done < h.count;) {
+        size_t n = h.count - done < per_chunk ? h.count - done : per_chunk;
+        src.read(buf.data(), sizeof(VAL_T) * n);
+
+        out->batch([&] {
+            for (size_t i = 0; i < n; i++)
+                out->push_back(buf[i]);
+        });
+
+        done += n;
+    }
+}
+
+// Read a string from the stream into a new pstring, the same way as a pvector.
+template <typename ROOT_T>
+void pstream::read(pstream_source& src, pool<ROOT_T>& pop, persistent_ptr<pstring<ROOT_T>>& out) {
+    PSTATS_OP(PSTATS_OTHER, "pstream::read");
+
+    pstream_header h = read_header(src, PSTREAM_PSTRING, 0, sizeof(char));
+    int n = h.count;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_OTHER);
+        PSTATS_ALLOC(PSTATS_OTHER, sizeof(pstring<ROOT_T>) + n + 1);
+
+        out = pstorage<ROOT_T>::template make<pstring<ROOT_T>>(pop);
+        out->arr = pstorage<ROOT_T>::template make<char[]>(n + 1);
+        out->arr[n] = '\0';
+        out->cap = n + 1;
+    });
+
+    src.copy_to(pop, out->arr.get(), n);
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_OTHER);
+        out->len = n;
+    });
+}
+
+// Read a hashtable from the stream into a new phashtable, sized up front so it never
+// rehashes, committing one chunk of pairs per transaction.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+void pstream::read(pstream_source& src, pool<ROOT_T>& pop,
+                   persistent_ptr<phashtable<KEY_T, VAL_T, ROOT_T>>& out) {
+    PSTATS_OP(PSTATS_OTHER, "pstream::read");
+    check_value<KEY_T>();
+    check_value<VAL_T>();
+
+    pstream_header h = read_header(src, PSTREAM_PHASHTABLE, sizeof(KEY_T), sizeof(VAL_T));
+
+    // as many buckets as build_from() would give the same pairs: a prime of at least one per
+    // pair, since the table grows once it holds more pairs than buckets
+    unsigned long target = std::min(2UL * h.count + 1, (unsigned long)max_prime);
+    int buckets = phashtable<KEY_T, VAL_T, ROOT_T>::prime_below(
+        std::max(target, (unsigned long)default_capacity));
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_OTHER);
+        PSTATS_ALLOC(PSTATS_OTHER, sizeof(phashtable<KEY_T, VAL_T, ROOT_T>));
+
+        out = pstorage<ROOT_T>::template make<phashtable<KEY_T, VAL_T, ROOT_T>>(pop, buckets);
+    });
+
+    size_t pair_size = sizeof(KEY_T) + sizeof(VAL_T);
+    size_t per_chunk = PSTREAM_CHUNK / pair_size > 0 ? PSTREAM_CHUNK / pair_size : 1;
+    std::vector<char> buf(per_chunk * pair_size);
+
+    for (uint64_t done = 0; done < h.count;) {
+        size_t n = h.count - done < per_chunk ? h.count - done : per_chunk;
+        src.read(buf.data(), pair_size * n);
+
+        out->batch([&] {
+            for (size_t i = 0; i < n; i++) {
+                KEY_T key;
+                VAL_T val;
+
+                memcpy(&key, buf.data() + i * pair_size, sizeof(KEY_T));
+                memcpy(&val, buf.data() + i * pair_size + sizeof(KEY_T), sizeof(VAL_T));
+
+                out->insert(key, val);
+            }
+        });
+
+        done += n;
+    }
+}
@@ -7,10 +7,21 @@
 #include <libpmemobj++/persistent_ptr.hpp>
 #include <libpmemobj++/transaction.hpp>
 #include <stdexcept>
+#include "../pdump/pdump.h"
+#include "../pstats/pstats.h"
+#include "../pstorage/pstorage.h"
+#include "../ptx/ptx.h"
+#include "../ptraits/ptraits.h"
 
 using namespace pmem;
 using namespace pmem::obj;
 
+// bulk export/import, the integrity checker and read-only views read the storage directly
+class pstream;
+class pcheck;
+template <typename ROOT_T>
+class pview;
+
 // forward declaration
 template <typename ROOT_T>
 class pstring;
@@ -21,22 +32,34 @@ std::ostream& operator<<(std::ostream&, const pstring<ROOT_T>&);
 
 template <typename ROOT_T>
 class pstring {
+public:
+    // where this container lives, picked by ROOT_T (see pstorage)
+    typedef pstorage<ROOT_T> storage;
+    template <typename T>
+    using ptr_t = typename storage::template ptr<T>;
+    typedef typename storage::pool_type pool_t;
+
 private:
     // will be a standard null-terminated C-style string
-    persistent_ptr<char[]> arr;
+    ptr_t<char[]> arr;
     // number of actual characters
     p<int> len;
     // number of characters + \0 -- always len + 1
     p<int> cap;
 
-    pool<ROOT_T> pop;
+    pool_t pop;
 
     void resize(int);
 
+    friend class pstream;
+    friend class pcheck;
+    template <typename>
+    friend class pview;
+
 public:
     // Constructors
-    pstring(pool<ROOT_T>);
-    pstring(pool<ROOT_T>, const char*);
+    pstring(pool_t);
+    pstring(pool_t, const char*);
 
     // Operator Overloads
     char operator[](int);
@@ -50,11 +73,18 @@ public:
     bool is_empty() const;
 
     // Misc.
-    void refresh_pool(pool<ROOT_T>);
+    template <typename F>
+    void batch(F&&);
+    void dump(pdump_sink&) const;
+    void refresh_pool(pool_t);
     void destroy();
 
 };
 
+// a pstring is just a pool offset, two ints and a pool handle, so it can be moved bytewise
+template <typename ROOT_T>
+struct is_prelocatable<pstring<ROOT_T>> : std::true_type {};
+
 #include "pstring.hpp"
 
 #endif
\ No newline at end of file
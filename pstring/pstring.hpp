@@ -8,10 +8,12 @@
 
 // Create a new, empty pstring.
 template <typename ROOT_T>
-pstring<ROOT_T>::pstring(pool<ROOT_T> pop_in) {
+pstring<ROOT_T>::pstring(pool_t pop_in) {
+    PSTATS_OP(PSTATS_PSTRING, "construct");
     pop = pop_in;
 
-    flat_transaction::run(pop, [&] {
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSTRING);
         arr = nullptr;
         len = 0;
         cap = 0;
@@ -20,13 +22,17 @@ pstring<ROOT_T>::pstring(pool<ROOT_T> pop_in) {
 
 // Create a new pstring of the given C-string.
 template <typename ROOT_T>
-pstring<ROOT_T>::pstring(pool<ROOT_T> pop_in, const char* str_in) {
+pstring<ROOT_T>::pstring(pool_t pop_in, const char* str_in) {
+    PSTATS_OP(PSTATS_PSTRING, "construct");
     pop = pop_in;
 
-    flat_transaction::run(pop, [&] {
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSTRING);
+
         len = strlen(str_in);
         cap = len + 1;
-        arr = make_persistent<char[]>(cap);
+        PSTATS_ALLOC(PSTATS_PSTRING, cap);
+        arr = storage::template make<char[]>(cap);
 
         // manually copy the chars over to pmem
         for (int i = 0; i < len; i++) {
@@ -50,9 +56,14 @@ char pstring<ROOT_T>::operator[](int idx) {
 // Output the pstring to the given output stream.
 template <typename ROOT_T>
 std::ostream& operator<<(std::ostream& os, const pstring<ROOT_T>& ps) {
-    // print out chars one by one
-    for (int i = 0; i < ps.len; i++)
-        os << ps.arr[i];
+    PSTATS_OP(PSTATS_PSTRING, "operator<<");
+
+    // a width applies to the string as a whole, as for std::string
+    if (!pdump_sink::reproduces(os))
+        return os << std::string_view(ps.arr.get(), ps.len);
+
+    pdump_sink sink(os);
+    ps.dump(sink);
 
     return os;
 }
@@ -60,13 +71,19 @@ std::ostream& operator<<(std::ostream& os, const pstring<ROOT_T>& ps) {
 // Concatenate the other string onto this one.
 template <typename ROOT_T>
 pstring<ROOT_T>& pstring<ROOT_T>::operator+=(const pstring<ROOT_T>& other) {
+    PSTATS_OP(PSTATS_PSTRING, "operator+=");
+
     // we edit the pmem
-    flat_transaction::run(pop, [&] {
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSTRING);
+        PSTATS_SNAPSHOT(PSTATS_PSTRING, sizeof(arr) + sizeof(len) + sizeof(cap));
+
         // the new capacity is the two lens + space for the '\0'
         auto new_cap = len + other.len + 1;
 
         // allocate new space for the bigger string
-        auto new_str = make_persistent<char[]>(new_cap);
+        PSTATS_ALLOC(PSTATS_PSTRING, new_cap);
+        auto new_str = storage::template make<char[]>(new_cap);
 
         // copy over the current array to the new one
         for (int i = 0; i < len; i++) {
@@ -79,7 +96,8 @@ pstring<ROOT_T>& pstring<ROOT_T>::operator+=(const pstring<ROOT_T>& other) {
         }
 
         // delete the old array
-        delete_persistent<char[]>(arr, cap);
+        PSTATS_FREE(PSTATS_PSTRING, cap);
+        storage::template destroy<char[]>(arr, cap);
 
         // and update these values
         arr = new_str;
@@ -96,15 +114,22 @@ pstring<ROOT_T>& pstring<ROOT_T>::operator+=(const pstring<ROOT_T>& other) {
 // Assign the contents of the other pstring to this one.
 template <typename ROOT_T>
 pstring<ROOT_T>& pstring<ROOT_T>::operator=(const pstring<ROOT_T>& other) {
+    PSTATS_OP(PSTATS_PSTRING, "operator=");
+
     // edit the current pmem
-    flat_transaction::run(pop, [&] {
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSTRING);
+        PSTATS_SNAPSHOT(PSTATS_PSTRING, sizeof(arr) + sizeof(len) + sizeof(cap));
+
         // delete the old array
-        delete_persistent<char[]>(arr, cap);
+        PSTATS_FREE(PSTATS_PSTRING, cap);
+        storage::template destroy<char[]>(arr, cap);
 
         // copy over basic values & allocate new pmem
         len = other.len;
         cap = other.cap;
-        arr = make_persistent<char[]>(cap);
+        PSTATS_ALLOC(PSTATS_PSTRING, cap);
+        arr = storage::template make<char[]>(cap);
 
         // copy all the chars over
         for (int i = 0; i < len; i++) {
@@ -140,20 +165,36 @@ bool pstring<ROOT_T>::is_empty() const {
 
 /* ================================ MISC. ================================== */
 
+// Write the characters to the given sink in one span, straight from pmem.
+template <typename ROOT_T>
+void pstring<ROOT_T>::dump(pdump_sink& sink) const {
+    PSTATS_OP(PSTATS_PSTRING, "dump");
+
+    pdump out(sink);
+    out.put(std::string_view(arr.get(), len));
+    out.flush();
+}
+
 // Refresh the reference to the pool that this object lives in. Must
 // be done when loading this string from an existing pool.
 template <typename ROOT_T>
-void pstring<ROOT_T>::refresh_pool(pool<ROOT_T> new_pop) {
+void pstring<ROOT_T>::refresh_pool(pool_t new_pop) {
     pop = new_pop;
 }
 
 // Completely delete the pmem for this object.
 template <typename ROOT_T>
 void pstring<ROOT_T>::destroy() {
+    PSTATS_OP(PSTATS_PSTRING, "destroy");
+
     // we are destroying this object, so run a transaction
-    flat_transaction::run(pop, [&] {
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSTRING);
+        PSTATS_FREE(PSTATS_PSTRING, cap);
+        PSTATS_FREE(PSTATS_PSTRING, sizeof(pstring<ROOT_T>));
+
         // probably unnecessary, but delete the underlying array first
-        delete_persistent<char[]>(arr, cap);
+        storage::template destroy<char[]>(arr, cap);
 
         // unset these variables
         arr = nullptr;
@@ -161,6 +202,18 @@ void pstring<ROOT_T>::destroy() {
         cap = 0;
 
         // then completely deallocate this object itself 
-        delete_persistent<pstring<ROOT_T>>(this);
+        storage::template destroy<pstring<ROOT_T>>(this);
+    });
+}
+
+// Run the given function as one transaction, e.g. to commit several appends at once.
+template <typename ROOT_T>
+template <typename F>
+void pstring<ROOT_T>::batch(F&& fn) {
+    PSTATS_OP(PSTATS_PSTRING, "batch");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSTRING);
+        fn();
     });
 }
@@ -0,0 +1,102 @@
+#ifndef _PSTRING_COLUMN_H
+#define _PSTRING_COLUMN_H
+
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/transaction.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+#include "../pstats/pstats.h"
+#include "../pstorage/pstorage.h"
+#include "../ptx/ptx.h"
+#include "../ptraits/ptraits.h"
+
+using namespace pmem;
+using namespace pmem::obj;
+
+// set in the end offset of an erased string
+#define PSTRING_COLUMN_ERASED (1ULL << 63)
+// smallest byte capacity allocated for the blob
+#define PSTRING_COLUMN_MIN_BYTES 4096
+
+// An append-only column of strings, packed back to back into one persistent blob with a
+// parallel array of end offsets, so N strings take two allocations instead of 2N
+// pstrings, and a scan reads the blob front to back instead of chasing pointers. Strings
+// are raw bytes and may hold '\0'.
+//
+// operator[] is O(1) and returns a view straight into the blob. A view stays valid until
+// the blob is reallocated by a later append, compact(), shrink() or clear().
+//
+// erase() only marks a string, keeping every index stable, and compact() later squeezes
+// the erased strings out, renumbering the ones after them.
+template <typename ROOT_T>
+class pstring_column {
+public:
+    // where this container lives, picked by ROOT_T (see pstorage)
+    typedef pstorage<ROOT_T> storage;
+    template <typename T>
+    using ptr_t = typename storage::template ptr<T>;
+    typedef typename storage::pool_type pool_t;
+
+private:
+    // every string's bytes, back to back
+    ptr_t<char[]> blob;
+    p<uint64_t> used;
+    p<uint64_t> blob_cap;
+    // offset just past each string in the blob, or'ed with PSTRING_COLUMN_ERASED if erased
+    ptr_t<uint64_t[]> ends;
+    p<int> len;
+    p<int> cap;
+    p<int> erased;
+    pool_t pop;
+
+    uint64_t start_of(int) const;
+    void reserve(int, uint64_t);
+    void reallocate(int, uint64_t);
+    void put(std::string_view);
+
+public:
+    // Constructors
+    pstring_column(pool_t);
+
+    // Operator Overloads
+    std::string_view operator[](int) const;
+
+    // Push/Pop
+    int push_back(std::string_view);
+    template <typename It>
+    void append(It, It);
+    void erase(int);
+
+    // Get/Set
+    int get_length() const;
+    int get_erased() const;
+    bool is_erased(int) const;
+    bool is_empty() const;
+    uint64_t get_bytes() const;
+
+    // Scans
+    template <typename F>
+    void for_each(F&&) const;
+
+    // Misc.
+    template <typename F>
+    void batch(F&&);
+    void refresh_pool(pool_t);
+    void compact();
+    void shrink();
+    void clear();
+    void destroy();
+};
+
+// a pstring_column is pool offsets, counters and a pool handle, so it can be moved bytewise
+template <typename ROOT_T>
+struct is_prelocatable<pstring_column<ROOT_T>> : std::true_type {};
+
+#include "pstring_column.hpp"
+
+#endif
@@ -0,0 +1,391 @@
+#include "pstring_column.h"
+
+/* ========================================================================= */
+/* ***************************** pstring_column **************************** */
+/* ========================================================================= */
+
+/* ============================ CONSTRUCTORS =============================== */
+
+// Create a new, empty column with no capacity.
+template <typename ROOT_T>
+pstring_column<ROOT_T>::pstring_column(pool_t pop_in) {
+    PSTATS_OP(PSTATS_PSTRING_COLUMN, "construct");
+    pop = pop_in;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSTRING_COLUMN);
+
+        blob = nullptr;
+        used = 0;
+        blob_cap = 0;
+        ends = nullptr;
+        len = 0;
+        cap = 0;
+        erased = 0;
+    });
+}
+
+/* ========================== OPERATOR OVERLOADS =========================== */
+
+// Get a view of the string at the given index, pointing straight into the blob.
+template <typename ROOT_T>
+std::string_view pstring_column<ROOT_T>::operator[](int idx) const {
+    if (idx < 0 || idx >= len)
+        throw std::out_of_range("Cannot access past the range of the column.");
+
+    uint64_t end = ends[idx];
+    if (end & PSTRING_COLUMN_ERASED)
+        throw std::out_of_range("Cannot access an erased string.");
+
+    uint64_t start = start_of(idx);
+    return std::string_view(blob.get() + start, end - start);
+}
+
+/* ============================== PUSH/POP ================================= */
+
+// Append a copy of the given string and return its index.
+template <typename ROOT_T>
+int pstring_column<ROOT_T>::push_back(std::string_view str) {
+    PSTATS_OP(PSTATS_PSTRING_COLUMN, "push_back");
+
+    int idx = len;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSTRING_COLUMN);
+        PSTATS_SNAPSHOT(PSTATS_PSTRING_COLUMN, sizeof(used) + sizeof(len));
+
+        reserve(1, str.size());
+        put(str);
+    });
+
+    return idx;
+}
+
+// Append a copy of every string in the given range in one transaction. The range is read
+// twice, once to size the blob and once to copy, so it must be a forward range of
+// anything a std::string_view can be made from. The new bytes and offsets land past the
+// used end of the arrays, so they are flushed on commit but never logged.
+template <typename ROOT_T>
+template <typename It>
+void pstring_column<ROOT_T>::append(It first, It last) {
+    PSTATS_OP(PSTATS_PSTRING_COLUMN, "append");
+
+    int rows = 0;
+    uint64_t bytes = 0;
+
+    for (It it = first; it != last; ++it) {
+        rows++;
+        bytes += std::string_view(*it).size();
+    }
+
+    if (rows == 0)
+        return;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSTRING_COLUMN);
+        PSTATS_SNAPSHOT(PSTATS_PSTRING_COLUMN, sizeof(used) + sizeof(len));
+
+        reserve(rows, bytes);
+
+        char* b = blob.get();
+        uint64_t* e = ends.get() + len;
+        uint64_t at = used;
+
+        storage::fill(b + at, bytes);
+        storage::fill(e, sizeof(uint64_t) * rows);
+
+        for (; first != last; ++first) {
+            std::string_view str(*first);
+
+            memcpy(b + at, str.data(), str.size());
+            at += str.size();
+            *e++ = at;
+        }
+
+        used = at;
+        len = len + rows;
+    });
+}
+
+// Mark the string at the given index as erased. Its bytes stay in the blob, and every
+// index stays the same, until the next compact().
+template <typename ROOT_T>
+void pstring_column<ROOT_T>::erase(int idx) {
+    PSTATS_OP(PSTATS_PSTRING_COLUMN, "erase");
+
+    if (is_erased(idx))
+        return;
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSTRING_COLUMN);
+        PSTATS_SNAPSHOT(PSTATS_PSTRING_COLUMN, sizeof(uint64_t) + sizeof(erased));
+
+        storage::snapshot(&ends[idx]);
+        ends[idx] |= PSTRING_COLUMN_ERASED;
+        erased++;
+    });
+}
+
+/* =============================== GET/SET ================================= */
+
+// Get the number of strings in the column, erased ones included.
+template <typename ROOT_T>
+int pstring_column<ROOT_T>::get_length() const {
+    return len;
+}
+
+// Get the number of erased strings that compact() would remove.
+template <typename ROOT_T>
+int pstring_column<ROOT_T>::get_erased() const {
+    return erased;
+}
+
+// Get whether the string at the given index has been erased.
+template <typename ROOT_T>
+bool pstring_column<ROOT_T>::is_erased(int idx) const {
+    if (idx < 0 || idx >= len)
+        throw std::out_of_range("Cannot access past the range of the column.");
+
+    return (ends[idx] & PSTRING_COLUMN_ERASED) != 0;
+}
+
+// Get whether or not the column is empty.
+template <typename ROOT_T>
+bool pstring_column<ROOT_T>::is_empty() const {
+    return len == 0;
+}
+
+// Get the number of bytes of string data in the blob, erased strings included.
+template <typename ROOT_T>
+uint64_t pstring_column<ROOT_T>::get_bytes() const {
+    return used;
+}
+
+/* ================================= SCANS ================================= */
+
+// Call the given function with a view of every string that is not erased, in order. The
+// blob and the offsets are both read front to back.
+template <typename ROOT_T>
+template <typename F>
+void pstring_column<ROOT_T>::for_each(F&& fn) const {
+    const char* b = blob.get();
+    const uint64_t* e = ends.get();
+    uint64_t start = 0;
+
+    for (int i = 0; i < len; i++) {
+        uint64_t end = e[i] & ~PSTRING_COLUMN_ERASED;
+
+        if (!(e[i] & PSTRING_COLUMN_ERASED))
+            fn(std::string_view(b + start, end - start));
+
+        start = end;
+    }
+}
+
+/* ================================ MISC. ================================== */
+
+// Get the offset of the first byte of the string at the given index.
+template <typename ROOT_T>
+uint64_t pstring_column<ROOT_T>::start_of(int idx) const {
+    return idx == 0 ? 0 : ends[idx - 1] & ~PSTRING_COLUMN_ERASED;
+}
+
+// Make room for the given number of new strings holding the given number of bytes in
+// all, doubling whichever array is too small so appends do not reallocate each time.
+// Must be called inside a transaction.
+template <typename ROOT_T>
+void pstring_column<ROOT_T>::reserve(int rows, uint64_t bytes) {
+    int new_cap = cap;
+    uint64_t new_bytes = blob_cap;
+
+    if (len + rows > cap)
+        new_cap = std::max(len + rows, 2 * (int)cap);
+    if (used + bytes > blob_cap || blob == nullptr)
+        new_bytes = std::max(std::max(used + bytes, 2 * (uint64_t)blob_cap), (uint64_t)PSTRING_COLUMN_MIN_BYTES);
+
+    reallocate(new_cap, new_bytes);
+}
+
+// Move the offsets and the blob into arrays of the given capacities, which must hold
+// everything in use, leaving alone any that already have that capacity. Must be called
+// inside a transaction.
+template <typename ROOT_T>
+void pstring_column<ROOT_T>::reallocate(int new_cap, uint64_t new_bytes) {
+    if (new_cap != cap) {
+        PSTATS_SNAPSHOT(PSTATS_PSTRING_COLUMN, sizeof(ends) + sizeof(cap));
+        PSTATS_ALLOC(PSTATS_PSTRING_COLUMN, sizeof(uint64_t) * new_cap);
+
+        ptr_t<uint64_t[]> arr = nullptr;
+        if (new_cap > 0) {
+            arr = storage::template make<uint64_t[]>(new_cap);
+            if (len > 0)
+                memcpy(arr.get(), ends.get(), sizeof(uint64_t) * len);
+        }
+
+        if (ends != nullptr) {
+            PSTATS_FREE(PSTATS_PSTRING_COLUMN, sizeof(uint64_t) * cap);
+            storage::template destroy<uint64_t[]>(ends, cap);
+        }
+
+        ends = arr;
+        cap = new_cap;
+    }
+
+    if (new_bytes != blob_cap) {
+        PSTATS_SNAPSHOT(PSTATS_PSTRING_COLUMN, sizeof(blob) + sizeof(blob_cap));
+        PSTATS_ALLOC(PSTATS_PSTRING_COLUMN, new_bytes);
+
+        ptr_t<char[]> arr = nullptr;
+        if (new_bytes > 0) {
+            arr = storage::template make<char[]>(new_bytes);
+            if (used > 0)
+                memcpy(arr.get(), blob.get(), used);
+        }
+
+        if (blob != nullptr) {
+            PSTATS_FREE(PSTATS_PSTRING_COLUMN, blob_cap);
+            storage::template destroy<char[]>(blob, blob_cap);
+        }
+
+        blob = arr;
+        blob_cap = new_bytes;
+    }
+}
+
+// Copy the given string past the end of the blob and record its end. There must be room
+// for it. Must be called inside a transaction.
+template <typename ROOT_T>
+void pstring_column<ROOT_T>::put(std::string_view str) {
+    char* dst = blob.get() + used;
+    uint64_t* end = &ends[len];
+
+    storage::fill(dst, str.size());
+    memcpy(dst, str.data(), str.size());
+
+    storage::fill(end, sizeof(uint64_t));
+    *end = used + str.size();
+
+    used = used + str.size();
+    len++;
+}
+
+// Run the given function as one transaction, so the rows added inside it commit together.
+template <typename ROOT_T>
+template <typename F>
+void pstring_column<ROOT_T>::batch(F&& fn) {
+    PSTATS_OP(PSTATS_PSTRING_COLUMN, "batch");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSTRING_COLUMN);
+        fn();
+    });
+}
+
+// Refresh the reference to the pool that this column lives in. Must be called when using
+// a pstring_column from an existing file.
+template <typename ROOT_T>
+void pstring_column<ROOT_T>::refresh_pool(pool_t new_pop) {
+    pop = new_pop;
+}
+
+// Remove every erased string, renumbering the ones after them, and trim both arrays to
+// what is left. The survivors are copied into fresh arrays, which need no logging, so the
+// transaction stays small however big the column is.
+template <typename ROOT_T>
+void pstring_column<ROOT_T>::compact() {
+    PSTATS_OP(PSTATS_PSTRING_COLUMN, "compact");
+
+    if (erased == 0)
+        return;
+
+    int rows = 0;
+    uint64_t bytes = 0;
+    uint64_t start = 0;
+
+    for (int i = 0; i < len; i++) {
+        uint64_t end = ends[i] & ~PSTRING_COLUMN_ERASED;
+
+        if (!(ends[i] & PSTRING_COLUMN_ERASED)) {
+            rows++;
+            bytes += end - start;
+        }
+
+        start = end;
+    }
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSTRING_COLUMN);
+        PSTATS_SNAPSHOT(PSTATS_PSTRING_COLUMN, sizeof(blob) + sizeof(ends) + sizeof(used) +
+                                                 sizeof(blob_cap) + sizeof(len) + sizeof(cap) +
+                                                 sizeof(erased));
+        PSTATS_ALLOC(PSTATS_PSTRING_COLUMN, sizeof(uint64_t) * rows + bytes);
+
+        ptr_t<uint64_t[]> new_ends = rows > 0 ? storage::template make<uint64_t[]>(rows) : nullptr;
+        ptr_t<char[]> new_blob = bytes > 0 ? storage::template make<char[]>(bytes) : nullptr;
+
+        int r = 0;
+        uint64_t at = 0;
+
+        for_each([&](std::string_view str) {
+            if (!str.empty())
+                memcpy(new_blob.get() + at, str.data(), str.size());
+            at += str.size();
+            new_ends[r++] = at;
+        });
+
+        PSTATS_FREE(PSTATS_PSTRING_COLUMN, sizeof(uint64_t) * cap + blob_cap);
+        if (ends != nullptr)
+            storage::template destroy<uint64_t[]>(ends, cap);
+        if (blob != nullptr)
+            storage::template destroy<char[]>(blob, blob_cap);
+
+        ends = new_ends;
+        blob = new_blob;
+        len = rows;
+        cap = rows;
+        used = bytes;
+        blob_cap = bytes;
+        erased = 0;
+    });
+}
+
+// Trim both arrays to what is in use, removing unused allocated space.
+template <typename ROOT_T>
+void pstring_column<ROOT_T>::shrink() {
+    PSTATS_OP(PSTATS_PSTRING_COLUMN, "shrink");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSTRING_COLUMN);
+        reallocate(len, used);
+    });
+}
+
+// Remove and deallocate every string in the column.
+template <typename ROOT_T>
+void pstring_column<ROOT_T>::clear() {
+    PSTATS_OP(PSTATS_PSTRING_COLUMN, "clear");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSTRING_COLUMN);
+        PSTATS_SNAPSHOT(PSTATS_PSTRING_COLUMN, sizeof(len) + sizeof(used) + sizeof(erased));
+
+        len = 0;
+        used = 0;
+        erased = 0;
+        reallocate(0, 0);
+    });
+}
+
+// Completely destroy this object and its allocated memory.
+template <typename ROOT_T>
+void pstring_column<ROOT_T>::destroy() {
+    PSTATS_OP(PSTATS_PSTRING_COLUMN, "destroy");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PSTRING_COLUMN);
+        PSTATS_FREE(PSTATS_PSTRING_COLUMN, sizeof(pstring_column<ROOT_T>));
+
+        clear();
+        storage::template destroy<pstring_column<ROOT_T>>(this);
+    });
+}
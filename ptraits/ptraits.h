@@ -0,0 +1,13 @@
+#ifndef _PTRAITS_H
+#define _PTRAITS_H
+
+#include <type_traits>
+
+// Whether a value of type T can be moved to a new address with a plain memcpy, after which
+// the old bytes can be dropped without running anything. True for trivially copyable types.
+// The collections specialize it for themselves: their members are offsets into the pool
+// (persistent_ptr), plain values (p<>) and a pool handle, none of which care where they live.
+template <typename T>
+struct is_prelocatable : std::is_trivially_copyable<T> {};
+
+#endif
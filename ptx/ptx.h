@@ -0,0 +1,38 @@
+#ifndef _PTX_H
+#define _PTX_H
+
+#include <libpmemobj++/mutex.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+#include <stdexcept>
+#include "../pstats/pstats.h"
+
+using namespace pmem;
+using namespace pmem::obj;
+
+// the pool of containers kept on the heap (see pstorage)
+class pdram_pool;
+
+// Transaction helpers shared by the collections. Every container runs its pmem edits
+// through ptx::run, so an operation called inside an already open transaction (a batch,
+// or another container's operation) on the same pool writes straight into that
+// transaction instead of paying for a nested begin/commit of its own. Joining from
+// another pool is an error, as a transaction only covers one pool.
+class ptx {
+private:
+    // the pool of the transaction the outermost ptx::run on this thread opened, if any
+    static inline thread_local PMEMobjpool* open_pool = nullptr;
+
+public:
+    template <typename F>
+    static void run(pool_base&, F&&);
+    template <typename F>
+    static void run(const pdram_pool&, F&&);
+
+    static void lock(pmem::obj::mutex&);
+    static bool in_tx();
+};
+
+#include "ptx.hpp"
+
+#endif
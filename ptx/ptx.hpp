@@ -0,0 +1,57 @@
+#include "ptx.h"
+
+/* ========================================================================= */
+/* ********************************** ptx ********************************** */
+/* ========================================================================= */
+
+// Run the given function in a transaction on the given pool. If this thread already
+// has a transaction open, the function runs directly as part of it: an exception still
+// propagates out to that transaction and aborts it, exactly as a flattened nested
+// transaction would. Throws if that transaction was opened here for another pool; one
+// opened directly with flat_transaction is taken to be on the right one.
+template <typename F>
+void ptx::run(pool_base& pop, F&& fn) {
+    bool outermost = !in_tx();
+    PSTATS_TX_ENTRY(outermost);
+
+    if (!outermost) {
+        if (open_pool != nullptr && open_pool != pop.handle())
+            throw std::logic_error("Cannot join a transaction open on another pool.");
+
+        fn();
+        return;
+    }
+
+    open_pool = pop.handle();
+
+    try {
+        flat_transaction::run(pop, fn);
+    }
+    catch (...) {
+        open_pool = nullptr;
+        throw;
+    }
+
+    open_pool = nullptr;
+}
+
+// Run the given function for a container on the heap, which has nothing to log or roll
+// back, so it simply runs. It opens no transaction, so it is counted as joining one.
+template <typename F>
+void ptx::run(const pdram_pool&, F&& fn) {
+    PSTATS_TX_ENTRY(false);
+    fn();
+}
+
+// Lock the given mutex until the transaction open on this thread commits or aborts, so no
+// other thread can see or log what this one changed under it in the meantime. Locking a
+// mutex the transaction already holds does nothing.
+inline void ptx::lock(pmem::obj::mutex& m) {
+    if (pmemobj_tx_lock(TX_PARAM_MUTEX, m.native_handle()) != 0)
+        throw std::runtime_error("Failed to lock a mutex for the transaction.");
+}
+
+// Get whether this thread currently has a transaction open.
+inline bool ptx::in_tx() {
+    return pmemobj_tx_stage() == TX_STAGE_WORK;
+}
@@ -4,12 +4,39 @@
 #include <libpmemobj++/make_persistent.hpp>
 #include <libpmemobj++/persistent_ptr.hpp>
 #include <libpmemobj++/transaction.hpp>
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <new>
+#include <numeric>
+#include <optional>
 #include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../pdump/pdump.h"
+#include "../preclaim/preclaim.h"
+#include "../pstats/pstats.h"
+#include "../pstorage/pstorage.h"
+#include "../ptx/ptx.h"
+#include "../ptraits/ptraits.h"
 
 using namespace pmem;
 using namespace pmem::obj;
 
+// fewest items each thread of a parallel sort gets, below which threads cost more than
+// they save
+#define PVECTOR_SORT_GRAIN (1 << 16)
+
+// bulk export/import, the integrity checker and read-only views read the storage directly
+class pstream;
+class pcheck;
+template <typename ROOT_T>
+class pview;
+
 // forward declare class
 template <typename VAL_T, typename ROOT_T>
 class pvector;
@@ -20,40 +47,83 @@ std::ostream& operator<<(std::ostream&, const pvector<VAL_T, ROOT_T>&);
 
 template <typename VAL_T, typename ROOT_T>
 class pvector {
+public:
+    // where this container lives, picked by ROOT_T (see pstorage)
+    typedef pstorage<ROOT_T> storage;
+    template <typename T>
+    using ptr_t = typename storage::template ptr<T>;
+    typedef typename storage::pool_type pool_t;
+
 private:
-    persistent_ptr<VAL_T[]> arr;
+    ptr_t<VAL_T[]> arr;
     p<int> len;
     p<int> cap;
-    pool<ROOT_T> pop;
+    pool_t pop;
 
     void resize(int);
+    void relocate(VAL_T*, VAL_T*, int);
+    template <typename... Args>
+    void construct_at(int, Args&&...);
+    template <typename COMP_T>
+    void sort_items(COMP_T&, bool);
+    template <typename T, typename COMP_T>
+    static void sort_range(T*, int, COMP_T&, bool);
+
+    friend class pstream;
+    friend class pcheck;
+    template <typename>
+    friend class pview;
 
 public:
     // Constructors
-    pvector(pool<ROOT_T>);
-    pvector(pool<ROOT_T>, int);
+    pvector(pool_t);
+    pvector(pool_t, int);
 
     // Operator Overloads
+    VAL_T& operator[](int);
+    const VAL_T& operator[](int) const;
     friend std::ostream& operator<< <>(std::ostream&, const pvector<VAL_T, ROOT_T>&);
 
     // Push/Pop
     void push_back(const VAL_T&);
+    void push_back(VAL_T&&);
+    template <typename... Args>
+    void emplace_back(Args&&...);
     VAL_T pop_back();
 
     void insert(const VAL_T&, int);
+    void insert(VAL_T&&, int);
+    template <typename... Args>
+    void emplace(int, Args&&...);
     VAL_T remove(int);
 
     // Get/Set
     int get_length() const;
     int get_capacity() const;
 
+    // Sorts
+    template <typename COMP_T = std::less<VAL_T>>
+    void sort(COMP_T comp = COMP_T());
+    template <typename COMP_T = std::less<VAL_T>>
+    void stable_sort(COMP_T comp = COMP_T());
+
     // Misc.
-    void refresh_pool(pool<ROOT_T>);
+    template <typename F>
+    void batch(F&&);
+    void dump(pdump_sink&, int threads = 1) const;
+    void refresh_pool(pool_t);
+    void reserve(int);
     void shrink();
     void clear();
+    void clear(preclaim&);
     void destroy();
+    void destroy(preclaim&);
 };
 
+// a pvector is just a pool offset, two ints and a pool handle, so it can be moved bytewise
+template <typename VAL_T, typename ROOT_T>
+struct is_prelocatable<pvector<VAL_T, ROOT_T>> : std::true_type {};
+
 #include "pvector.hpp"
 
 #endif
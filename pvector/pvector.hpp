@@ -8,11 +8,13 @@
 
 // Create a new, empty pvector with no capacity. 
 template <typename VAL_T, typename ROOT_T>
-pvector<VAL_T, ROOT_T>::pvector(pool<ROOT_T> pop_in) {
+pvector<VAL_T, ROOT_T>::pvector(pool_t pop_in) {
+    PSTATS_OP(PSTATS_PVECTOR, "construct");
     pop = pop_in;
 
     // we have no capacity, so set to nullptr instead of allocating
-    flat_transaction::run(pop, [&] {
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PVECTOR);
         arr = nullptr;
         len = 0;
         cap = 0;
@@ -21,12 +23,15 @@ pvector<VAL_T, ROOT_T>::pvector(pool<ROOT_T> pop_in) {
 
 // Create a new, empty pvector with the given capacity.
 template <typename VAL_T, typename ROOT_T>
-pvector<VAL_T, ROOT_T>::pvector(pool<ROOT_T> pop_in, int capacity) {
+pvector<VAL_T, ROOT_T>::pvector(pool_t pop_in, int capacity) {
+    PSTATS_OP(PSTATS_PVECTOR, "construct");
     pop = pop_in;
 
     // edit pmem with a transaction
-    flat_transaction::run(pop, [&] {
-        arr = make_persistent<VAL_T[]>(capacity);
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PVECTOR);
+        PSTATS_ALLOC(PSTATS_PVECTOR, sizeof(VAL_T) * capacity);
+        arr = storage::template make<VAL_T[]>(capacity);
         len = 0;
         cap = capacity;
     });
@@ -34,18 +39,43 @@ pvector<VAL_T, ROOT_T>::pvector(pool<ROOT_T> pop_in, int capacity) {
 
 /* ========================== OPERATOR OVERLOADS =========================== */
 
-// Print this vector to the given output stream.
+// Get a reference to the item at the given index. Writes through the reference
+// must happen inside a transaction.
+template <typename VAL_T, typename ROOT_T>
+VAL_T& pvector<VAL_T, ROOT_T>::operator[](int idx) {
+    if (idx < 0 || idx >= len)
+        throw std::out_of_range("Cannot access past the range of the vector.");
+
+    return arr[idx];
+}
+
+// Get a read-only reference to the item at the given index.
+template <typename VAL_T, typename ROOT_T>
+const VAL_T& pvector<VAL_T, ROOT_T>::operator[](int idx) const {
+    if (idx < 0 || idx >= len)
+        throw std::out_of_range("Cannot access past the range of the vector.");
+
+    return arr[idx];
+}
+
+// Print this vector to the given output stream. Numbers are formatted in bulk (see pdump)
+// unless the stream has settings that only its own operator<< applies.
 template <typename VAL_T, typename ROOT_T>
 std::ostream& operator<<(std::ostream& os, const pvector<VAL_T, ROOT_T>& v) {
-    os << "[";
+    PSTATS_OP(PSTATS_PVECTOR, "operator<<");
 
-    for (int i = 0; i < v.len - 1; i++) {
-        os << v.arr[i] << ", ";
+    if (std::is_arithmetic<VAL_T>::value && pdump_sink::reproduces(os)) {
+        pdump_sink sink(os);
+        v.dump(sink);
+        return os;
     }
 
-    if (v.len > 0)
-        os << v.arr[v.len - 1];
-
+    os << "[";
+    for (int i = 0; i < v.len; i++) {
+        if (i > 0)
+            os << ", ";
+        os << v.arr[i];
+    }
     os << "]";
 
     return os;
@@ -56,15 +86,36 @@ std::ostream& operator<<(std::ostream& os, const pvector<VAL_T, ROOT_T>& v) {
 // Insert the given value at the back of the vector, reallocating if necessary.
 template <typename VAL_T, typename ROOT_T>
 void pvector<VAL_T, ROOT_T>::push_back(const VAL_T& val) {
-    flat_transaction::run(pop, [&] {
-        if (len < cap) {
-            arr[len] = val;
-        }
-        else {
-            // reallocate and such
-            resize(cap + 1);
-            arr[len] = val;
-        }
+    PSTATS_OP(PSTATS_PVECTOR, "push_back");
+
+    emplace_back(val);
+}
+
+// Move the given value onto the back of the vector, reallocating if necessary.
+template <typename VAL_T, typename ROOT_T>
+void pvector<VAL_T, ROOT_T>::push_back(VAL_T&& val) {
+    PSTATS_OP(PSTATS_PVECTOR, "push_back");
+
+    emplace_back(std::move(val));
+}
+
+// Construct a new item at the back of the vector from the given arguments, directly in
+// its slot in pmem, reallocating if necessary.
+template <typename VAL_T, typename ROOT_T>
+template <typename... Args>
+void pvector<VAL_T, ROOT_T>::emplace_back(Args&&... args) {
+    PSTATS_OP(PSTATS_PVECTOR, "emplace_back");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PVECTOR);
+        PSTATS_SNAPSHOT(PSTATS_PVECTOR, sizeof(VAL_T) + sizeof(len));
+
+        // double the capacity if we are full, so pushes stay amortized O(1)
+        if (len >= cap)
+            reserve(std::max(2 * (int)cap, 1));
+
+        storage::snapshot(&arr[len]);
+        construct_at(len, std::forward<Args>(args)...);
 
         len++;
     });
@@ -73,38 +124,62 @@ void pvector<VAL_T, ROOT_T>::push_back(const VAL_T& val) {
 // Remove and return the value at the back of the vector.
 template <typename VAL_T, typename ROOT_T>
 VAL_T pvector<VAL_T, ROOT_T>::pop_back() {
+    PSTATS_OP(PSTATS_PVECTOR, "pop_back");
+
     if (len == 0)
         throw std::out_of_range("Cannot pop the back of an empty vector.");
 
-    len--;
+    // shrinking the length edits pmem too, so it belongs in the caller's batch if any
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PVECTOR);
+        PSTATS_SNAPSHOT(PSTATS_PVECTOR, sizeof(len));
+
+        len--;
+    });
+
     return arr[len];
 }
 
 // Insert the given value at the given index, reallocating if necessary.
 template <typename VAL_T, typename ROOT_T>
 void pvector<VAL_T, ROOT_T>::insert(const VAL_T& val, int idx) {
+    PSTATS_OP(PSTATS_PVECTOR, "insert");
+
+    emplace(idx, val);
+}
+
+// Move the given value into the given index, reallocating if necessary.
+template <typename VAL_T, typename ROOT_T>
+void pvector<VAL_T, ROOT_T>::insert(VAL_T&& val, int idx) {
+    PSTATS_OP(PSTATS_PVECTOR, "insert");
+
+    emplace(idx, std::move(val));
+}
+
+// Construct a new item at the given index from the given arguments, directly in its slot
+// in pmem, shifting later items back and reallocating if necessary.
+template <typename VAL_T, typename ROOT_T>
+template <typename... Args>
+void pvector<VAL_T, ROOT_T>::emplace(int idx, Args&&... args) {
+    PSTATS_OP(PSTATS_PVECTOR, "emplace");
+
     if (idx < 0 || idx > len) 
         throw std::out_of_range("Cannot insert past the range of the vector.");
     
     // we edit the pmem
-    flat_transaction::run(pop, [&] {
-        // resize array to 1 larger if we are at capacity
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PVECTOR);
+        PSTATS_SNAPSHOT(PSTATS_PVECTOR, sizeof(VAL_T) * (len - idx + 1) + sizeof(len));
+
+        // double the array's capacity if we are at capacity
         if (len >= cap)
-            resize(cap + 1);   
-
-        // iterate backwards, moving items forward until we hit the target index
-        for (int i = len; i >= 0; i--) {
-            // if we have hit insertion index, set item to be the given value
-            if (i == idx) {
-                arr[i] = val;
-                // we break as we do not need to edit the items before this in the list
-                break;
-            }
-            // otherwise, make current item be the one that used to be one previous 
-            else {
-              arr[i] = arr[i - 1];
-            }
-        }
+            reserve(std::max(2 * (int)cap, 1));
+
+        // log every slot we touch, then move the items after the index back by one
+        storage::snapshot(&arr[idx], len - idx + 1);
+        relocate(&arr[idx + 1], &arr[idx], len - idx);
+
+        construct_at(idx, std::forward<Args>(args)...);
 
         // we inserted an item, so increase the length
         len++;
@@ -114,23 +189,29 @@ void pvector<VAL_T, ROOT_T>::insert(const VAL_T& val, int idx) {
 // Remove the item at the given index and return the removed value.
 template <typename VAL_T, typename ROOT_T>
 VAL_T pvector<VAL_T, ROOT_T>::remove(int idx) {
+    PSTATS_OP(PSTATS_PVECTOR, "remove");
+
     if (idx < 0 || idx >= len)
         throw std::out_of_range("Cannot remove past the range of the vector.");
 
-    auto val = arr[idx];
+    std::optional<VAL_T> val;
 
     // we will edit the pmem
-    flat_transaction::run(pop, [&] {
-        len--;
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PVECTOR);
+        PSTATS_SNAPSHOT(PSTATS_PVECTOR, sizeof(VAL_T) * (len - idx) + sizeof(len));
 
-        // starting at removal index, step over each item
-        for (int i = idx; i < len; i++) {
-            // move all items down one
-            arr[i] = arr[i + 1];
-        }
+        // log every slot we touch before moving the removed item out of its slot
+        storage::snapshot(&arr[idx], len - idx);
+        val.emplace(std::move(arr[idx]));
+
+        // then move all items after the index down one
+        relocate(&arr[idx], &arr[idx + 1], len - idx - 1);
+
+        len--;
     });
 
-    return val;
+    return std::move(*val);
 }
 
 /* =============================== GET/SET ================================= */
@@ -147,12 +228,66 @@ int pvector<VAL_T, ROOT_T>::get_capacity() const {
     return cap;
 }
 
+/* ================================ SORTS ================================== */
+
+// Sort the items by the given comparator, equal items ending up in any order. The items
+// are sorted in DRAM on every core, then written once into a fresh array that replaces
+// the old one on commit, so a crash leaves either the old order or the new one and the
+// log only ever holds the pointer and never the items.
+template <typename VAL_T, typename ROOT_T>
+template <typename COMP_T>
+void pvector<VAL_T, ROOT_T>::sort(COMP_T comp) {
+    PSTATS_OP(PSTATS_PVECTOR, "sort");
+
+    sort_items(comp, false);
+}
+
+// Sort the items by the given comparator, keeping equal items in the order they were in.
+// Otherwise the same as sort().
+template <typename VAL_T, typename ROOT_T>
+template <typename COMP_T>
+void pvector<VAL_T, ROOT_T>::stable_sort(COMP_T comp) {
+    PSTATS_OP(PSTATS_PVECTOR, "stable_sort");
+
+    sort_items(comp, true);
+}
+
 /* ================================ MISC. ================================== */
 
+// Write the items as text to the given sink, as "[a, b, c]" like operator<<. With more
+// than one thread, a long vector is formatted a chunk per thread at a time (see pdump).
+template <typename VAL_T, typename ROOT_T>
+void pvector<VAL_T, ROOT_T>::dump(pdump_sink& sink, int threads) const {
+    PSTATS_OP(PSTATS_PVECTOR, "dump");
+
+    const VAL_T* items = arr.get();
+
+    auto format = [&](pdump& out, int lo, int hi) {
+        for (int i = lo; i < hi; i++) {
+            if (i > 0)
+                out.put(", ");
+            out.put_value(items[i]);
+        }
+    };
+
+    if (threads <= 1 || len <= PDUMP_GRAIN) {
+        pdump out(sink);
+        out.put('[');
+        format(out, 0, len);
+        out.put(']');
+        out.flush();
+        return;
+    }
+
+    sink.write("[", 1);
+    pdump::parallel(sink, len, threads, format);
+    sink.write("]", 1);
+}
+
 // Refresh the reference to the pool that this vector lives in. Must be called
 // when using a pvector from an existing file (e.g. not just created at runtime).
 template <typename VAL_T, typename ROOT_T>
-void pvector<VAL_T, ROOT_T>::refresh_pool(pool<ROOT_T> new_pop) {
+void pvector<VAL_T, ROOT_T>::refresh_pool(pool_t new_pop) {
     pop = new_pop;
 }
 
@@ -160,18 +295,23 @@ void pvector<VAL_T, ROOT_T>::refresh_pool(pool<ROOT_T> new_pop) {
 // current length, values will be lost.
 template <typename VAL_T, typename ROOT_T>
 void pvector<VAL_T, ROOT_T>::resize(int new_cap) {
+    PSTATS_OP(PSTATS_PVECTOR, "resize");
+
     // we will allocate & free pmem, so use a transaction
-    flat_transaction::run(pop, [&] {
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PVECTOR);
+        PSTATS_SNAPSHOT(PSTATS_PVECTOR, sizeof(arr) + sizeof(len) + sizeof(cap));
+
         // allocate the new array w/ appropriate capacity
-        persistent_ptr<VAL_T[]> new_arr = make_persistent<VAL_T[]>(new_cap);
+        PSTATS_ALLOC(PSTATS_PVECTOR, sizeof(VAL_T) * new_cap);
+        ptr_t<VAL_T[]> new_arr = storage::template make<VAL_T[]>(new_cap);
 
-        // move all the items over
-        for (int i = 0; i < len && i < new_cap; i++) {
-            new_arr[i] = arr[i];
-        }
+        // move all the items over without copying them
+        relocate(new_arr.get(), arr.get(), len < new_cap ? (int)len : new_cap);
 
         // delete the old array
-        delete_persistent<VAL_T[]>(arr, cap);
+        PSTATS_FREE(PSTATS_PVECTOR, sizeof(VAL_T) * cap);
+        storage::template destroy<VAL_T[]>(arr, cap);
 
         // set our array to the new one
         arr = new_arr;
@@ -185,17 +325,71 @@ void pvector<VAL_T, ROOT_T>::resize(int new_cap) {
     });
 }
 
+// Move n items from src to dst, which may overlap. Items that are relocatable are moved
+// bytewise, which also keeps nested collections from being rebuilt; others are move
+// assigned in whichever direction is safe. Both ranges must already be in the transaction
+// (logged, or freshly allocated in it).
+template <typename VAL_T, typename ROOT_T>
+void pvector<VAL_T, ROOT_T>::relocate(VAL_T* dst, VAL_T* src, int n) {
+    if (n <= 0 || dst == src)
+        return;
+
+    if (is_prelocatable<VAL_T>::value) {
+        memmove((void*)dst, (const void*)src, sizeof(VAL_T) * n);
+    }
+    else if (dst < src) {
+        for (int i = 0; i < n; i++)
+            dst[i] = std::move(src[i]);
+    }
+    else {
+        for (int i = n - 1; i >= 0; i--)
+            dst[i] = std::move(src[i]);
+    }
+}
+
+// Construct an item in place at the given slot, which must already be in the transaction.
+// Relocatable slots may hold a stale bytewise copy of a moved item, so they are not
+// destroyed first.
+template <typename VAL_T, typename ROOT_T>
+template <typename... Args>
+void pvector<VAL_T, ROOT_T>::construct_at(int idx, Args&&... args) {
+    VAL_T* slot = &arr[idx];
+
+    if (!is_prelocatable<VAL_T>::value)
+        slot->~VAL_T();
+
+    new (slot) VAL_T(std::forward<Args>(args)...);
+}
+
+// Grow the vector's capacity to at least the given number of items, so that many
+// push_backs will not reallocate.
+template <typename VAL_T, typename ROOT_T>
+void pvector<VAL_T, ROOT_T>::reserve(int new_cap) {
+    PSTATS_OP(PSTATS_PVECTOR, "reserve");
+
+    if (new_cap > cap)
+        resize(new_cap);
+}
+
 // Shrink the vector's capacity to its current size, removing unused allocated space.
 template <typename VAL_T, typename ROOT_T>
 void pvector<VAL_T, ROOT_T>::shrink() {
+    PSTATS_OP(PSTATS_PVECTOR, "shrink");
+
     resize(len);
 }
 
 // Remove and deallocate all the items in the vector.
 template <typename VAL_T, typename ROOT_T>
 void pvector<VAL_T, ROOT_T>::clear() {
-    flat_transaction::run(pop, [&] {
-        delete_persistent<VAL_T[]>(arr, cap);
+    PSTATS_OP(PSTATS_PVECTOR, "clear");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PVECTOR);
+        PSTATS_SNAPSHOT(PSTATS_PVECTOR, sizeof(arr) + sizeof(len) + sizeof(cap));
+        PSTATS_FREE(PSTATS_PVECTOR, sizeof(VAL_T) * cap);
+
+        storage::template destroy<VAL_T[]>(arr, cap);
 
         arr = nullptr;
         len = 0;
@@ -203,12 +397,213 @@ void pvector<VAL_T, ROOT_T>::clear() {
     });
 }
 
+// Remove all the items in O(1), deferring the array to the given reclamation list along
+// with any chains of nodes its items root, e.g. the buckets of a hashtable (see
+// preclaim). A vector on the heap has no log to outgrow, so it is simply cleared.
+template <typename VAL_T, typename ROOT_T>
+void pvector<VAL_T, ROOT_T>::clear(preclaim& trash) {
+    PSTATS_OP(PSTATS_PVECTOR, "clear");
+
+    if constexpr (std::is_same<ROOT_T, pdram>::value) {
+        clear();
+    }
+    else {
+        ptx::run(pop, [&] {
+            PSTATS_TX(PSTATS_PVECTOR);
+            PSTATS_SNAPSHOT(PSTATS_PVECTOR, sizeof(arr) + sizeof(len) + sizeof(cap));
+            PSTATS_FREE(PSTATS_PVECTOR, sizeof(VAL_T) * cap);
+
+            trash.defer(arr, len);
+
+            arr = nullptr;
+            len = 0;
+            cap = 0;
+        });
+    }
+}
+
 // Completely destroy this object and its allocated memory.
 template <typename VAL_T, typename ROOT_T>
 void pvector<VAL_T, ROOT_T>::destroy() {
+    PSTATS_OP(PSTATS_PVECTOR, "destroy");
+
     clear();
 
-    flat_transaction::run(pop, [&] {
-        delete_persistent<pvector<VAL_T, ROOT_T>>(this);
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PVECTOR);
+        PSTATS_FREE(PSTATS_PVECTOR, sizeof(pvector<VAL_T, ROOT_T>));
+
+        storage::template destroy<pvector<VAL_T, ROOT_T>>(this);
+    });
+}
+
+// Destroy this object in O(1), deferring its array to the given reclamation list.
+template <typename VAL_T, typename ROOT_T>
+void pvector<VAL_T, ROOT_T>::destroy(preclaim& trash) {
+    PSTATS_OP(PSTATS_PVECTOR, "destroy");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PVECTOR);
+        PSTATS_FREE(PSTATS_PVECTOR, sizeof(pvector<VAL_T, ROOT_T>));
+
+        clear(trash);
+        storage::template destroy<pvector<VAL_T, ROOT_T>>(this);
     });
-}
\ No newline at end of file
+}
+
+// Sort the items, stably or not. A vector on the heap is sorted in place. Otherwise items
+// that can be copied bytewise are sorted as a DRAM copy, and any others by sorting their
+// indexes and then moving each item to its place, and either way the result goes into a
+// fresh array, which needs no logging.
+template <typename VAL_T, typename ROOT_T>
+template <typename COMP_T>
+void pvector<VAL_T, ROOT_T>::sort_items(COMP_T& comp, bool stable) {
+    if (len < 2)
+        return;
+
+    if constexpr (std::is_same<ROOT_T, pdram>::value) {
+        sort_range(arr.get(), len, comp, stable);
+    }
+    else if constexpr (std::is_trivially_copyable<VAL_T>::value) {
+        std::vector<VAL_T> items(arr.get(), arr.get() + len);
+        sort_range(items.data(), len, comp, stable);
+
+        ptx::run(pop, [&] {
+            PSTATS_TX(PSTATS_PVECTOR);
+            PSTATS_SNAPSHOT(PSTATS_PVECTOR, sizeof(arr));
+            PSTATS_ALLOC(PSTATS_PVECTOR, sizeof(VAL_T) * cap);
+
+            ptr_t<VAL_T[]> new_arr = storage::template make<VAL_T[]>(cap);
+            memcpy((void*)new_arr.get(), (const void*)items.data(), sizeof(VAL_T) * len);
+
+            PSTATS_FREE(PSTATS_PVECTOR, sizeof(VAL_T) * cap);
+            storage::template destroy<VAL_T[]>(arr, cap);
+            arr = new_arr;
+        });
+    }
+    else {
+        VAL_T* items = arr.get();
+        std::vector<int> order(len);
+        std::iota(order.begin(), order.end(), 0);
+
+        auto by_item = [&](int a, int b) { return comp(items[a], items[b]); };
+        sort_range(order.data(), len, by_item, stable);
+
+        ptx::run(pop, [&] {
+            PSTATS_TX(PSTATS_PVECTOR);
+            PSTATS_SNAPSHOT(PSTATS_PVECTOR, sizeof(arr));
+            PSTATS_ALLOC(PSTATS_PVECTOR, sizeof(VAL_T) * cap);
+
+            ptr_t<VAL_T[]> new_arr = storage::template make<VAL_T[]>(cap);
+            VAL_T* dst = new_arr.get();
+
+            // moving out of an item changes it, so the old array must be restorable
+            if (!is_prelocatable<VAL_T>::value) {
+                PSTATS_SNAPSHOT(PSTATS_PVECTOR, sizeof(VAL_T) * len);
+                storage::snapshot(items, len);
+            }
+
+            for (int i = 0; i < len; i++) {
+                if (is_prelocatable<VAL_T>::value)
+                    memcpy((void*)(dst + i), (const void*)(items + order[i]), sizeof(VAL_T));
+                else
+                    dst[i] = std::move(items[order[i]]);
+            }
+
+            PSTATS_FREE(PSTATS_PVECTOR, sizeof(VAL_T) * cap);
+            storage::template destroy<VAL_T[]>(arr, cap);
+            arr = new_arr;
+        });
+    }
+}
+
+// Sort the given DRAM array of n items in place. Large arrays are cut into one part per
+// core (a power of two of them, each at least PVECTOR_SORT_GRAIN items), the parts are
+// sorted on their own threads, and then merged pairwise, also in parallel, through a
+// buffer. Merging keeps equal items of the left part first, so stable parts merge stably.
+template <typename VAL_T, typename ROOT_T>
+template <typename T, typename COMP_T>
+void pvector<VAL_T, ROOT_T>::sort_range(T* items, int n, COMP_T& comp, bool stable) {
+    int parts = 1;
+    int cores = (int)std::thread::hardware_concurrency();
+
+    while (parts * 2 <= cores && (long)n / (parts * 2) >= PVECTOR_SORT_GRAIN)
+        parts *= 2;
+
+    if (parts == 1) {
+        if (stable)
+            std::stable_sort(items, items + n, comp);
+        else
+            std::sort(items, items + n, comp);
+        return;
+    }
+
+    std::vector<int> bounds(parts + 1);
+    for (int i = 0; i <= parts; i++)
+        bounds[i] = (int)((long)n * i / parts);
+
+    // run fn(i) for every i below count on threads of its own, rethrowing the first failure
+    auto parallel = [](int count, auto&& fn) {
+        std::vector<std::thread> threads;
+        std::vector<std::exception_ptr> failures(count);
+
+        for (int i = 0; i < count; i++) {
+            threads.emplace_back([&, i] {
+                try {
+                    fn(i);
+                }
+                catch (...) {
+                    failures[i] = std::current_exception();
+                }
+            });
+        }
+
+        for (auto& t : threads)
+            t.join();
+
+        for (auto& f : failures) {
+            if (f)
+                std::rethrow_exception(f);
+        }
+    };
+
+    parallel(parts, [&](int i) {
+        if (stable)
+            std::stable_sort(items + bounds[i], items + bounds[i + 1], comp);
+        else
+            std::sort(items + bounds[i], items + bounds[i + 1], comp);
+    });
+
+    std::vector<T> buffer(n);
+    T* src = items;
+    T* dst = buffer.data();
+
+    for (int width = 1; width < parts; width *= 2) {
+        parallel(parts / (2 * width), [&](int i) {
+            int lo = bounds[2 * width * i];
+            int mid = bounds[2 * width * i + width];
+            int hi = bounds[2 * width * (i + 1)];
+
+            std::merge(std::make_move_iterator(src + lo), std::make_move_iterator(src + mid),
+                       std::make_move_iterator(src + mid), std::make_move_iterator(src + hi),
+                       dst + lo, comp);
+        });
+
+        std::swap(src, dst);
+    }
+
+    if (src != items)
+        std::move(src, src + n, items);
+}
+
+// Run the given function as one transaction, so a run of pushes inside it commits once.
+template <typename VAL_T, typename ROOT_T>
+template <typename F>
+void pvector<VAL_T, ROOT_T>::batch(F&& fn) {
+    PSTATS_OP(PSTATS_PVECTOR, "batch");
+
+    ptx::run(pop, [&] {
+        PSTATS_TX(PSTATS_PVECTOR);
+        fn();
+    });
+}
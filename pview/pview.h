@@ -0,0 +1,201 @@
+#ifndef _PVIEW_H
+#define _PVIEW_H
+
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include "../pvector/pvector.h"
+#include "../plist/plist.h"
+#include "../pstring/pstring.h"
+#include "../phashtable/phashtable.h"
+
+using namespace pmem;
+using namespace pmem::obj;
+
+// Where a reader finds things in a libpmemobj pool file (on-media format 6): the pool
+// signature at the start, the layout name after the 4 KiB pool header, and the offset of
+// the root object after the 2 KiB pool descriptor. Object offsets are from the start of
+// the file, so a single-file pool can be read through any mapping of it. Poolsets are not
+// supported.
+#define PVIEW_SIGNATURE "PMEMOBJ"
+#define PVIEW_LAYOUT_AT ((size_t)4096)
+#define PVIEW_LAYOUT_MAX ((size_t)1024)
+#define PVIEW_ROOT_AT ((size_t)6144)
+
+// Write epoch of a pool, kept directly in its root (a new root is zeroed, which is epoch
+// 0). The writer wraps each change that readers may see in write(): the epoch is odd for
+// as long as the change is under way and moves on to the next even number once it is
+// done, whether it committed or threw. Readers use it as a sequence lock, retrying any
+// read that overlapped a change, and as a cheap way to tell that the writer has moved on.
+//
+// A crash in the middle of write() leaves the epoch odd, which stalls readers until the
+// writer reopens the pool and calls reset(). write() is not transactional: do not call it
+// inside a transaction, though the function it runs may open any number of them.
+class pepoch {
+private:
+    p<uint64_t> seq;
+
+    void store(pool_base&, uint64_t);
+
+public:
+    // Get/Set
+    uint64_t get() const;
+
+    // Misc.
+    template <typename F>
+    void write(pool_base&, F&&);
+    void reset(pool_base&);
+};
+
+template <typename ROOT_T>
+class pview;
+
+// Read-only view of the items of a pvector, valid for the epoch it was taken in.
+template <typename VAL_T>
+class pvector_view {
+private:
+    const VAL_T* arr;
+    int len;
+
+public:
+    // Constructors
+    pvector_view();
+    pvector_view(const VAL_T*, int);
+
+    // Operator Overloads
+    const VAL_T& operator[](int) const;
+
+    // Get/Set
+    int get_length() const;
+    bool is_empty() const;
+    const VAL_T* begin() const;
+    const VAL_T* end() const;
+
+    // Misc.
+    template <typename F>
+    void for_each(F&&) const;
+};
+
+// Read-only view of a plist, walked node by node through the mapping.
+template <typename VAL_T, typename ROOT_T>
+class plist_view {
+private:
+    const pview<ROOT_T>* view;
+    const pnode<VAL_T, ROOT_T>* head;
+    int len;
+
+public:
+    // Constructors
+    plist_view();
+    plist_view(const pview<ROOT_T>*, const pnode<VAL_T, ROOT_T>*, int);
+
+    // Get/Set
+    int get_length() const;
+    bool is_empty() const;
+
+    // Misc.
+    template <typename F>
+    void for_each(F&&) const;
+};
+
+// Read-only view of a phashtable. Keys hash the way the table does, so lookups only walk
+// the one bucket.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+class phashtable_view {
+private:
+    typedef plist<ppair<KEY_T, VAL_T>, ROOT_T> bucket_t;
+
+    const pview<ROOT_T>* view;
+    const bucket_t* data;
+    int len;
+    int buckets;
+
+    bool find(const KEY_T&, VAL_T*) const;
+
+public:
+    // Constructors
+    phashtable_view();
+    phashtable_view(const pview<ROOT_T>*, const bucket_t*, int, int);
+
+    // Get/Set
+    VAL_T get(const KEY_T&) const;
+    bool contains(const KEY_T&) const;
+    int get_length() const;
+    int get_buckets() const;
+    bool is_empty() const;
+
+    // Misc.
+    template <typename F>
+    void for_each(F&&) const;
+};
+
+// Read-only open of a pool of ROOT_T, for processes that only look at its containers. The
+// pool file is mapped read-only and shared, with no libpmemobj pool behind it: there is no
+// recovery, no lanes and no transactions, nothing is ever written, and the pool's own
+// lock is not taken, so any number of readers can run alongside each other and alongside
+// the one process that has the pool open for writing, all sharing its page cache.
+//
+// Containers are read through views, which follow pool offsets within the mapping and
+// check every one against its bounds. A view is a few words and only good for the epoch
+// it was taken in, since the writer may move the storage behind it; taking a new one is
+// all a refresh costs. With an epoch, read() runs a function until it sees no change
+// under way or in between and returns the epoch it saw, and is_stale() tells whether the
+// writer has moved on since. Without one, reads are only consistent while the writer is
+// idle.
+//
+// Values are read in place, so only containers of trivially copyable values can be
+// viewed, and only in pools of the same ROOT_T written on a machine with the same layout.
+template <typename ROOT_T>
+class pview {
+private:
+    const char* map;
+    size_t map_len;
+    const ROOT_T* proot;
+    const pepoch* epoch;
+
+    template <typename VAL_T>
+    plist_view<VAL_T, ROOT_T> list_view(const plist<VAL_T, ROOT_T>&) const;
+
+    // hashtables view their buckets as lists in place
+    template <typename, typename, typename>
+    friend class phashtable_view;
+
+public:
+    // Constructors/Destructor
+    pview(const char*, const char*, pepoch ROOT_T::* epoch = nullptr);
+    ~pview();
+
+    pview(const pview&) = delete;
+    pview& operator=(const pview&) = delete;
+
+    // Get/Set
+    const ROOT_T& root() const;
+    uint64_t get_epoch() const;
+    bool is_stale(uint64_t) const;
+
+    // Views
+    template <typename T>
+    const typename std::remove_extent<T>::type* resolve(const persistent_ptr<T>&,
+                                                        size_t n = 1) const;
+    template <typename VAL_T>
+    pvector_view<VAL_T> view(const persistent_ptr<pvector<VAL_T, ROOT_T>>&) const;
+    template <typename VAL_T>
+    plist_view<VAL_T, ROOT_T> view(const persistent_ptr<plist<VAL_T, ROOT_T>>&) const;
+    std::string_view view(const persistent_ptr<pstring<ROOT_T>>&) const;
+    template <typename KEY_T, typename VAL_T>
+    phashtable_view<KEY_T, VAL_T, ROOT_T>
+    view(const persistent_ptr<phashtable<KEY_T, VAL_T, ROOT_T>>&) const;
+
+    // Misc.
+    template <typename F>
+    uint64_t read(F&&) const;
+};
+
+#include "pview.hpp"
+
+#endif
@@ -0,0 +1,492 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+/* ========================================================================= */
+/* ******************************** pepoch ********************************* */
+/* ========================================================================= */
+
+// Publish the given epoch to readers and make it durable.
+inline void pepoch::store(pool_base& pop, uint64_t val) {
+    __atomic_store_n(&seq.get_rw(), val, __ATOMIC_RELEASE);
+    pop.persist(seq);
+}
+
+// Get the current epoch; an odd one means a change is under way.
+inline uint64_t pepoch::get() const {
+    return __atomic_load_n(&seq.get_ro(), __ATOMIC_ACQUIRE);
+}
+
+// Run the given function as one change that readers either see whole or retry around.
+template <typename F>
+void pepoch::write(pool_base& pop, F&& fn) {
+    // an odd epoch left by a crash is simply reused
+    uint64_t odd = seq.get_ro() | 1;
+
+    store(pop, odd);
+    // keep every store of the change behind the odd epoch
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    try {
+        fn();
+    }
+    catch (...) {
+        store(pop, odd + 1);
+        throw;
+    }
+
+    store(pop, odd + 1);
+}
+
+// Close a change left open by a crash, so readers stop waiting on it.
+inline void pepoch::reset(pool_base& pop) {
+    uint64_t val = seq.get_ro();
+
+    if (val & 1)
+        store(pop, val + 1);
+}
+
+/* ========================================================================= */
+/* ****************************** pvector_view ***************************** */
+/* ========================================================================= */
+
+/* ============================= CONSTRUCTORS ============================== */
+
+// Create an empty view.
+template <typename VAL_T>
+pvector_view<VAL_T>::pvector_view() : arr(nullptr), len(0) {}
+
+// Create a view of the given items.
+template <typename VAL_T>
+pvector_view<VAL_T>::pvector_view(const VAL_T* arr_in, int len_in) : arr(arr_in), len(len_in) {}
+
+/* ========================== OPERATOR OVERLOADS =========================== */
+
+// Get a read-only reference to the item at the given index.
+template <typename VAL_T>
+const VAL_T& pvector_view<VAL_T>::operator[](int idx) const {
+    if (idx < 0 || idx >= len)
+        throw std::out_of_range("Cannot access past the range of the vector.");
+
+    return arr[idx];
+}
+
+/* ================================ GET/SET ================================ */
+
+// Get the number of items in the view.
+template <typename VAL_T>
+int pvector_view<VAL_T>::get_length() const {
+    return len;
+}
+
+// Check whether the view has no items.
+template <typename VAL_T>
+bool pvector_view<VAL_T>::is_empty() const {
+    return len == 0;
+}
+
+// Get a pointer to the first item.
+template <typename VAL_T>
+const VAL_T* pvector_view<VAL_T>::begin() const {
+    return arr;
+}
+
+// Get a pointer past the last item.
+template <typename VAL_T>
+const VAL_T* pvector_view<VAL_T>::end() const {
+    return arr + len;
+}
+
+/* ================================= MISC. ================================= */
+
+// Call the given function on every item, front to back.
+template <typename VAL_T>
+template <typename F>
+void pvector_view<VAL_T>::for_each(F&& fn) const {
+    for (int i = 0; i < len; i++)
+        fn(arr[i]);
+}
+
+/* ========================================================================= */
+/* ******************************* plist_view ****************************** */
+/* ========================================================================= */
+
+/* ============================= CONSTRUCTORS ============================== */
+
+// Create an empty view.
+template <typename VAL_T, typename ROOT_T>
+plist_view<VAL_T, ROOT_T>::plist_view() : view(nullptr), head(nullptr), len(0) {}
+
+// Create a view of the given chain of nodes.
+template <typename VAL_T, typename ROOT_T>
+plist_view<VAL_T, ROOT_T>::plist_view(const pview<ROOT_T>* view_in,
+                                      const pnode<VAL_T, ROOT_T>* head_in, int len_in)
+    : view(view_in), head(head_in), len(len_in) {}
+
+/* ================================ GET/SET ================================ */
+
+// Get the number of items in the view.
+template <typename VAL_T, typename ROOT_T>
+int plist_view<VAL_T, ROOT_T>::get_length() const {
+    return len;
+}
+
+// Check whether the view has no items.
+template <typename VAL_T, typename ROOT_T>
+bool plist_view<VAL_T, ROOT_T>::is_empty() const {
+    return len == 0;
+}
+
+/* ================================= MISC. ================================= */
+
+// Call the given function on every item, front to back.
+template <typename VAL_T, typename ROOT_T>
+template <typename F>
+void plist_view<VAL_T, ROOT_T>::for_each(F&& fn) const {
+    auto current = head;
+
+    for (int i = 0; i < len; i++) {
+        // a chain shorter than its length was caught part way through a change
+        if (current == nullptr)
+            throw std::out_of_range("List ends before its length.");
+
+        fn(current->get_value());
+        current = view->resolve(current->get_next());
+    }
+}
+
+/* ========================================================================= */
+/* **************************** phashtable_view **************************** */
+/* ========================================================================= */
+
+/* ============================= CONSTRUCTORS ============================== */
+
+// Create an empty view.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+phashtable_view<KEY_T, VAL_T, ROOT_T>::phashtable_view()
+    : view(nullptr), data(nullptr), len(0), buckets(0) {}
+
+// Create a view of the given buckets.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+phashtable_view<KEY_T, VAL_T, ROOT_T>::phashtable_view(const pview<ROOT_T>* view_in,
+                                                       const bucket_t* data_in, int len_in,
+                                                       int buckets_in)
+    : view(view_in), data(data_in), len(len_in), buckets(buckets_in) {}
+
+/* ================================ HELPERS ================================ */
+
+// Look for the given key, and copy its value out if it is there and val is not nullptr.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+bool phashtable_view<KEY_T, VAL_T, ROOT_T>::find(const KEY_T& key, VAL_T* val) const {
+    if (buckets == 0)
+        return false;
+
+    bool found = false;
+
+    view->list_view(data[std::hash<KEY_T>()(key) % (size_t)buckets])
+        .for_each([&](const ppair<KEY_T, VAL_T>& pair) {
+            if (!found && pair.key.get_ro() == key) {
+                found = true;
+
+                if (val != nullptr)
+                    *val = pair.val.get_ro();
+            }
+        });
+
+    return found;
+}
+
+/* ================================ GET/SET ================================ */
+
+// Get the value stored under the given key.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+VAL_T phashtable_view<KEY_T, VAL_T, ROOT_T>::get(const KEY_T& key) const {
+    VAL_T val;
+
+    if (!find(key, &val))
+        throw std::out_of_range("Cannot get a key that is not in the hashtable.");
+
+    return val;
+}
+
+// Check whether the given key is stored.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+bool phashtable_view<KEY_T, VAL_T, ROOT_T>::contains(const KEY_T& key) const {
+    return find(key, nullptr);
+}
+
+// Get the number of pairs in the view.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+int phashtable_view<KEY_T, VAL_T, ROOT_T>::get_length() const {
+    return len;
+}
+
+// Get the number of buckets.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+int phashtable_view<KEY_T, VAL_T, ROOT_T>::get_buckets() const {
+    return buckets;
+}
+
+// Check whether the view has no pairs.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+bool phashtable_view<KEY_T, VAL_T, ROOT_T>::is_empty() const {
+    return len == 0;
+}
+
+/* ================================= MISC. ================================= */
+
+// Call the given function on every key and value, bucket by bucket.
+template <typename KEY_T, typename VAL_T, typename ROOT_T>
+template <typename F>
+void phashtable_view<KEY_T, VAL_T, ROOT_T>::for_each(F&& fn) const {
+    for (int b = 0; b < buckets; b++) {
+        view->list_view(data[b]).for_each([&](const ppair<KEY_T, VAL_T>& pair) {
+            fn(pair.key.get_ro(), pair.val.get_ro());
+        });
+    }
+}
+
+/* ========================================================================= */
+/* ********************************* pview ********************************* */
+/* ========================================================================= */
+
+/* ========================= CONSTRUCTORS/DESTRUCTOR ======================= */
+
+// Map the pool at the given path, created with the given layout, for reading. The epoch,
+// if given, is the root's member the writer publishes its changes through.
+template <typename ROOT_T>
+pview<ROOT_T>::pview(const char* path, const char* layout, pepoch ROOT_T::* epoch_in) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error(std::string("Cannot open ") + path + ": " + strerror(errno));
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        close(fd);
+        throw std::runtime_error(std::string("Cannot stat ") + path + ": " + strerror(err));
+    }
+
+    map_len = st.st_size;
+
+    if (map_len < PVIEW_ROOT_AT + sizeof(uint64_t)) {
+        close(fd);
+        throw std::runtime_error(std::string(path) + " is not a pool.");
+    }
+
+    void* addr = mmap(nullptr, map_len, PROT_READ, MAP_SHARED, fd, 0);
+    int err = errno;
+    // the mapping keeps the file open on its own
+    close(fd);
+
+    if (addr == MAP_FAILED)
+        throw std::runtime_error(std::string("Cannot map ") + path + ": " + strerror(err));
+
+    map = (const char*)addr;
+
+    // lookups jump around the pool, so read-ahead would only fetch pages nobody needs
+    madvise(addr, map_len, MADV_RANDOM);
+
+    uint64_t root_at;
+    memcpy(&root_at, map + PVIEW_ROOT_AT, sizeof(root_at));
+
+    const char* error = nullptr;
+    if (memcmp(map, PVIEW_SIGNATURE, sizeof(PVIEW_SIGNATURE)) != 0)
+        error = " is not a pool.";
+    else if (strncmp(map + PVIEW_LAYOUT_AT, layout, PVIEW_LAYOUT_MAX) != 0)
+        error = " was created with a different layout.";
+    else if (root_at == 0 || root_at > map_len || map_len - root_at < sizeof(ROOT_T))
+        error = " has no root.";
+
+    if (error != nullptr) {
+        munmap(addr, map_len);
+        throw std::runtime_error(std::string(path) + error);
+    }
+
+    proot = (const ROOT_T*)(map + root_at);
+    epoch = epoch_in != nullptr ? &(proot->*epoch_in) : nullptr;
+}
+
+// Unmap the pool.
+template <typename ROOT_T>
+pview<ROOT_T>::~pview() {
+    munmap((void*)map, map_len);
+}
+
+/* ================================ GET/SET ================================ */
+
+// Get the root of the pool, whose pointers are only good through resolve() and view().
+template <typename ROOT_T>
+const ROOT_T& pview<ROOT_T>::root() const {
+    return *proot;
+}
+
+// Get the writer's current epoch, or 0 if the pool has none.
+template <typename ROOT_T>
+uint64_t pview<ROOT_T>::get_epoch() const {
+    return epoch != nullptr ? epoch->get() : 0;
+}
+
+// Check whether the writer has moved on from the given epoch, i.e. views taken in it
+// should be taken again.
+template <typename ROOT_T>
+bool pview<ROOT_T>::is_stale(uint64_t seen) const {
+    return get_epoch() != seen;
+}
+
+/* ================================ HELPERS ================================ */
+
+// Get a view of the given list, which lies in the mapping.
+template <typename ROOT_T>
+template <typename VAL_T>
+plist_view<VAL_T, ROOT_T> pview<ROOT_T>::list_view(const plist<VAL_T, ROOT_T>& list) const {
+    int len = list.len;
+
+    if (len < 0)
+        throw std::out_of_range("List length is out of range.");
+
+    return plist_view<VAL_T, ROOT_T>(this, resolve(list.head), len);
+}
+
+/* ================================= VIEWS ================================= */
+
+// Get where the given pool pointer and the n objects from it are in the mapping, or
+// nullptr if it is null.
+template <typename ROOT_T>
+template <typename T>
+const typename std::remove_extent<T>::type*
+pview<ROOT_T>::resolve(const persistent_ptr<T>& ptr, size_t n) const {
+    typedef typename std::remove_extent<T>::type elem_t;
+
+    uint64_t off = ptr.raw().off;
+
+    if (off == 0)
+        return nullptr;
+
+    if (off > map_len || n > (map_len - off) / sizeof(elem_t))
+        throw std::out_of_range("Cannot view an object outside the pool.");
+
+    return (const elem_t*)(map + off);
+}
+
+// Get a view of the given vector; one not created yet views as empty.
+template <typename ROOT_T>
+template <typename VAL_T>
+pvector_view<VAL_T> pview<ROOT_T>::view(const persistent_ptr<pvector<VAL_T, ROOT_T>>& ptr) const {
+    static_assert(std::is_trivially_copyable<VAL_T>::value,
+                  "Only vectors of trivially copyable values can be viewed.");
+
+    auto vec = resolve(ptr);
+
+    if (vec == nullptr)
+        return pvector_view<VAL_T>();
+
+    int len = vec->len;
+    auto arr = resolve(vec->arr, len > 0 ? len : 0);
+
+    if (len < 0 || len > vec->cap || (len > 0 && arr == nullptr))
+        throw std::out_of_range("Vector length is out of range.");
+
+    return pvector_view<VAL_T>(arr, len);
+}
+
+// Get a view of the given list; one not created yet views as empty.
+template <typename ROOT_T>
+template <typename VAL_T>
+plist_view<VAL_T, ROOT_T> pview<ROOT_T>::view(const persistent_ptr<plist<VAL_T, ROOT_T>>& ptr) const {
+    static_assert(std::is_trivially_copyable<VAL_T>::value,
+                  "Only lists of trivially copyable values can be viewed.");
+
+    auto list = resolve(ptr);
+
+    if (list == nullptr)
+        return plist_view<VAL_T, ROOT_T>();
+
+    return list_view(*list);
+}
+
+// Get the characters of the given string; one not created yet views as empty.
+template <typename ROOT_T>
+std::string_view pview<ROOT_T>::view(const persistent_ptr<pstring<ROOT_T>>& ptr) const {
+    auto str = resolve(ptr);
+
+    if (str == nullptr)
+        return std::string_view();
+
+    int len = str->len;
+    auto arr = resolve(str->arr, len > 0 ? len : 0);
+
+    if (len < 0 || len >= str->cap || (len > 0 && arr == nullptr))
+        throw std::out_of_range("String length is out of range.");
+
+    return std::string_view(arr, len);
+}
+
+// Get a view of the given hashtable; one not created yet views as empty.
+template <typename ROOT_T>
+template <typename KEY_T, typename VAL_T>
+phashtable_view<KEY_T, VAL_T, ROOT_T>
+pview<ROOT_T>::view(const persistent_ptr<phashtable<KEY_T, VAL_T, ROOT_T>>& ptr) const {
+    static_assert(std::is_trivially_copyable<KEY_T>::value && std::is_trivially_copyable<VAL_T>::value,
+                  "Only hashtables of trivially copyable keys and values can be viewed.");
+
+    auto table = resolve(ptr);
+
+    if (table == nullptr)
+        return phashtable_view<KEY_T, VAL_T, ROOT_T>();
+
+    int len = table->len;
+    int buckets = table->buckets;
+    auto vec = resolve(table->data);
+
+    if (len < 0 || buckets <= 0 || vec == nullptr || vec->len != buckets)
+        throw std::out_of_range("Hashtable buckets are out of range.");
+
+    return phashtable_view<KEY_T, VAL_T, ROOT_T>(this, resolve(vec->arr, buckets), len, buckets);
+}
+
+/* ================================= MISC. ================================= */
+
+// Run the given function, which reads through this pool's views, until it runs without a
+// change overlapping it, and get the epoch it saw. A read that overlapped a change may
+// have followed stale pointers and thrown, which is retried too; an exception from a read
+// that did not is passed on.
+template <typename ROOT_T>
+template <typename F>
+uint64_t pview<ROOT_T>::read(F&& fn) const {
+    if (epoch == nullptr) {
+        fn();
+        return 0;
+    }
+
+    while (true) {
+        uint64_t seen = epoch->get();
+
+        if (seen & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        try {
+            fn();
+        }
+        catch (...) {
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+            if (epoch->get() == seen)
+                throw;
+
+            continue;
+        }
+
+        // keep every load of the read ahead of the second look at the epoch
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (epoch->get() == seen)
+            return seen;
+    }
+}
@@ -24,6 +24,39 @@ run_() {
     cd ..
 }
 
+bench_() {
+    echo
+    echo "*** BENCHMARKING ***"
+    echo
+
+    make bench
+    cd build
+    PMEM_IS_PMEM_FORCE=1 ./bench --pool-dir /dev/shm "$@"
+    cd ..
+}
+
+check_() {
+    echo
+    echo "*** CHECKING ***"
+    echo
+
+    make check
+    cd build
+    ./check "$@"
+    cd ..
+}
+
+ycsb_() {
+    echo
+    echo "*** RUNNING WORKLOAD ***"
+    echo
+
+    make ycsb
+    cd build
+    PMEM_IS_PMEM_FORCE=1 ./ycsb --pool-dir /dev/shm "$@"
+    cd ..
+}
+
 clear
 
 if [ -z "$1" ]
@@ -44,9 +77,33 @@ then
     run_
 fi
 
+if [ -n "$1" ] && [ $1 = "bench" ]
+then
+    shift
+    bench_ "$@"
+fi
+
+if [ -n "$1" ] && [ $1 = "check" ]
+then
+    shift
+    check_ "$@"
+fi
+
+if [ -n "$1" ] && [ $1 = "ycsb" ]
+then
+    shift
+    ycsb_ "$@"
+fi
+
 if [ -n "$1" ] && [ $1 = "-h" ]
 then
     echo "Pass no arguments to only run an existing executable"
     echo "Pass 'full' as the first argument to clean, make, and run"
     echo "Pass 'make' as the first argument to make and run"
+    echo "Pass 'bench' as the first argument to make and run the benchmarks; any"
+    echo "further arguments are passed to the benchmark binary"
+    echo "Pass 'check' as the first argument to make and run the integrity checker"
+    echo "on the driver's pool; any further arguments are passed to it"
+    echo "Pass 'ycsb' as the first argument to make and run the YCSB-style workload"
+    echo "driver; any further arguments are passed to it"
 fi
@@ -0,0 +1,958 @@
+// basic imports
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+// PMDK imports
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+// local collection imports
+#include "../phashtable/phashtable.h"
+#include "../pcheck/pcheck.h"
+
+#define PMFILE "ycsb.pool"
+#define LAYOUT "YCSBPOOL"
+#define MIN_POOLSIZE ((size_t)(1024 * 1024 * 64)) // 64 MB
+// pool bytes budgeted per record on top of its value
+#define BYTES_PER_RECORD ((size_t)128)
+// records inserted per transaction while loading
+#define LOAD_BATCH 1000
+// most records a scan reads
+#define MAX_SCAN 100
+// skew of the zipfian and latest distributions, as in YCSB
+#define ZIPF_THETA 0.99
+// latency histogram resolution: linear sub-buckets per power of two nanoseconds
+#define HIST_SUB 8
+#define HIST_BUCKETS (64 * HIST_SUB)
+
+using namespace pmem;
+using namespace pmem::obj;
+using namespace std;
+
+// A value of N bytes. The table keeps values inline in its nodes, so each supported value
+// size is its own record type.
+template <int N>
+struct record {
+    char data[N];
+};
+
+template <int N>
+class root {
+public:
+    persistent_ptr<phashtable<uint64_t, record<N>, root<N>>> table;
+    // every id below this has been inserted, each in the same transaction as its pair
+    p<uint64_t> records;
+};
+
+/* ========================================================================= */
+/* ******************************* workloads ******************************* */
+/* ========================================================================= */
+
+enum op_type { OP_READ, OP_UPDATE, OP_INSERT, OP_SCAN, OP_RMW, OP_KINDS };
+
+static const char* op_names[OP_KINDS] = {"READ", "UPDATE", "INSERT", "SCAN", "READ-MODIFY-WRITE"};
+
+enum class dist { uniform, zipfian, latest };
+
+// The share of each operation, summing to 1, and how the records they touch are chosen.
+struct workload {
+    double mix[OP_KINDS];
+    dist keys;
+};
+
+struct ycsb_config {
+    string pool_dir = ".";
+    char workload = 'a';
+    long records = 100000;
+    int threads = 1;
+    int value_size = 100;
+    double warmup = 5;
+    double duration = 30;
+    double interval = 5;
+    string distribution;
+    // shares given on the command line, replacing the workload's mix when any is set
+    double mix[OP_KINDS] = {-1, -1, -1, -1, -1};
+    size_t pool_size = 0;
+    bool crash = false;
+    double crash_after = 5;
+    // give every client thread an arena of its own (see palloc)
+    bool arenas = false;
+    uint64_t seed = 1;
+};
+
+// Get the mix of one of YCSB's core workloads A to F.
+static bool core_workload(char name, workload& w) {
+    fill(w.mix, w.mix + OP_KINDS, 0.0);
+    w.keys = dist::zipfian;
+
+    switch (name) {
+    case 'a': // update heavy
+        w.mix[OP_READ] = 0.5;
+        w.mix[OP_UPDATE] = 0.5;
+        return true;
+    case 'b': // read mostly
+        w.mix[OP_READ] = 0.95;
+        w.mix[OP_UPDATE] = 0.05;
+        return true;
+    case 'c': // read only
+        w.mix[OP_READ] = 1.0;
+        return true;
+    case 'd': // read latest
+        w.mix[OP_READ] = 0.95;
+        w.mix[OP_INSERT] = 0.05;
+        w.keys = dist::latest;
+        return true;
+    case 'e': // short ranges
+        w.mix[OP_SCAN] = 0.95;
+        w.mix[OP_INSERT] = 0.05;
+        return true;
+    case 'f': // read-modify-write
+        w.mix[OP_READ] = 0.5;
+        w.mix[OP_RMW] = 0.5;
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Hash a record id with 64-bit FNV-1a, as YCSB does to turn ids into keys and to scatter
+// the hot ranks of the zipfian distribution.
+static uint64_t fnv64(uint64_t v) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    for (int i = 0; i < 8; i++) {
+        h ^= v & 0xff;
+        h *= 0x100000001b3ULL;
+        v >>= 8;
+    }
+
+    return h;
+}
+
+// Draws ranks from 0 to n - 1, rank 0 being the hottest, by the method of Gray et al. that
+// YCSB uses. When n grows with inserts, zeta is extended by the new terms instead of being
+// recomputed, so a copy made after the load starts off cheap.
+class zipf_gen {
+private:
+    double theta;
+    double alpha;
+    double zeta2;
+    double zetan;
+    double eta;
+    uint64_t n;
+
+    void grow(uint64_t);
+
+public:
+    zipf_gen(uint64_t, double);
+    uint64_t next(uint64_t, mt19937_64&);
+};
+
+zipf_gen::zipf_gen(uint64_t items, double theta_in) : theta(theta_in), zetan(0), n(0) {
+    alpha = 1.0 / (1.0 - theta);
+    zeta2 = 1.0 + pow(0.5, theta);
+    grow(items);
+}
+
+// Extend zeta to the given number of items.
+void zipf_gen::grow(uint64_t items) {
+    for (uint64_t i = n + 1; i <= items; i++)
+        zetan += 1.0 / pow((double)i, theta);
+
+    n = items;
+    eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+}
+
+// Draw a rank below the given number of items.
+uint64_t zipf_gen::next(uint64_t items, mt19937_64& rng) {
+    if (items > n)
+        grow(items);
+
+    double u = uniform_real_distribution<double>(0.0, 1.0)(rng);
+    double uz = u * zetan;
+
+    if (uz < 1.0)
+        return 0;
+    if (uz < zeta2)
+        return 1;
+
+    uint64_t rank = (uint64_t)(n * pow(eta * u - eta + 1.0, alpha));
+    return rank < n ? rank : n - 1;
+}
+
+// Pick the operation that the given uniform draw in [0, 1) falls on.
+static op_type pick_op(const workload& w, double u) {
+    for (int op = 0; op < OP_KINDS - 1; op++) {
+        if (u < w.mix[op])
+            return (op_type)op;
+        u -= w.mix[op];
+    }
+
+    return OP_RMW;
+}
+
+// Pick a record id below n with the workload's distribution.
+static uint64_t pick_id(dist keys, uint64_t n, zipf_gen& zipf, mt19937_64& rng) {
+    switch (keys) {
+    case dist::uniform:
+        return uniform_int_distribution<uint64_t>(0, n - 1)(rng);
+    case dist::latest:
+        return n - 1 - zipf.next(n, rng);
+    default:
+        return fnv64(zipf.next(n, rng)) % n;
+    }
+}
+
+/* ========================================================================= */
+/* ******************************* histograms ****************************** */
+/* ========================================================================= */
+
+// Latencies of one kind of operation, with HIST_SUB linear sub-buckets per power of two
+// nanoseconds, so percentiles are within 1/HIST_SUB of the truth. Only its own thread adds
+// to it, but the reporter reads it while the run goes on.
+struct histogram {
+    atomic<uint64_t> counts[HIST_BUCKETS];
+    atomic<uint64_t> sum_ns;
+    atomic<uint64_t> failed;
+
+    histogram();
+    void add(uint64_t, bool);
+
+    static int bucket_of(uint64_t);
+    static uint64_t bucket_low(int);
+};
+
+// A plain copy of histograms summed together, e.g. across threads or between two reports.
+struct hist_counts {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t ops;
+    uint64_t sum_ns;
+    uint64_t failed;
+
+    hist_counts();
+    void add(const histogram&);
+    hist_counts since(const hist_counts&) const;
+    uint64_t percentile(double) const;
+};
+
+// Every thread's histograms, kept apart so threads never share a cache line.
+struct alignas(64) thread_stats {
+    histogram hist[OP_KINDS];
+};
+
+histogram::histogram() {
+    for (auto& c : counts)
+        c.store(0, memory_order_relaxed);
+
+    sum_ns.store(0, memory_order_relaxed);
+    failed.store(0, memory_order_relaxed);
+}
+
+// Count one operation that took the given time. There is a single writer, so a plain
+// load and store is enough.
+void histogram::add(uint64_t ns, bool ok) {
+    auto& c = counts[bucket_of(ns)];
+
+    c.store(c.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    sum_ns.store(sum_ns.load(memory_order_relaxed) + ns, memory_order_relaxed);
+
+    if (!ok)
+        failed.store(failed.load(memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+// Get the bucket the given latency falls in.
+int histogram::bucket_of(uint64_t ns) {
+    if (ns < HIST_SUB)
+        return (int)ns;
+
+    int e = 63 - __builtin_clzll(ns);
+    int sub = (int)(ns >> (e - 3)) & (HIST_SUB - 1);
+
+    return (e - 2) * HIST_SUB + sub;
+}
+
+// Get the smallest latency in the given bucket.
+uint64_t histogram::bucket_low(int b) {
+    if (b < HIST_SUB)
+        return b;
+
+    int e = b / HIST_SUB + 2;
+    return (uint64_t)(HIST_SUB + b % HIST_SUB) << (e - 3);
+}
+
+hist_counts::hist_counts() : ops(0), sum_ns(0), failed(0) {
+    fill(counts, counts + HIST_BUCKETS, 0);
+}
+
+// Add the current contents of the given histogram.
+void hist_counts::add(const histogram& h) {
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        uint64_t c = h.counts[b].load(memory_order_relaxed);
+        counts[b] += c;
+        ops += c;
+    }
+
+    sum_ns += h.sum_ns.load(memory_order_relaxed);
+    failed += h.failed.load(memory_order_relaxed);
+}
+
+// Get what was counted after the given earlier copy was taken.
+hist_counts hist_counts::since(const hist_counts& before) const {
+    hist_counts d;
+
+    for (int b = 0; b < HIST_BUCKETS; b++)
+        d.counts[b] = counts[b] - before.counts[b];
+
+    d.ops = ops - before.ops;
+    d.sum_ns = sum_ns - before.sum_ns;
+    d.failed = failed - before.failed;
+
+    return d;
+}
+
+// Get the latency below which the given share of operations finished, as the upper edge
+// of its bucket.
+uint64_t hist_counts::percentile(double pct) const {
+    uint64_t want = (uint64_t)ceil(pct * ops);
+    uint64_t seen = 0;
+
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += counts[b];
+        if (seen >= want && seen > 0)
+            return b + 1 < HIST_BUCKETS ? histogram::bucket_low(b + 1) - 1 : UINT64_MAX;
+    }
+
+    return 0;
+}
+
+// Sum every thread's histograms per kind of operation.
+static void snapshot(const vector<unique_ptr<thread_stats>>& stats, hist_counts out[OP_KINDS]) {
+    for (int op = 0; op < OP_KINDS; op++) {
+        out[op] = hist_counts();
+        for (const auto& s : stats)
+            out[op].add(s->hist[op]);
+    }
+}
+
+/* ========================================================================= */
+/* ******************************** database ******************************* */
+/* ========================================================================= */
+
+// The table under test, plus the lock that lets reads run side by side. phashtable is not
+// safe to change from several threads at once, so writers take the lock exclusively.
+template <int N>
+class ycsb_db {
+public:
+    typedef root<N> root_t;
+    typedef phashtable<uint64_t, record<N>, root_t> table_t;
+
+    pool<root_t> pop;
+    persistent_ptr<root_t> proot;
+    persistent_ptr<table_t> table;
+    std::shared_mutex lock;
+    // ids every thread may read, published once their insert has committed
+    atomic<uint64_t> records;
+
+    static string layout();
+    static void fill(record<N>&, uint64_t, uint64_t);
+
+    void create(const string&, size_t);
+    void open(const string&);
+    void close();
+    void load(long);
+
+    void run(op_type, uint64_t, mt19937_64&);
+    void read(uint64_t);
+    void update(uint64_t, uint64_t);
+    void insert(uint64_t);
+    void scan(uint64_t, int);
+    void rmw(uint64_t);
+};
+
+// Get the pool layout, which names the value size so a pool is only opened as the record
+// type it was created with.
+template <int N>
+string ycsb_db<N>::layout() {
+    return string(LAYOUT) + "-" + to_string(N);
+}
+
+// Fill a value with bytes derived from its record id and version.
+template <int N>
+void ycsb_db<N>::fill(record<N>& r, uint64_t id, uint64_t version) {
+    memset(r.data, 'a' + (int)((id + version) % 26), N);
+}
+
+// Create the pool at the given path with an empty table.
+template <int N>
+void ycsb_db<N>::create(const string& path, size_t pool_size) {
+    pop = pool<root_t>::create(path, layout(), pool_size, S_IRWXU);
+    proot = pop.root();
+    table_t::register_classes(pop);
+
+    flat_transaction::run(pop, [&] {
+        proot->table = make_persistent<table_t>(pop);
+        proot->records = 0;
+    });
+
+    table = proot->table;
+    records.store(0);
+}
+
+// Open an existing pool, which rolls back any transaction a crash interrupted.
+template <int N>
+void ycsb_db<N>::open(const string& path) {
+    pop = pool<root_t>::open(path, layout());
+    proot = pop.root();
+    table_t::register_classes(pop);
+
+    if (proot->table == nullptr) {
+        pop.close();
+        throw runtime_error(path + " holds no table.");
+    }
+
+    table = proot->table;
+    table->refresh_pool(pop);
+    records.store(proot->records);
+}
+
+// Close the pool.
+template <int N>
+void ycsb_db<N>::close() {
+    table = nullptr;
+    proot = nullptr;
+    pop.close();
+}
+
+// Insert records 0 to n - 1, LOAD_BATCH per transaction.
+template <int N>
+void ycsb_db<N>::load(long n) {
+    record<N> r;
+
+    for (long first = 0; first < n; first += LOAD_BATCH) {
+        long last = min(n, first + LOAD_BATCH);
+
+        flat_transaction::run(pop, [&] {
+            for (long id = first; id < last; id++) {
+                fill(r, id, 0);
+                table->insert(fnv64(id), r);
+            }
+
+            proot->records = last;
+        });
+    }
+
+    records.store(n);
+}
+
+// Run one operation on the given record.
+template <int N>
+void ycsb_db<N>::run(op_type op, uint64_t id, mt19937_64& rng) {
+    switch (op) {
+    case OP_READ:
+        read(id);
+        break;
+    case OP_UPDATE:
+        update(id, rng());
+        break;
+    case OP_INSERT:
+        insert(rng());
+        break;
+    case OP_SCAN:
+        scan(id, 1 + (int)(rng() % MAX_SCAN));
+        break;
+    default:
+        rmw(id);
+        break;
+    }
+}
+
+// Read the given record.
+template <int N>
+void ycsb_db<N>::read(uint64_t id) {
+    shared_lock<std::shared_mutex> guard(lock);
+
+    volatile char c = table->get(fnv64(id)).data[0];
+    (void)c;
+}
+
+// Overwrite the given record with a new version.
+template <int N>
+void ycsb_db<N>::update(uint64_t id, uint64_t version) {
+    record<N> r;
+    fill(r, id, version);
+
+    unique_lock<std::shared_mutex> guard(lock);
+    table->insert(fnv64(id), r);
+}
+
+// Insert the next record, bumping the persistent count in the same transaction, then let
+// the other threads read it.
+template <int N>
+void ycsb_db<N>::insert(uint64_t version) {
+    record<N> r;
+    unique_lock<std::shared_mutex> guard(lock);
+
+    uint64_t id = proot->records;
+    fill(r, id, version);
+
+    flat_transaction::run(pop, [&] {
+        table->insert(fnv64(id), r);
+        proot->records = id + 1;
+    });
+
+    records.store(id + 1, memory_order_release);
+}
+
+// Read up to n records with consecutive ids from the given one. The table keeps no order,
+// so this is one lookup per record, much like a scan over a hash-partitioned store.
+template <int N>
+void ycsb_db<N>::scan(uint64_t id, int n) {
+    shared_lock<std::shared_mutex> guard(lock);
+    uint64_t end = min(id + n, records.load(memory_order_acquire));
+
+    for (uint64_t i = id; i < end; i++) {
+        volatile char c = table->get(fnv64(i)).data[0];
+        (void)c;
+    }
+}
+
+// Read the given record and write it back changed, as one atomic step.
+template <int N>
+void ycsb_db<N>::rmw(uint64_t id) {
+    unique_lock<std::shared_mutex> guard(lock);
+
+    record<N> r = table->get(fnv64(id));
+    r.data[0] = r.data[0] == 'z' ? 'a' : r.data[0] + 1;
+    table->insert(fnv64(id), r);
+}
+
+/* ========================================================================= */
+/* ********************************* phases ******************************** */
+/* ========================================================================= */
+
+enum { PHASE_WARMUP, PHASE_MEASURE, PHASE_STOP };
+
+// Run the workload on one thread until told to stop, timing every operation but only
+// counting those that finish while measuring.
+template <int N>
+static void worker(ycsb_db<N>& db, const workload& w, zipf_gen zipf, uint64_t seed, bool arena,
+                   thread_stats& stats, const atomic<int>& phase) {
+    mt19937_64 rng(seed);
+
+    if (arena)
+        palloc::thread_arena(db.pop);
+
+    uniform_real_distribution<double> coin(0.0, 1.0);
+
+    while (phase.load(memory_order_relaxed) != PHASE_STOP) {
+        op_type op = pick_op(w, coin(rng));
+        uint64_t id = pick_id(w.keys, db.records.load(memory_order_acquire), zipf, rng);
+        bool ok = true;
+
+        auto start = chrono::steady_clock::now();
+        try {
+            db.run(op, id, rng);
+        }
+        catch (const exception&) {
+            ok = false;
+        }
+        auto end = chrono::steady_clock::now();
+
+        if (phase.load(memory_order_relaxed) == PHASE_MEASURE)
+            stats.hist[op].add(chrono::duration_cast<chrono::nanoseconds>(end - start).count(), ok);
+    }
+}
+
+// Start the given number of workers, each with its own stats and random seed.
+template <int N>
+static vector<thread> start_workers(ycsb_db<N>& db, const ycsb_config& cfg, const workload& w,
+                                    const zipf_gen& zipf, vector<unique_ptr<thread_stats>>& stats,
+                                    const atomic<int>& phase) {
+    vector<thread> threads;
+
+    for (int t = 0; t < cfg.threads; t++) {
+        stats.emplace_back(new thread_stats());
+        threads.emplace_back(worker<N>, ref(db), cref(w), zipf, cfg.seed + t, cfg.arenas,
+                             ref(*stats.back()), cref(phase));
+    }
+
+    return threads;
+}
+
+static void sleep_for(double secs) {
+    this_thread::sleep_for(chrono::duration<double>(secs));
+}
+
+static double secs_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Print one interval report: throughput since the last one and its latency per operation.
+static void print_interval(double elapsed, double secs, const hist_counts cur[OP_KINDS],
+                           const hist_counts last[OP_KINDS]) {
+    uint64_t total = 0;
+    uint64_t ops = 0;
+
+    for (int op = 0; op < OP_KINDS; op++) {
+        total += cur[op].ops;
+        ops += cur[op].ops - last[op].ops;
+    }
+
+    printf("%.0f sec: %llu operations; %.1f current ops/sec;", elapsed, (unsigned long long)total,
+           secs > 0 ? ops / secs : 0);
+
+    for (int op = 0; op < OP_KINDS; op++) {
+        hist_counts d = cur[op].since(last[op]);
+        if (d.ops == 0)
+            continue;
+
+        printf(" [%s: Count=%llu, p50=%llu, p99=%llu]", op_names[op], (unsigned long long)d.ops,
+               (unsigned long long)d.percentile(0.50), (unsigned long long)d.percentile(0.99));
+    }
+
+    printf("\n");
+    fflush(stdout);
+}
+
+// Print the totals of the measured run, then each operation's full histogram.
+static void print_summary(double secs, const hist_counts all[OP_KINDS]) {
+    uint64_t ops = 0;
+
+    for (int op = 0; op < OP_KINDS; op++)
+        ops += all[op].ops;
+
+    printf("[OVERALL], RunTime(ms), %.0f\n", secs * 1000);
+    printf("[OVERALL], Throughput(ops/sec), %.1f\n", secs > 0 ? ops / secs : 0);
+
+    for (int op = 0; op < OP_KINDS; op++) {
+        const hist_counts& h = all[op];
+        if (h.ops == 0)
+            continue;
+
+        const char* name = op_names[op];
+        printf("[%s], Operations, %llu\n", name, (unsigned long long)h.ops);
+        printf("[%s], AverageLatency(ns), %.1f\n", name, (double)h.sum_ns / h.ops);
+        printf("[%s], 50thPercentileLatency(ns), %llu\n", name, (unsigned long long)h.percentile(0.50));
+        printf("[%s], 95thPercentileLatency(ns), %llu\n", name, (unsigned long long)h.percentile(0.95));
+        printf("[%s], 99thPercentileLatency(ns), %llu\n", name, (unsigned long long)h.percentile(0.99));
+        printf("[%s], 99.9thPercentileLatency(ns), %llu\n", name, (unsigned long long)h.percentile(0.999));
+        printf("[%s], Failed, %llu\n", name, (unsigned long long)h.failed);
+
+        // one line per power of two, which is all a terminal needs
+        uint64_t seen = 0;
+        for (int b = 0; b < HIST_BUCKETS; b += HIST_SUB) {
+            uint64_t c = 0;
+            for (int s = 0; s < HIST_SUB; s++)
+                c += h.counts[b + s];
+            if (c == 0)
+                continue;
+
+            seen += c;
+            printf("[%s], >=%lluns, %llu, %.2f%%\n", name, (unsigned long long)histogram::bucket_low(b),
+                   (unsigned long long)c, 100.0 * seen / h.ops);
+        }
+    }
+
+    fflush(stdout);
+}
+
+// Run the workload through a warmup and then a timed run, reporting at every interval.
+template <int N>
+static void measure(ycsb_db<N>& db, const ycsb_config& cfg, const workload& w, const zipf_gen& zipf) {
+    atomic<int> phase(PHASE_WARMUP);
+    vector<unique_ptr<thread_stats>> stats;
+    auto threads = start_workers(db, cfg, w, zipf, stats, phase);
+
+    sleep_for(cfg.warmup);
+    phase.store(PHASE_MEASURE);
+
+    auto start = chrono::steady_clock::now();
+    hist_counts last[OP_KINDS];
+    hist_counts cur[OP_KINDS];
+    double reported = 0;
+
+    while (reported < cfg.duration) {
+        sleep_for(min(cfg.interval, cfg.duration - reported));
+
+        double elapsed = secs_since(start);
+        snapshot(stats, cur);
+        print_interval(elapsed, elapsed - reported, cur, last);
+
+        copy(cur, cur + OP_KINDS, last);
+        reported = elapsed;
+    }
+
+    phase.store(PHASE_STOP);
+    for (auto& t : threads)
+        t.join();
+
+    double secs = secs_since(start);
+    snapshot(stats, cur);
+    print_summary(secs, cur);
+}
+
+// Run the workload in a child process and kill it at an arbitrary point after the given
+// time, then reopen the pool, timing the recovery, and check that every committed insert
+// survived and the table is sound. Returns the exit status.
+template <int N>
+static int crash_and_recover(const ycsb_config& cfg, const workload& w, const zipf_gen& zipf,
+                             const string& path) {
+    fflush(stdout);
+    pid_t pid = fork();
+
+    if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+
+    if (pid == 0) {
+        ycsb_db<N> db;
+        atomic<int> phase(PHASE_WARMUP);
+        vector<unique_ptr<thread_stats>> stats;
+
+        try {
+            db.open(path);
+        }
+        catch (const exception& e) {
+            cerr << "Cannot open " << path << ": " << e.what() << endl;
+            _exit(2);
+        }
+
+        // never stops: the parent kills it
+        auto threads = start_workers(db, cfg, w, zipf, stats, phase);
+        for (auto& t : threads)
+            t.join();
+        _exit(0);
+    }
+
+    sleep_for(cfg.crash_after);
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+
+    ycsb_db<N> db;
+    auto start = chrono::steady_clock::now();
+
+    try {
+        db.open(path);
+    }
+    catch (const exception& e) {
+        cerr << "Cannot reopen " << path << ": " << e.what() << endl;
+        return 2;
+    }
+
+    double open_secs = secs_since(start);
+    uint64_t records = db.records.load();
+    uint64_t missing = 0;
+
+    start = chrono::steady_clock::now();
+    for (uint64_t id = 0; id < records; id++) {
+        if (!db.table->contains(fnv64(id)))
+            missing++;
+    }
+    double verify_secs = secs_since(start);
+
+    pcheck checker(cfg.threads);
+    checker.add("table", *db.table);
+
+    start = chrono::steady_clock::now();
+    checker.run();
+    double check_secs = secs_since(start);
+
+    printf("[RECOVERY], Open(ms), %.3f\n", open_secs * 1000);
+    printf("[RECOVERY], Records, %llu\n", (unsigned long long)records);
+    printf("[RECOVERY], Verify(ms), %.3f\n", verify_secs * 1000);
+    printf("[RECOVERY], Missing, %llu\n", (unsigned long long)missing);
+    printf("[RECOVERY], Check(ms), %.3f\n", check_secs * 1000);
+    printf("[RECOVERY], Check, %s\n", checker.is_ok() ? "ok" : "broken");
+    fflush(stdout);
+
+    if (!checker.is_ok())
+        checker.report(cerr);
+
+    db.close();
+
+    return missing == 0 && checker.is_ok() ? 0 : 1;
+}
+
+// Load the table, run the workload, and crash and recover it if asked.
+template <int N>
+static int run_driver(const ycsb_config& cfg, const workload& w) {
+    string path = cfg.pool_dir + "/" + PMFILE;
+    size_t pool_size = cfg.pool_size ? cfg.pool_size
+                                     : max(MIN_POOLSIZE, (size_t)cfg.records * (N + BYTES_PER_RECORD) * 4);
+    ycsb_db<N> db;
+
+    // never reuse a pool, so every run starts from the same table
+    unlink(path.c_str());
+    db.create(path, pool_size);
+
+    auto start = chrono::steady_clock::now();
+    db.load(cfg.records);
+    double load_secs = secs_since(start);
+
+    printf("[LOAD], Records, %ld\n", cfg.records);
+    printf("[LOAD], ValueSize(bytes), %d\n", N);
+    printf("[LOAD], RunTime(ms), %.0f\n", load_secs * 1000);
+    printf("[LOAD], Throughput(ops/sec), %.1f\n", load_secs > 0 ? cfg.records / load_secs : 0);
+    fflush(stdout);
+
+    // summing zeta over every record is the slow part, so it is done once and copied
+    zipf_gen zipf(cfg.records, ZIPF_THETA);
+
+    measure(db, cfg, w, zipf);
+    db.close();
+
+    int status = cfg.crash ? crash_and_recover<N>(cfg, w, zipf, path) : 0;
+    unlink(path.c_str());
+
+    return status;
+}
+
+/* ========================================================================= */
+/* ********************************* main ********************************** */
+/* ========================================================================= */
+
+static void usage(const char* prog) {
+    cerr << "Usage: " << prog << " [options]" << endl
+         << "  --pool-dir DIR       directory for the pool file (default .)" << endl
+         << "  --workload a-f       YCSB core workload (default a)" << endl
+         << "  --records N          records loaded before the run (default 100000)" << endl
+         << "  --threads N          client threads (default 1)" << endl
+         << "  --value-size BYTES   value size, rounded up to 64, 256, 1024 or 4096 (default 100)" << endl
+         << "  --distribution D     uniform, zipfian or latest (default per workload)" << endl
+         << "  --read P             share of reads; any share given replaces the workload's mix" << endl
+         << "  --update P           share of updates" << endl
+         << "  --insert P           share of inserts" << endl
+         << "  --scan P             share of scans of up to " << MAX_SCAN << " records" << endl
+         << "  --rmw P              share of read-modify-writes" << endl
+         << "  --warmup S           seconds run before measuring (default 5)" << endl
+         << "  --duration S         seconds measured (default 30)" << endl
+         << "  --interval S         seconds between reports (default 5)" << endl
+         << "  --pool-mb N          fixed pool size in MB (default scales with records)" << endl
+         << "  --arenas             give every client thread its own allocator arena" << endl
+         << "  --crash              then rerun the workload in a child, kill it and time recovery" << endl
+         << "  --crash-after S      seconds the child runs before it is killed (default 5)" << endl
+         << "  --seed N             random seed (default 1)" << endl
+         << endl
+         << "Set PMEM_IS_PMEM_FORCE=1 to emulate pmem when the pool dir is on tmpfs or a" << endl
+         << "regular filesystem." << endl;
+}
+
+int main(int argc, char** argv) {
+    ycsb_config cfg;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_val = i + 1 < argc;
+
+        if (arg == "--pool-dir" && has_val)
+            cfg.pool_dir = argv[++i];
+        else if (arg == "--workload" && has_val)
+            cfg.workload = tolower(argv[++i][0]);
+        else if (arg == "--records" && has_val)
+            cfg.records = atol(argv[++i]);
+        else if (arg == "--threads" && has_val)
+            cfg.threads = atoi(argv[++i]);
+        else if (arg == "--value-size" && has_val)
+            cfg.value_size = atoi(argv[++i]);
+        else if (arg == "--distribution" && has_val)
+            cfg.distribution = argv[++i];
+        else if (arg == "--read" && has_val)
+            cfg.mix[OP_READ] = atof(argv[++i]);
+        else if (arg == "--update" && has_val)
+            cfg.mix[OP_UPDATE] = atof(argv[++i]);
+        else if (arg == "--insert" && has_val)
+            cfg.mix[OP_INSERT] = atof(argv[++i]);
+        else if (arg == "--scan" && has_val)
+            cfg.mix[OP_SCAN] = atof(argv[++i]);
+        else if (arg == "--rmw" && has_val)
+            cfg.mix[OP_RMW] = atof(argv[++i]);
+        else if (arg == "--warmup" && has_val)
+            cfg.warmup = atof(argv[++i]);
+        else if (arg == "--duration" && has_val)
+            cfg.duration = atof(argv[++i]);
+        else if (arg == "--interval" && has_val)
+            cfg.interval = atof(argv[++i]);
+        else if (arg == "--pool-mb" && has_val)
+            cfg.pool_size = (size_t)atol(argv[++i]) * 1024 * 1024;
+        else if (arg == "--arenas")
+            cfg.arenas = true;
+        else if (arg == "--crash")
+            cfg.crash = true;
+        else if (arg == "--crash-after" && has_val)
+            cfg.crash_after = atof(argv[++i]);
+        else if (arg == "--seed" && has_val)
+            cfg.seed = strtoull(argv[++i], nullptr, 10);
+        else {
+            usage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+
+    workload w;
+
+    if (!core_workload(cfg.workload, w)) {
+        cerr << "There is no workload " << cfg.workload << "; pick one of a to f." << endl;
+        return 1;
+    }
+
+    // shares given on the command line replace the workload's, normalized to sum to 1
+    double given = 0;
+    for (int op = 0; op < OP_KINDS; op++)
+        given += max(cfg.mix[op], 0.0);
+
+    if (given > 0) {
+        for (int op = 0; op < OP_KINDS; op++)
+            w.mix[op] = max(cfg.mix[op], 0.0) / given;
+    }
+
+    if (cfg.distribution == "uniform")
+        w.keys = dist::uniform;
+    else if (cfg.distribution == "zipfian")
+        w.keys = dist::zipfian;
+    else if (cfg.distribution == "latest")
+        w.keys = dist::latest;
+    else if (!cfg.distribution.empty()) {
+        cerr << "There is no distribution " << cfg.distribution << "." << endl;
+        return 1;
+    }
+
+    if (cfg.records < 1 || cfg.threads < 1 || cfg.value_size < 1 || cfg.duration <= 0 ||
+        cfg.interval <= 0 || cfg.warmup < 0 || cfg.crash_after < 0) {
+        cerr << "Records, threads, value size, duration and interval must be positive." << endl;
+        return 1;
+    }
+
+    try {
+        if (cfg.value_size <= 64)
+            return run_driver<64>(cfg, w);
+        if (cfg.value_size <= 256)
+            return run_driver<256>(cfg, w);
+        if (cfg.value_size <= 1024)
+            return run_driver<1024>(cfg, w);
+        if (cfg.value_size <= 4096)
+            return run_driver<4096>(cfg, w);
+    }
+    catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 2;
+    }
+
+    cerr << "Values can be at most 4096 bytes." << endl;
+    return 1;
+}